@@ -0,0 +1,160 @@
+#include "BatchEncoder.h"
+#include <stdexcept>
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	//Chunks not taken yet from one thread's share. The owner and threads stealing from it take chunks the same way
+	struct ChunkQueue
+	{
+		std::atomic<size_t> mNext;
+		size_t mEnd;
+	};
+
+	//Smallest symbol addText can encode message in. Character count indicators have the same length in every version of a range, so the segments
+	//addText picks only change between ranges. Ranges are tried smallest first, each with its own segments
+	QR::SymbolParameters ChooseSymbolForText(std::string_view message, QR::ErrorCorrectionLevel minimumLevel, bool allowMicroQR)
+	{
+		struct VersionRange
+		{
+			QR::SymbolType mType;
+			unsigned mLastVersion;
+		};
+		static constexpr std::array<VersionRange, 7> RANGES = { { { QR::SymbolType::MICRO_QR, 1 }, { QR::SymbolType::MICRO_QR, 2 }, { QR::SymbolType::MICRO_QR, 3 },
+			{ QR::SymbolType::MICRO_QR, 4 }, { QR::SymbolType::QR, 9 }, { QR::SymbolType::QR, 26 }, { QR::SymbolType::QR, 40 } } };
+
+		for (const auto &range : RANGES)
+		{
+			if (range.mType == QR::SymbolType::MICRO_QR && !allowMicroQR)
+				continue;
+
+			try
+			{
+				auto parameters = QR::ChooseSymbol(QR::GetOptimalSegments(message, range.mType, range.mLastVersion), minimumLevel, allowMicroQR);
+
+				if (parameters.mType == range.mType && parameters.mVersion <= range.mLastVersion)
+					return parameters;
+			}
+			catch (const std::exception&)
+			{
+				//Some characters may not fit the modes of a Micro QR version, the last range decides
+				if (&range == &RANGES.back())
+					throw;
+			}
+		}
+
+		throw std::length_error("Message exceeds the capacity of every symbol");
+	}
+
+	QR::EncodeResult Encode(const QR::EncodeJob &job, QR::EncodeContext &context)
+	{
+		QR::EncodeResult result;
+
+		try
+		{
+			QR::SymbolParameters parameters = { job.mType, job.mVersion, job.mLevel };
+
+			if (!job.mVersion && job.mMode)
+			{
+				QR::Segment segment = { job.mCharacters, job.mMode.value() };
+
+				parameters = QR::ChooseSymbol({ &segment, 1 }, job.mLevel, job.mType == QR::SymbolType::MICRO_QR);
+			}
+			else
+				if (!job.mVersion)
+					parameters = ChooseSymbolForText(job.mCharacters, job.mLevel, job.mType == QR::SymbolType::MICRO_QR);
+
+			QR::Encoder encoder(parameters.mType, parameters.mVersion, parameters.mLevel);
+
+			if (job.mMode)
+				encoder.addCharacters(job.mCharacters, job.mMode.value());
+			else
+				encoder.addText(job.mCharacters);
+
+			result.mMask = encoder.generateMatrixInto(result.mMatrix, context);
+			result.mParameters = parameters;
+		}
+		catch (...)
+		{
+			result = QR::EncodeResult();
+			result.mError = std::current_exception();
+		}
+
+		return result;
+	}
+}
+
+namespace QR
+{
+	BatchStatistics EncodeBatch(std::span<const EncodeJob> jobs, std::span<EncodeResult> results, const BatchOptions &options)
+	{
+		auto start = std::chrono::steady_clock::now();
+		BatchStatistics statistics = {};
+
+		if (results.size() != jobs.size())
+			throw std::invalid_argument("There must be one result for every job");
+
+		if (!options.mChunkSize)
+			throw std::invalid_argument("Chunk size can't be 0");
+
+		size_t chunkCount = (jobs.size() + options.mChunkSize - 1) / options.mChunkSize;
+		unsigned threadCount = options.mThreadCount ? options.mThreadCount : std::max(std::thread::hardware_concurrency(), 1u);
+
+		threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, std::max<size_t>(chunkCount, 1)));
+
+		std::unique_ptr<ChunkQueue[]> queues(new ChunkQueue[threadCount]);
+		std::vector<std::jthread> threads; //Joined even if the calling thread's share throws
+
+		for (unsigned i = 0; i < threadCount; ++i)
+		{
+			queues[i].mNext = chunkCount * i / threadCount;
+			queues[i].mEnd = chunkCount * (i + 1) / threadCount;
+		}
+
+		//Each thread empties its own queue, then the others in order starting with the next one
+		auto work = [&](unsigned thread) {
+			EncodeContext context;
+
+			for (unsigned i = 0; i < threadCount; ++i)
+			{
+				ChunkQueue &queue = queues[(thread + i) % threadCount];
+
+				for (size_t chunk = queue.mNext++; chunk < queue.mEnd; chunk = queue.mNext++)
+					for (size_t job = chunk * options.mChunkSize, end = std::min(job + options.mChunkSize, jobs.size()); job < end; ++job)
+						results[job] = Encode(jobs[job], context);
+			}
+		};
+
+		threads.reserve(threadCount - 1);
+
+		try
+		{
+			for (unsigned i = 1; i < threadCount; ++i)
+				threads.emplace_back(work, i);
+		}
+		catch (const std::exception&)
+		{
+			//Out of threads or memory. The threads already running and the calling thread take the chunks of the others
+		}
+
+		work(0);
+
+		for (auto &thread : threads)
+			thread.join();
+
+		threadCount = static_cast<unsigned>(threads.size() + 1);
+
+		statistics.mJobCount = jobs.size();
+		statistics.mFailedJobCount = std::count_if(results.begin(), results.end(), [](const EncodeResult &result) { return result.mError != nullptr; });
+		statistics.mThreadCount = threadCount;
+		statistics.mDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		statistics.mJobsPerSecond = statistics.mDuration.count() ? jobs.size() * 1e9 / statistics.mDuration.count() : 0;
+
+		return statistics;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef BATCHENCODER_H
+#define BATCHENCODER_H
+#include "QREncoder.h"
+#include "BitMatrix.h"
+#include <span>
+#include <optional>
+#include <exception>
+#include <chrono>
+#include <string_view>
+#include <cstddef>
+
+namespace QR
+{
+	struct EncodeJob
+	{
+		std::string_view mCharacters; //Same format as Encoder::addCharacters, must stay valid until EncodeBatch returns
+		std::optional<Mode> mMode; //Empty to split mCharacters into segments like Encoder::addText
+		SymbolType mType;
+		unsigned mVersion; //0 for the smallest symbol the characters fit in. Micro QR symbols are tried first if mType is MICRO_QR
+		ErrorCorrectionLevel mLevel; //Minimum level if mVersion is 0
+	};
+
+	struct EncodeResult
+	{
+		BitMatrix mMatrix;
+		SymbolParameters mParameters;
+		MaskSelection mMask;
+		std::exception_ptr mError; //Exception the job threw, the other members are only set if it's null
+	};
+
+	struct BatchOptions
+	{
+		unsigned mThreadCount = 0; //0 for std::thread::hardware_concurrency(). The calling thread is one of them
+		size_t mChunkSize = 64; //Jobs taken by a thread at once
+	};
+
+	struct BatchStatistics
+	{
+		size_t mJobCount;
+		size_t mFailedJobCount;
+		unsigned mThreadCount; //Threads actually used, never more than the number of chunks
+		std::chrono::nanoseconds mDuration;
+		double mJobsPerSecond;
+	};
+
+	//Encodes every job into the result with the same index, which must be as many. Chunks of jobs are split evenly between threads,
+	//and a thread that runs out of chunks takes them from the others. Exceptions are stored in the results, not thrown.
+	//Throws std::invalid_argument if results isn't as long as jobs or mChunkSize is 0
+	BatchStatistics EncodeBatch(std::span<const EncodeJob> jobs, std::span<EncodeResult> results, const BatchOptions &options = BatchOptions());
+}
+
+#endif
\ No newline at end of file
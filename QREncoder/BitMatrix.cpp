@@ -0,0 +1,135 @@
+#include "BitMatrix.h"
+#include <bit>
+#include <array>
+#include <stdexcept>
+
+namespace QR
+{
+	BitMatrix::BitMatrix(size_type width, size_type height)
+		:mWords(height * ((width + WORD_BITS - 1) / WORD_BITS)), mWidth(width), mHeight(height), mWordsPerRow((width + WORD_BITS - 1) / WORD_BITS)
+	{}
+
+	BitMatrix::BitMatrix(const std::vector<std::vector<bool>> &matrix)
+		:BitMatrix(matrix.empty() ? 0 : matrix.front().size(), matrix.size())
+	{
+		for (size_type i = 0; i < mHeight; ++i)
+			for (size_type j = 0; j < mWidth; ++j)
+				set(i, j, matrix[i][j]);
+	}
+
+	BitMatrix::size_type BitMatrix::getWidth() const
+	{
+		return mWidth;
+	}
+
+	BitMatrix::size_type BitMatrix::getHeight() const
+	{
+		return mHeight;
+	}
+
+	BitMatrix::size_type BitMatrix::getWordsPerRow() const
+	{
+		return mWordsPerRow;
+	}
+
+	const std::vector<BitMatrix::WordType>& BitMatrix::getWords() const
+	{
+		return mWords;
+	}
+
+	void BitMatrix::paste(const BitMatrix &source, size_type row, size_type column)
+	{
+		size_type wordOffset = column / WORD_BITS;
+		unsigned bitOffset = column % WORD_BITS;
+
+		if (row + source.mHeight > mHeight || column + source.mWidth > mWidth)
+			throw std::out_of_range("Source matrix doesn't fit");
+
+		for (size_type i = 0; i < source.mHeight; ++i)
+		{
+			const WordType *sourceRow = source.getRow(i);
+			WordType *destinationRow = getRow(row + i) + wordOffset;
+
+			for (size_type j = 0; j < source.mWordsPerRow; ++j)
+			{
+				destinationRow[j] |= sourceRow[j] << bitOffset;
+
+				if (bitOffset && wordOffset + j + 1 < mWordsPerRow)
+					destinationRow[j + 1] |= sourceRow[j] >> (WORD_BITS - bitOffset);
+			}
+		}
+	}
+
+	BitMatrix::size_type BitMatrix::count() const
+	{
+		size_type result = 0;
+
+		for (WordType word : mWords)
+			result += std::popcount(word);
+
+		return result;
+	}
+
+	void BitMatrix::reset(size_type width, size_type height)
+	{
+		mWidth = width;
+		mHeight = height;
+		mWordsPerRow = (width + WORD_BITS - 1) / WORD_BITS;
+		mWords.assign(height * mWordsPerRow, 0);
+	}
+
+	BitMatrix BitMatrix::transposed() const
+	{
+		BitMatrix result;
+
+		transposeInto(result);
+
+		return result;
+	}
+
+	void BitMatrix::transposeInto(BitMatrix &result) const
+	{
+		std::array<WordType, 64> block;
+
+		result.reset(mHeight, mWidth);
+
+		for (size_type rowBlock = 0; rowBlock < mHeight; rowBlock += WORD_BITS)
+			for (size_type wordIndex = 0; wordIndex < mWordsPerRow; ++wordIndex)
+			{
+				for (size_type i = 0; i < WORD_BITS; ++i)
+					block[i] = rowBlock + i < mHeight ? getRow(rowBlock + i)[wordIndex] : 0;
+
+				TransposeBlock(block);
+
+				for (size_type i = 0; i < WORD_BITS && wordIndex * WORD_BITS + i < mWidth; ++i)
+					result.getRow(wordIndex * WORD_BITS + i)[rowBlock / WORD_BITS] = block[i];
+			}
+	}
+
+	std::vector<std::vector<bool>> BitMatrix::toVector() const
+	{
+		std::vector<std::vector<bool>> result(mHeight, std::vector<bool>(mWidth));
+
+		for (size_type i = 0; i < mHeight; ++i)
+			for (size_type j = 0; j < mWidth; ++j)
+				result[i][j] = get(i, j);
+
+		return result;
+	}
+
+	BitMatrix& BitMatrix::operator^=(const BitMatrix &other)
+	{
+		for (decltype(mWords)::size_type i = 0; i < mWords.size(); ++i)
+			mWords[i] ^= other.mWords[i];
+
+		return *this;
+	}
+
+	BitMatrix& BitMatrix::operator|=(const BitMatrix &other)
+	{
+		for (decltype(mWords)::size_type i = 0; i < mWords.size(); ++i)
+			mWords[i] |= other.mWords[i];
+
+		return *this;
+	}
+}
\ No newline at end of file
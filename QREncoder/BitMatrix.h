@@ -0,0 +1,84 @@
+#ifndef BITMATRIX_H
+#define BITMATRIX_H
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace QR
+{
+	//Contiguous row-major matrix of modules. Every row is padded to a whole number of 64 bit words, bit 0 of the first word is the leftmost module.
+	//Padding bits are always 0.
+	class BitMatrix
+	{
+	public:
+		using WordType = std::uint64_t;
+		using size_type = size_t;
+		static constexpr unsigned WORD_BITS = 64;
+	private:
+		std::vector<WordType> mWords;
+		size_type mWidth = 0, mHeight = 0, mWordsPerRow = 0;
+	public:
+		BitMatrix() = default;
+		BitMatrix(size_type width, size_type height);
+		explicit BitMatrix(const std::vector<std::vector<bool>> &matrix);
+
+		bool get(size_type row, size_type column) const
+		{
+			return mWords[row * mWordsPerRow + column / WORD_BITS] >> column % WORD_BITS & 1;
+		}
+
+		void set(size_type row, size_type column, bool value)
+		{
+			WordType &word = mWords[row * mWordsPerRow + column / WORD_BITS];
+
+			word = (word & ~(WordType{ 1 } << column % WORD_BITS)) | WordType{ value } << column % WORD_BITS;
+		}
+
+		WordType* getRow(size_type row)
+		{
+			return mWords.data() + row * mWordsPerRow;
+		}
+
+		const WordType* getRow(size_type row) const
+		{
+			return mWords.data() + row * mWordsPerRow;
+		}
+
+		size_type getWidth() const;
+		size_type getHeight() const;
+		size_type getWordsPerRow() const;
+		const std::vector<WordType>& getWords() const;
+		//ORs source into this matrix with its top left corner at (row, column). source must fit
+		void paste(const BitMatrix &source, size_type row, size_type column);
+		//Number of set modules
+		size_type count() const;
+		//Sets the size and clears every module. Only allocates if the new size needs more memory than the matrix already has
+		void reset(size_type width, size_type height);
+		//Returns a matrix where module (i, j) is module (j, i) of this one
+		BitMatrix transposed() const;
+		//Same as transposed, into result
+		void transposeInto(BitMatrix &result) const;
+		std::vector<std::vector<bool>> toVector() const;
+		BitMatrix& operator^=(const BitMatrix &);
+		BitMatrix& operator|=(const BitMatrix &);
+		friend bool operator==(const BitMatrix &, const BitMatrix &) = default;
+	};
+
+	//Transposes a 64x64 block in place, bit j of block[i] ends up in bit i of block[j]
+	constexpr void TransposeBlock(std::array<BitMatrix::WordType, 64> &block)
+	{
+		BitMatrix::WordType mask = 0x00000000FFFFFFFF;
+
+		for (unsigned width = 32; width; width >>= 1, mask ^= mask << width)
+			for (unsigned k = 0; k < 64; k = (k + width + 1) & ~width)
+			{
+				BitMatrix::WordType swapped = (block[k] >> width ^ block[k + width]) & mask;
+
+				block[k] ^= swapped << width;
+				block[k + width] ^= swapped;
+			}
+	}
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "BitStream.h"
+
+namespace QR
+{
+	void BitStream::append(std::uint64_t value, unsigned bitCount)
+	{
+		if (!bitCount)
+			return;
+
+		unsigned offset = mSize % WORD_BITS, freeBits = WORD_BITS - offset;
+
+		if (bitCount < WORD_BITS)
+			value &= (WordType{ 1 } << bitCount) - 1;
+
+		if (!offset)
+			mWords.push_back(0);
+
+		if (bitCount <= freeBits)
+			mWords.back() |= value << (freeBits - bitCount);
+		else
+		{
+			mWords.back() |= value >> (bitCount - freeBits);
+			mWords.push_back(value << (WORD_BITS - (bitCount - freeBits)));
+		}
+
+		mSize += bitCount;
+	}
+
+	void BitStream::append(BitField field)
+	{
+		append(field.mValue, field.mLength);
+	}
+
+	void BitStream::append(const BitStream &other)
+	{
+		size_t fullWords = other.mSize / WORD_BITS;
+
+		if (!(mSize % WORD_BITS))
+		{
+			mWords.insert(mWords.end(), other.mWords.begin(), other.mWords.end());
+			mSize += other.mSize;
+			return;
+		}
+
+		reserve(mSize + other.mSize);
+
+		for (size_t i = 0; i < fullWords; ++i)
+			append(other.mWords[i], WORD_BITS);
+
+		if (other.mSize % WORD_BITS)
+			append(other.mWords[fullWords] >> (WORD_BITS - other.mSize % WORD_BITS), other.mSize % WORD_BITS);
+	}
+
+	void BitStream::appendBytes(std::string_view bytes)
+	{
+		std::string_view::size_type i = 0;
+
+		reserve(mSize + bytes.size() * 8);
+
+		for (; i + 8 <= bytes.size(); i += 8)
+		{
+			WordType word = 0;
+
+			for (std::string_view::size_type j = 0; j < 8; ++j)
+				word = word << 8 | static_cast<std::uint8_t>(bytes[i + j]);
+
+			append(word, WORD_BITS);
+		}
+
+		for (; i < bytes.size(); ++i)
+			append(static_cast<std::uint8_t>(bytes[i]), 8);
+	}
+
+	std::uint64_t BitStream::read(size_t position, unsigned bitCount) const
+	{
+		std::uint64_t result = 0;
+		size_t word = position / WORD_BITS;
+		unsigned offset = position % WORD_BITS;
+
+		if (!bitCount)
+			return 0;
+
+		if (word < mWords.size())
+			result = mWords[word] << offset;
+
+		if (offset && offset + bitCount > WORD_BITS && word + 1 < mWords.size())
+			result |= mWords[word + 1] >> (WORD_BITS - offset);
+
+		return result >> (WORD_BITS - bitCount);
+	}
+
+	void BitStream::resize(size_t bitCount)
+	{
+		mWords.resize((bitCount + WORD_BITS - 1) / WORD_BITS);
+		mSize = bitCount;
+
+		if (bitCount % WORD_BITS)
+			mWords.back() &= ~WordType{ 0 } << (WORD_BITS - bitCount % WORD_BITS);
+	}
+
+	void BitStream::reserve(size_t bitCount)
+	{
+		mWords.reserve((bitCount + WORD_BITS - 1) / WORD_BITS);
+	}
+
+	void BitStream::clear()
+	{
+		mWords.clear();
+		mSize = 0;
+	}
+
+	size_t BitStream::size() const
+	{
+		return mSize;
+	}
+
+	bool BitStream::operator[](size_t index) const
+	{
+		return mWords[index / WORD_BITS] >> (WORD_BITS - 1 - index % WORD_BITS) & 1;
+	}
+
+	const std::vector<BitStream::WordType>& BitStream::getWords() const
+	{
+		return mWords;
+	}
+
+	std::vector<bool> BitStream::toVector() const
+	{
+		std::vector<bool> result(mSize);
+
+		for (size_t i = 0; i < mSize; ++i)
+			result[i] = (*this)[i];
+
+		return result;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+namespace QR
+{
+	//Sequence of up to 32 bits, stored in the least significant bits of mValue. Most significant bit goes first in the stream.
+	struct BitField
+	{
+		std::uint32_t mValue;
+		unsigned mLength;
+	};
+
+	//Bit sequence packed most significant bit first into 64 bit words. Bits past size() in the last word are always 0.
+	class BitStream
+	{
+	public:
+		using WordType = std::uint64_t;
+		static constexpr unsigned WORD_BITS = 64;
+	private:
+		std::vector<WordType> mWords;
+		size_t mSize = 0;
+	public:
+		//Appends the bitCount least significant bits of value. bitCount must not be greater than 64
+		void append(std::uint64_t value, unsigned bitCount);
+		void append(BitField field);
+		void append(const BitStream &other);
+		//Appends every byte in bytes, 8 bits each
+		void appendBytes(std::string_view bytes);
+		//Reads bitCount bits starting at position. Bits past the end of the stream are read as 0
+		std::uint64_t read(size_t position, unsigned bitCount) const;
+		//New bits are set to 0
+		void resize(size_t bitCount);
+		void reserve(size_t bitCount);
+		void clear();
+		size_t size() const;
+		bool operator[](size_t index) const;
+		const std::vector<WordType>& getWords() const;
+		std::vector<bool> toVector() const;
+		friend bool operator==(const BitStream &, const BitStream &) = default;
+	};
+}
+
+#endif
\ No newline at end of file
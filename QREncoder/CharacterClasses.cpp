@@ -0,0 +1,168 @@
+#include "CharacterClasses.h"
+#include <array>
+#include <bit>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define QR_X86
+	#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define QR_TARGET(instructions) __attribute__((target(instructions)))
+#else
+	#define QR_TARGET(instructions)
+#endif
+
+namespace
+{
+	#ifdef QR_X86
+	//0xFF in every byte of characters that is between first and last, compared as unsigned
+	QR_TARGET("sse2")
+	__m128i IsBetweenSSE2(__m128i characters, std::uint8_t first, std::uint8_t last)
+	{
+		__m128i offsets = _mm_sub_epi8(characters, _mm_set1_epi8(static_cast<char>(first)));
+
+		return _mm_cmpeq_epi8(_mm_min_epu8(offsets, _mm_set1_epi8(static_cast<char>(last - first))), offsets);
+	}
+
+	//Same ranges as Tables::CHARACTER_TABLE: digits, uppercase letters and " $%*+-./:" are strictly alphanumeric, lowercase letters only alphanumeric
+	QR_TARGET("sse2")
+	__m128i ClassifySSE2(__m128i characters)
+	{
+		__m128i numeric = IsBetweenSSE2(characters, 0x30, 0x39), strict = IsBetweenSSE2(characters, 0x41, 0x5A), alphanumeric;
+
+		strict = _mm_or_si128(strict, IsBetweenSSE2(characters, 0x30, 0x3A));
+		strict = _mm_or_si128(strict, IsBetweenSSE2(characters, 0x2D, 0x2F));
+		strict = _mm_or_si128(strict, IsBetweenSSE2(characters, 0x2A, 0x2B));
+		strict = _mm_or_si128(strict, IsBetweenSSE2(characters, 0x24, 0x25));
+		strict = _mm_or_si128(strict, _mm_cmpeq_epi8(characters, _mm_set1_epi8(0x20)));
+		alphanumeric = _mm_or_si128(strict, IsBetweenSSE2(characters, 0x61, 0x7A));
+
+		return _mm_or_si128(_mm_or_si128(_mm_and_si128(numeric, _mm_set1_epi8(QR::NUMERIC_CHARACTER)), _mm_and_si128(alphanumeric, _mm_set1_epi8(QR::ALPHANUMERIC_CHARACTER))),
+			_mm_and_si128(strict, _mm_set1_epi8(QR::STRICT_ALPHANUMERIC_CHARACTER)));
+	}
+
+	QR_TARGET("avx2")
+	__m256i IsBetweenAVX2(__m256i characters, std::uint8_t first, std::uint8_t last)
+	{
+		__m256i offsets = _mm256_sub_epi8(characters, _mm256_set1_epi8(static_cast<char>(first)));
+
+		return _mm256_cmpeq_epi8(_mm256_min_epu8(offsets, _mm256_set1_epi8(static_cast<char>(last - first))), offsets);
+	}
+
+	QR_TARGET("avx2")
+	__m256i ClassifyAVX2(__m256i characters)
+	{
+		__m256i numeric = IsBetweenAVX2(characters, 0x30, 0x39), strict = IsBetweenAVX2(characters, 0x41, 0x5A), alphanumeric;
+
+		strict = _mm256_or_si256(strict, IsBetweenAVX2(characters, 0x30, 0x3A));
+		strict = _mm256_or_si256(strict, IsBetweenAVX2(characters, 0x2D, 0x2F));
+		strict = _mm256_or_si256(strict, IsBetweenAVX2(characters, 0x2A, 0x2B));
+		strict = _mm256_or_si256(strict, IsBetweenAVX2(characters, 0x24, 0x25));
+		strict = _mm256_or_si256(strict, _mm256_cmpeq_epi8(characters, _mm256_set1_epi8(0x20)));
+		alphanumeric = _mm256_or_si256(strict, IsBetweenAVX2(characters, 0x61, 0x7A));
+
+		return _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(numeric, _mm256_set1_epi8(QR::NUMERIC_CHARACTER)), _mm256_and_si256(alphanumeric, _mm256_set1_epi8(QR::ALPHANUMERIC_CHARACTER))),
+			_mm256_and_si256(strict, _mm256_set1_epi8(QR::STRICT_ALPHANUMERIC_CHARACTER)));
+	}
+
+	//Kernels work on whole vectors from index first and return the index of the first byte they didn't handle
+	QR_TARGET("sse2")
+	size_t ClassifyCharactersSSE2(std::string_view characters, std::uint8_t *classes, size_t first)
+	{
+		for (; first + 16 <= characters.size(); first += 16)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(classes + first), ClassifySSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(characters.data() + first))));
+
+		return first;
+	}
+
+	QR_TARGET("avx2")
+	size_t ClassifyCharactersAVX2(std::string_view characters, std::uint8_t *classes, size_t first)
+	{
+		for (; first + 32 <= characters.size(); first += 32)
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(classes + first), ClassifyAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(characters.data() + first))));
+
+		return first;
+	}
+
+	//Stops at the first byte that doesn't have characterClass
+	QR_TARGET("sse2")
+	size_t FindUnclassifiedSSE2(std::string_view characters, std::uint8_t characterClass, size_t first)
+	{
+		__m128i required = _mm_set1_epi8(static_cast<char>(characterClass));
+
+		for (; first + 16 <= characters.size(); first += 16)
+		{
+			__m128i classes = ClassifySSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(characters.data() + first)));
+			unsigned matches = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(classes, required), required));
+
+			if (matches != 0xFFFF)
+				return first + std::countr_one(matches);
+		}
+
+		return first;
+	}
+
+	QR_TARGET("avx2")
+	size_t FindUnclassifiedAVX2(std::string_view characters, std::uint8_t characterClass, size_t first)
+	{
+		__m256i required = _mm256_set1_epi8(static_cast<char>(characterClass));
+
+		for (; first + 32 <= characters.size(); first += 32)
+		{
+			__m256i classes = ClassifyAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(characters.data() + first)));
+			auto matches = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(classes, required), required)));
+
+			if (matches != 0xFFFFFFFF)
+				return first + std::countr_one(matches);
+		}
+
+		return first;
+	}
+	#endif
+}
+
+namespace QR
+{
+	void ClassifyCharacters(std::string_view characters, std::span<std::uint8_t> classes)
+	{
+		ClassifyCharacters(characters, classes, GetSimdLevel());
+	}
+
+	void ClassifyCharacters(std::string_view characters, std::span<std::uint8_t> classes, SimdLevel level)
+	{
+		size_t i = 0;
+
+		#ifdef QR_X86
+		//Every CPU with SSSE3 has SSE2
+		if (level == SimdLevel::AVX2)
+			i = ClassifyCharactersAVX2(characters, classes.data(), i);
+
+		if (level != SimdLevel::NONE)
+			i = ClassifyCharactersSSE2(characters, classes.data(), i);
+		#endif
+
+		for (; i < characters.size(); ++i)
+			classes[i] = GetCharacterClass(characters[i]);
+	}
+
+	size_t FindUnclassified(std::string_view characters, std::uint8_t characterClass)
+	{
+		return FindUnclassified(characters, characterClass, GetSimdLevel());
+	}
+
+	size_t FindUnclassified(std::string_view characters, std::uint8_t characterClass, SimdLevel level)
+	{
+		size_t i = 0;
+
+		#ifdef QR_X86
+		if (level == SimdLevel::AVX2)
+			i = FindUnclassifiedAVX2(characters, characterClass, i);
+
+		if (level != SimdLevel::NONE)
+			i = FindUnclassifiedSSE2(characters, characterClass, i);
+		#endif
+
+		return i + FindUnclassifiedScalar(characters.substr(i), characterClass);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,191 @@
+#ifndef CHARACTERCLASSES_H
+#define CHARACTERCLASSES_H
+#include "BitStream.h"
+#include "SimdLevel.h"
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+namespace QR
+{
+	//Flags for the modes a single byte can be encoded in, from tables 5 and 6. Lowercase letters are alphanumeric, the same as in addCharacters, but only
+	//STRICT_ALPHANUMERIC_CHARACTER ones are read back unchanged, since table 5 only has uppercase letters.
+	//Kanji characters take two bytes, so they don't have a flag.
+	enum CharacterClass : std::uint8_t { NUMERIC_CHARACTER = 1, ALPHANUMERIC_CHARACTER = 2, STRICT_ALPHANUMERIC_CHARACTER = 4 };
+
+	namespace Tables
+	{
+		struct CharacterTable
+		{
+			std::array<std::uint8_t, 256> mClasses;
+			std::array<std::uint8_t, 256> mAlphanumericValues;
+		};
+
+		constexpr CharacterTable BuildCharacterTable()
+		{
+			CharacterTable result{};
+			std::string_view specialCharacters = " $%*+-./:";
+
+			for (std::uint8_t i = 0; i < 10; ++i)
+				result.mClasses[0x30 + i] = NUMERIC_CHARACTER | ALPHANUMERIC_CHARACTER | STRICT_ALPHANUMERIC_CHARACTER, result.mAlphanumericValues[0x30 + i] = i;
+
+			for (std::uint8_t i = 0; i < 26; ++i)
+			{
+				result.mClasses[0x41 + i] = ALPHANUMERIC_CHARACTER | STRICT_ALPHANUMERIC_CHARACTER, result.mAlphanumericValues[0x41 + i] = 10 + i;
+				result.mClasses[0x61 + i] = ALPHANUMERIC_CHARACTER, result.mAlphanumericValues[0x61 + i] = 10 + i;
+			}
+
+			for (std::uint8_t i = 0; i < specialCharacters.size(); ++i)
+			{
+				auto character = static_cast<std::uint8_t>(specialCharacters[i]);
+
+				result.mClasses[character] = ALPHANUMERIC_CHARACTER | STRICT_ALPHANUMERIC_CHARACTER, result.mAlphanumericValues[character] = 36 + i;
+			}
+
+			return result;
+		}
+
+		inline constexpr CharacterTable CHARACTER_TABLE = BuildCharacterTable();
+	}
+
+	constexpr std::uint8_t GetCharacterClass(char character)
+	{
+		return Tables::CHARACTER_TABLE.mClasses[static_cast<std::uint8_t>(character)];
+	}
+
+	//Value from table 5, page 27. character must be alphanumeric
+	constexpr std::uint8_t GetAlphanumericValue(char character)
+	{
+		return Tables::CHARACTER_TABLE.mAlphanumericValues[static_cast<std::uint8_t>(character)];
+	}
+
+	//character holds the leading byte in its high byte and the trailer byte in its low byte, from section 7.4.6
+	constexpr bool IsKanji(std::uint16_t character)
+	{
+		std::uint8_t leadingByte = character >> 8, trailerByte = character & 0xFF;
+
+		return (leadingByte >= 0x81 && leadingByte <= 0x9F || leadingByte >= 0xE0 && leadingByte <= 0xEA)
+			&& (trailerByte >= 0x40 && trailerByte <= 0x7E || trailerByte >= 0x80 && trailerByte <= 0xFC)
+			|| leadingByte == 0xEB && (trailerByte >= 0x40 && trailerByte <= 0x7E || trailerByte >= 0x80 && trailerByte <= 0xBF);
+	}
+
+	//Value of the ECI designator that starts at message[index], a backslash and 6 characters. Parsed like std::stoul does: leading whitespace and a sign
+	//are allowed, and parsing stops at the first character that isn't a digit
+	constexpr unsigned GetECIDesignator(std::string_view message, size_t index)
+	{
+		auto designator = message.substr(index + 1, 6);
+		unsigned result = 0;
+		size_t i = 0;
+		bool negative = false;
+
+		if (designator.size() != 6 || designator.find(0x5C) != std::string_view::npos)
+			throw std::invalid_argument("Invalid ECI sequence");
+
+		while (i < designator.size() && (designator[i] == 0x20 || designator[i] >= 0x09 && designator[i] <= 0x0D))
+			++i;
+
+		if (i < designator.size() && (designator[i] == 0x2B || designator[i] == 0x2D))
+			negative = designator[i++] == 0x2D;
+
+		if (i == designator.size() || !(GetCharacterClass(designator[i]) & NUMERIC_CHARACTER))
+			throw std::invalid_argument("Invalid ECI sequence");
+
+		for (; i < designator.size() && GetCharacterClass(designator[i]) & NUMERIC_CHARACTER; ++i)
+			result = result * 10 + (designator[i] - 0x30);
+
+		return negative ? 0u - result : result;
+	}
+
+	//Index of the first ECI sequence at or after index, or message.size(). Double backslashes are skipped
+	constexpr size_t FindECISequence(std::string_view message, size_t index)
+	{
+		for (index = message.find(0x5C, index); index != std::string_view::npos; index = message.find(0x5C, index + 2))
+			if (index + 1 == message.size() || message[index + 1] != 0x5C)
+				return index;
+
+		return message.size();
+	}
+
+	//Writes the class of every byte of characters into classes, which must be as long. Uses the best SIMD level supported by the CPU
+	void ClassifyCharacters(std::string_view characters, std::span<std::uint8_t> classes);
+	void ClassifyCharacters(std::string_view characters, std::span<std::uint8_t> classes, SimdLevel level);
+	//Index of the first byte whose class doesn't have every flag in characterClass, characters.size() if every byte has them
+	size_t FindUnclassified(std::string_view characters, std::uint8_t characterClass);
+	size_t FindUnclassified(std::string_view characters, std::uint8_t characterClass, SimdLevel level);
+
+	//FindUnclassified without SIMD, so it can run at compile time
+	constexpr size_t FindUnclassifiedScalar(std::string_view characters, std::uint8_t characterClass)
+	{
+		size_t i = 0;
+
+		while (i < characters.size() && (GetCharacterClass(characters[i]) & characterClass) == characterClass)
+			++i;
+
+		return i;
+	}
+
+	//Appends digit triplets as 10 bits and the remaining 1 or 2 digits as 4 or 7 bits, from section 7.4.3. digits must be numeric.
+	//Stream is BitStream or FixedBitStream
+	template<typename Stream>
+	constexpr void AppendNumeric(Stream &stream, std::string_view digits)
+	{
+		auto getTripletValue = [&digits](size_t i) {
+			return static_cast<std::uint16_t>((digits[i] - 0x30) * 100 + (digits[i + 1] - 0x30) * 10 + (digits[i + 2] - 0x30));
+		};
+		size_t i = 0;
+
+		stream.reserve(stream.size() + digits.size() / 3 * 10 + 7);
+
+		//Six triplets fill 60 bits, so they are appended at once
+		for (; i + 18 <= digits.size(); i += 18)
+		{
+			std::uint64_t bits = 0;
+
+			for (size_t j = i; j < i + 18; j += 3)
+				bits = bits << 10 | getTripletValue(j);
+
+			stream.append(bits, 60);
+		}
+
+		for (; i + 3 <= digits.size(); i += 3)
+			stream.append(getTripletValue(i), 10);
+
+		if (digits.size() - i == 2)
+			stream.append((digits[i] - 0x30) * 10u + (digits[i + 1] - 0x30), 7);
+		else
+			if (digits.size() - i == 1)
+				stream.append(digits[i] - 0x30u, 4);
+	}
+
+	//Appends character pairs as 11 bits and the last odd character as 6 bits, from section 7.4.4. characters must be alphanumeric
+	template<typename Stream>
+	constexpr void AppendAlphanumeric(Stream &stream, std::string_view characters)
+	{
+		auto getPairValue = [&characters](size_t i) { return GetAlphanumericValue(characters[i]) * 45u + GetAlphanumericValue(characters[i + 1]); };
+		size_t i = 0;
+
+		stream.reserve(stream.size() + characters.size() / 2 * 11 + 6);
+
+		//Five pairs fill 55 bits
+		for (; i + 10 <= characters.size(); i += 10)
+		{
+			std::uint64_t bits = 0;
+
+			for (size_t j = i; j < i + 10; j += 2)
+				bits = bits << 11 | getPairValue(j);
+
+			stream.append(bits, 55);
+		}
+
+		for (; i + 2 <= characters.size(); i += 2)
+			stream.append(getPairValue(i), 11);
+
+		if (i < characters.size())
+			stream.append(GetAlphanumericValue(characters[i]), 6);
+	}
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,570 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+#include <array>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <stdexcept>
+#include <algorithm>
+#include <bit>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include "QREncoder.h"
+#include "BitStream.h"
+#include "SymbolTables.h"
+#include "CharacterClasses.h"
+
+//Encoding steps Encoder and FixedEncoder share. They are templates over the bit stream and row types, and constexpr so FixedEncoder can run them
+//at compile time
+namespace QR
+{
+	//Up to WordCount * 64 modules of a symbol row. Bit p is the module in column p
+	template<size_t WordCount>
+	struct PackedRow
+	{
+		static constexpr size_t WORD_COUNT = WordCount;
+		std::array<std::uint64_t, WordCount> mWords = {};
+
+		constexpr PackedRow() = default;
+
+		//wordCount must not be greater than WordCount
+		constexpr PackedRow(const std::uint64_t *words, size_t wordCount)
+		{
+			std::copy(words, words + wordCount, mWords.begin());
+		}
+
+		//Bits [0, count) set
+		static constexpr PackedRow GetPrefix(size_t count)
+		{
+			PackedRow result;
+
+			for (size_t i = 0; i < WordCount; ++i)
+				if (count >= (i + 1) * 64)
+					result.mWords[i] = ~std::uint64_t{ 0 };
+				else
+					if (count > i * 64)
+						result.mWords[i] = (std::uint64_t{ 1 } << (count - i * 64)) - 1;
+
+			return result;
+		}
+
+		//Bit p of the result is bit p + shift of this row. shift must be lower than 64
+		constexpr PackedRow next(unsigned shift) const
+		{
+			PackedRow result;
+
+			for (size_t i = 0; i < WordCount; ++i)
+				result.mWords[i] = mWords[i] >> shift | (shift && i + 1 < WordCount ? mWords[i + 1] << (64 - shift) : 0);
+
+			return result;
+		}
+
+		//Bit p of the result is bit p - shift of this row. shift must be lower than 64
+		constexpr PackedRow previous(unsigned shift) const
+		{
+			PackedRow result;
+
+			for (size_t i = 0; i < WordCount; ++i)
+				result.mWords[i] = mWords[i] << shift | (shift && i ? mWords[i - 1] >> (64 - shift) : 0);
+
+			return result;
+		}
+
+		constexpr unsigned count() const
+		{
+			unsigned result = 0;
+
+			for (auto word : mWords)
+				result += std::popcount(word);
+
+			return result;
+		}
+
+		constexpr PackedRow operator&(const PackedRow &other) const
+		{
+			PackedRow result;
+
+			for (size_t i = 0; i < WordCount; ++i)
+				result.mWords[i] = mWords[i] & other.mWords[i];
+
+			return result;
+		}
+
+		constexpr PackedRow operator|(const PackedRow &other) const
+		{
+			PackedRow result;
+
+			for (size_t i = 0; i < WordCount; ++i)
+				result.mWords[i] = mWords[i] | other.mWords[i];
+
+			return result;
+		}
+
+		constexpr PackedRow operator^(const PackedRow &other) const
+		{
+			PackedRow result;
+
+			for (size_t i = 0; i < WordCount; ++i)
+				result.mWords[i] = mWords[i] ^ other.mWords[i];
+
+			return result;
+		}
+
+		constexpr PackedRow operator~() const
+		{
+			PackedRow result;
+
+			for (size_t i = 0; i < WordCount; ++i)
+				result.mWords[i] = ~mWords[i];
+
+			return result;
+		}
+	};
+
+	//Returns the positions where the feature 3 pattern is completed while scanning row from module 0
+	template<size_t WordCount>
+	constexpr PackedRow<WordCount> GetFeature3Matches(const PackedRow<WordCount> &row, size_t width)
+	{
+		PackedRow<WordCount> result;
+		unsigned state = 0;
+
+		for (size_t byteIndex = 0, byteCount = (width + 7) / 8; byteIndex < byteCount; ++byteIndex)
+		{
+			auto word = byteIndex / 8, shift = byteIndex % 8 * 8;
+			auto &transition = Tables::FEATURE3_TRANSITIONS[state][row.mWords[word] >> shift & 0xFF];
+
+			result.mWords[word] |= std::uint64_t{ transition.mMatches } << shift;
+			state = transition.mState;
+		}
+
+		return result & PackedRow<WordCount>::GetPrefix(width);
+	}
+
+	//Feature 1 points of a row. A run of n >= 5 modules is worth n - 2 points: one for every 5 module window inside it plus 2 for the first one
+	template<size_t WordCount>
+	constexpr unsigned GetFeature1Score(const PackedRow<WordCount> &row, size_t width)
+	{
+		PackedRow<WordCount> equal = ~(row ^ row.next(1)) & PackedRow<WordCount>::GetPrefix(width - 1);
+		PackedRow<WordCount> fiveEqual = equal & equal.next(1) & equal.next(2) & equal.next(3);
+
+		return fiveEqual.count() + (fiveEqual & ~equal.previous(1)).count() * 2;
+	}
+
+	//Feature 4 points of a QR symbol with darkModules dark modules out of size * size
+	constexpr unsigned GetFeature4Score(size_t darkModules, size_t size)
+	{
+		int percentage = static_cast<int>(static_cast<double>(darkModules) / static_cast<double>(size * size) * 100.);
+
+		return (percentage < 50 ? 50 - percentage : percentage - 50) / 5 * 10;
+	}
+
+	//Adds features 1, 2 and 3 of every row of a QR symbol to score, and of every column unless columns is empty. lightRows are the rows inverted,
+	//with the bits past the symbol cleared. Stops as soon as score reaches bound and returns what it got so far
+	template<size_t WordCount>
+	constexpr unsigned AddRowFeatureScores(std::span<const PackedRow<WordCount>> rows, std::span<const PackedRow<WordCount>> columns,
+		std::span<const PackedRow<WordCount>> lightRows, unsigned score, unsigned bound)
+	{
+		size_t size = rows.size();
+
+		for (size_t i = 0; i < size && score < bound; ++i)
+		{
+			PackedRow<WordCount> rowCandidates, columnCandidates;
+
+			//Feature 1
+			score += GetFeature1Score(rows[i], size) + (columns.empty() ? 0 : GetFeature1Score(columns[i], size));
+
+			//Feature 2
+			if (i + 1 < size)
+			{
+				PackedRow<WordCount> verticalEqual = ~(rows[i] ^ rows[i + 1]);
+
+				score += (verticalEqual & verticalEqual.next(1) & ~(rows[i] ^ rows[i].next(1)) & PackedRow<WordCount>::GetPrefix(size - 1)).count() * 3;
+			}
+
+			//Feature 3. Rows need 4 light modules right after the pattern or 4 light modules right before it.
+			rowCandidates = lightRows[i].next(1) & lightRows[i].next(2) & lightRows[i].next(3) & lightRows[i].next(4) |
+				lightRows[i].previous(7) & lightRows[i].previous(8) & lightRows[i].previous(9) & lightRows[i].previous(10);
+
+			//The check for columns looks at the rows after and before the column index instead
+			if (i + 4 < size)
+				columnCandidates = lightRows[i + 1] & lightRows[i + 2] & lightRows[i + 3] & lightRows[i + 4];
+
+			if (i >= 10)
+				columnCandidates = columnCandidates | lightRows[i - 7] & lightRows[i - 8] & lightRows[i - 9] & lightRows[i - 10];
+
+			score += (GetFeature3Matches(rows[i], size) & rowCandidates).count() * 40;
+
+			if (!columns.empty())
+				score += (GetFeature3Matches(columns[i], size) & columnCandidates).count() * 40;
+		}
+
+		return score;
+	}
+
+	//Score of a Micro QR symbol from the dark modules of its right column and bottom row, section 7.8.3.2. isDark(row, column) reads a module
+	template<typename Predicate>
+	constexpr unsigned GetMicroQRSymbolRating(size_t size, Predicate isDark)
+	{
+		unsigned darkRow = 0, darkColumn = 0;
+
+		//Start at 1 to avoid timing pattern
+		for (size_t i = 1; i < size; ++i)
+		{
+			if (isDark(i, size - 1))
+				++darkColumn;
+
+			if (isDark(size - 1, i))
+				++darkRow;
+		}
+
+		return darkColumn <= darkRow ? darkColumn * 16 + darkRow : darkRow * 16 + darkColumn;
+	}
+
+	//Calls setModule(row, column, value) for every format information module, figure 25, page 55
+	template<typename Function>
+	constexpr void DrawFormatInformation(SymbolType type, std::uint8_t version, ErrorCorrectionLevel level, size_t maskId, Function setModule)
+	{
+		auto formatInfo = GetFormatInformation(type, version, level, maskId);
+		unsigned timingPatternRowColumn = type == SymbolType::MICRO_QR ? 0 : 6, symbolSize = GetSymbolSize(type, version), bitIndex = 0;
+
+		for (unsigned i = 0; i < 8; ++i)
+			if (i != timingPatternRowColumn)
+				setModule(i, 8, formatInfo >> bitIndex++ & 1);
+
+		for (unsigned i = 9; i--;)
+			if (i != timingPatternRowColumn)
+				setModule(8, i, formatInfo >> bitIndex++ & 1);
+
+		if (type == SymbolType::QR)
+		{
+			setModule(symbolSize - 8, 8, true); //This module is always dark
+
+			for (bitIndex = 0; bitIndex < 15; ++bitIndex)
+				if (bitIndex <= 7)
+					setModule(8, symbolSize - 1 - bitIndex, formatInfo >> bitIndex & 1);
+				else
+					setModule(symbolSize - 15 + bitIndex, 8, formatInfo >> bitIndex & 1);
+		}
+	}
+
+	//Calls placeModule(row, column) for every data and error correction module, in the order codeword bits are placed. From figure 13, page 47.
+	//isFunctionModule(row, column) tells which modules belong to function patterns or format/version information
+	template<typename Predicate, typename Function>
+	constexpr void WalkPlacementOrder(SymbolType type, std::uint8_t version, Predicate isFunctionModule, Function placeModule)
+	{
+		int size = GetSymbolSize(type, version), currentRow = size - 1, currentColumn = currentRow, delta = -1;
+		size_t moduleCount = GetDataModuleCount(type, version), placed = 0;
+
+		while (placed < moduleCount && currentColumn >= 0)
+		{
+			if (!isFunctionModule(currentRow, currentColumn))
+				placeModule(currentRow, currentColumn), ++placed;
+
+			if (type == SymbolType::MICRO_QR && currentColumn % 2 ||
+				type == SymbolType::QR && currentColumn > 6 && currentColumn % 2 ||
+				type == SymbolType::QR && currentColumn < 6 && !(currentColumn % 2))
+			{
+				if (!currentRow && delta != 1)
+					delta = 1, currentColumn -= 2;
+				else
+					if (currentRow == size - 1 && delta != -1)
+						delta = -1, currentColumn -= 2;
+					else
+						currentRow += delta;
+
+				++currentColumn;
+
+				if (currentColumn == 6 && type != SymbolType::MICRO_QR)
+					currentColumn = 5;
+			}
+			else
+				--currentColumn;
+		}
+	}
+
+	//Bit j of row i is module (i, j) of the pattern
+	inline constexpr std::array<std::uint8_t, 7> FINDER_PATTERN = { 0x7F, 0x41, 0x5D, 0x5D, 0x5D, 0x41, 0x7F };
+	inline constexpr std::array<std::uint8_t, 5> ALIGNMENT_PATTERN = { 0x1F, 0x11, 0x15, 0x11, 0x1F };
+
+	//Calls function(row, column) for the top left corner of every alignment pattern, the ones that would overlap a finder pattern left out
+	template<typename Function>
+	constexpr void ForEachAlignmentPattern(std::uint8_t version, Function function)
+	{
+		auto centers = GetAlignmentPatternCenters(version);
+		unsigned size = GetSymbolSize(SymbolType::QR, version);
+
+		for (unsigned centerRow : centers)
+			for (unsigned centerColumn : centers)
+				if (!(centerRow == 6 && centerColumn == size - 7 || centerRow == size - 7 && centerColumn == 6 || centerRow == 6 && centerColumn == 6))
+					function(centerRow - 2, centerColumn - 2);
+	}
+
+	//Calls fillRectangle(firstRow, firstColumn, lastRow, lastColumn) for every area taken by function patterns or format/version information,
+	//the modules GetDataRegionMask sets. Areas can overlap
+	template<typename Function>
+	constexpr void ForEachFunctionArea(SymbolType type, std::uint8_t version, Function fillRectangle)
+	{
+		unsigned size = GetSymbolSize(type, version), timingRowColumn = type == SymbolType::MICRO_QR ? 0 : 6;
+
+		//Top left finder pattern and format information
+		fillRectangle(0, 0, 8, 8);
+
+		//Timing patterns
+		fillRectangle(timingRowColumn, 0, timingRowColumn, size - 1);
+		fillRectangle(0, timingRowColumn, size - 1, timingRowColumn);
+
+		if (type == SymbolType::QR)
+		{
+			//Top right and bottom left finder patterns, with their format information
+			fillRectangle(0, size - 8, 8, size - 1);
+			fillRectangle(size - 8, 0, size - 1, 8);
+
+			ForEachAlignmentPattern(version, [&fillRectangle](unsigned row, unsigned column) { fillRectangle(row, column, row + 4, column + 4); });
+
+			if (version >= 7)
+			{
+				fillRectangle(size - 11, 0, size - 9, 5);
+				fillRectangle(0, size - 11, 5, size - 9);
+			}
+		}
+	}
+
+	//Calls setDark(row, column) for every dark module of the finder, alignment and timing patterns
+	template<typename Function>
+	constexpr void DrawFunctionPatterns(SymbolType type, std::uint8_t version, Function setDark)
+	{
+		unsigned size = GetSymbolSize(type, version), timingRowColumn = type == SymbolType::MICRO_QR ? 0 : 6;
+		auto drawPattern = [&setDark](std::span<const std::uint8_t> pattern, unsigned row, unsigned column) {
+			for (unsigned i = 0; i < pattern.size(); ++i)
+				for (unsigned j = 0; j < pattern.size(); ++j)
+					if (pattern[i] >> j & 1)
+						setDark(row + i, column + j);
+		};
+
+		drawPattern(FINDER_PATTERN, 0, 0);
+
+		if (type == SymbolType::QR)
+		{
+			drawPattern(FINDER_PATTERN, 0, size - 7);
+			drawPattern(FINDER_PATTERN, size - 7, 0);
+			ForEachAlignmentPattern(version, [&drawPattern](unsigned row, unsigned column) { drawPattern(ALIGNMENT_PATTERN, row, column); });
+		}
+
+		for (unsigned i = 8; i < (type == SymbolType::MICRO_QR ? size : size - 8); i += 2)
+			setDark(i, timingRowColumn), setDark(timingRowColumn, i);
+	}
+
+	//Calls setModule(row, column, value) for every module of both copies of the version information, section 7.10. Versions below 7 have none
+	template<typename Function>
+	constexpr void DrawVersionInformation(SymbolType type, std::uint8_t version, Function setModule)
+	{
+		if (type != SymbolType::QR || version < 7)
+			return;
+
+		auto versionInformation = GetVersionInformation(version);
+		unsigned size = GetSymbolSize(type, version);
+
+		for (unsigned i = size - 11, j = 0, bitIndex = 0; bitIndex < 18; ++i, ++bitIndex)
+		{
+			if (!(bitIndex % 3) && bitIndex)
+				i -= 3, ++j;
+
+			setModule(i, j, versionInformation >> bitIndex & 1);
+			setModule(j, i, versionInformation >> bitIndex & 1);
+		}
+	}
+
+	//Modules [firstColumn, firstColumn + 64) of a row of mask pattern maskId, bit j for column firstColumn + j, with the columns from size on cleared.
+	//Function patterns aren't cleared. Every mask pattern repeats every 6 columns, so the first 6 bits are doubled until they fill the word
+	constexpr std::uint64_t GetMaskPatternWord(SymbolType type, std::uint8_t maskId, unsigned row, unsigned firstColumn, unsigned size)
+	{
+		std::uint64_t result = 0;
+
+		for (unsigned j = 0; j < 6; ++j)
+			result |= std::uint64_t{ GetMaskBit(type, maskId, row, firstColumn + j) } << j;
+
+		for (unsigned width = 6; width < 64; width *= 2)
+			result |= result << width;
+
+		return size - firstColumn >= 64 ? result : result & ((std::uint64_t{ 1 } << (size - firstColumn)) - 1);
+	}
+
+	//character is a single byte, or a Kanji character with its leading byte in the high byte
+	[[noreturn]] inline void ThrowInvalidCharacter(unsigned character, std::string_view modeName)
+	{
+		std::string digits;
+
+		do
+			digits.insert(digits.begin(), "0123456789ABCDEF"[character % 16]);
+		while (character /= 16);
+
+		throw std::invalid_argument("Character 0x" + digits + " can't be encoded in " + std::string(modeName) + " mode");
+	}
+
+	//Part of a message with its own mode indicator and character count indicator, see EncodeCharacters
+	struct SegmentInformation
+	{
+		size_t mCharacterCount;
+		bool mECI;
+	};
+
+	//Appends message to stream without checking the symbol's capacity. Stream is BitStream or FixedBitStream. If segments isn't null, it gets every part
+	//of message that got its own character count indicator.
+	//If an exception is thrown, stream may hold part of message.
+	template<typename Stream>
+	constexpr void EncodeCharacters(Stream &stream, const SymbolDescriptor &descriptor, std::string_view message, Mode mode, std::vector<SegmentInformation> *segments = nullptr)
+	{
+		auto findUnclassified = [](std::string_view characters, std::uint8_t characterClass) {
+			return std::is_constant_evaluated() ? FindUnclassifiedScalar(characters, characterClass) : FindUnclassified(characters, characterClass);
+		};
+		BitField modeIndicator = GetModeIndicator(descriptor.mType, descriptor.mVersion, mode);
+		size_t doubleSlashCount = 0, index = 0;
+		bool hasECI = false;
+		std::optional<unsigned> eci;
+
+		//Backslashes are rare, so escapes are checked before anything is encoded. Every count indicator needs the total number of double backslashes
+		for (size_t i = message.find(0x5C); i != std::string_view::npos; i = message.find(0x5C, i))
+			if (i + 1 < message.size() && message[i + 1] == 0x5C)
+				++doubleSlashCount, i += 2;
+			else
+				GetECIDesignator(message, i), hasECI = true, i += 7;
+
+		if (hasECI && descriptor.mType == SymbolType::MICRO_QR)
+			throw std::invalid_argument("ECI is not supported in Micro QR symbols");
+
+		if (FindECISequence(message, 0) == 0 && !message.empty())
+			eci = GetECIDesignator(message, 0), index = 7;
+
+		//Every ECI sequence starts a new segment
+		for (;;)
+		{
+			size_t end = FindECISequence(message, index), byteCount = end - index;
+			auto characterCount = GetCharacterCountIndicator(descriptor, mode, mode == Mode::KANJI ? byteCount / 2 : byteCount - doubleSlashCount);
+
+			if (segments)
+				segments->push_back({ mode == Mode::KANJI ? byteCount / 2 : byteCount - doubleSlashCount, eci.has_value() });
+
+			if (mode == Mode::KANJI && byteCount % 2)
+				throw std::invalid_argument("Invalid Kanji sequence");
+
+			if (eci)
+				stream.append(GetECISequence(eci.value()));
+
+			stream.append(modeIndicator);
+			stream.append(characterCount);
+
+			switch (mode)
+			{
+				case Mode::NUMERIC:
+				{
+					auto digits = message.substr(index, byteCount);
+
+					if (auto invalid = findUnclassified(digits, NUMERIC_CHARACTER); invalid != digits.size())
+						ThrowInvalidCharacter(static_cast<std::uint8_t>(digits[invalid]), "numeric");
+
+					AppendNumeric(stream, digits);
+					break;
+				}
+
+				case Mode::ALPHANUMERIC:
+				{
+					if (descriptor.mType == SymbolType::MICRO_QR && descriptor.mVersion < 2)
+						throw std::invalid_argument("Alphanumeric mode is not supported in M1 symbols");
+
+					auto characters = message.substr(index, byteCount);
+
+					if (auto invalid = findUnclassified(characters, ALPHANUMERIC_CHARACTER); invalid != characters.size())
+						ThrowInvalidCharacter(static_cast<std::uint8_t>(characters[invalid]), "alphanumeric");
+
+					AppendAlphanumeric(stream, characters);
+					break;
+				}
+
+				case Mode::BYTE:
+				{
+					if (descriptor.mType == SymbolType::MICRO_QR && descriptor.mVersion < 3)
+						throw std::invalid_argument("Byte mode is not supported in M1 and M2 symbols");
+
+					//Copy whole runs between backslashes, the second backslash of each pair is skipped
+					for (size_t i = index; i < end;)
+					{
+						auto runEnd = std::min(message.find(0x5C, i), end - 1) + 1;
+
+						stream.appendBytes(message.substr(i, runEnd - i));
+						i = message[runEnd - 1] == 0x5C ? runEnd + 1 : runEnd;
+					}
+
+					break;
+				}
+
+				case Mode::KANJI:
+				{
+					if (descriptor.mType == SymbolType::MICRO_QR && descriptor.mVersion < 3)
+						throw std::invalid_argument("Kanji mode is not supported in M1 and M2 symbols");
+
+					for (size_t i = index; i < end; i += 2)
+					{
+						std::uint16_t kanjiCharacter = static_cast<std::uint8_t>(message[i]) << 8 | static_cast<std::uint8_t>(message[i + 1]);
+
+						if (!IsKanji(kanjiCharacter))
+							ThrowInvalidCharacter(kanjiCharacter, "Kanji");
+
+						if (kanjiCharacter >= 0x8140 && kanjiCharacter <= 0x9FFC)
+							kanjiCharacter -= 0x8140;
+						else
+							if (kanjiCharacter >= 0xE040 && kanjiCharacter <= 0xEBBF)
+								kanjiCharacter -= 0xC140;
+
+						stream.append((kanjiCharacter >> 8) * 0xC0 + (kanjiCharacter & 0xFF), 13);
+					}
+
+					break;
+				}
+			}
+
+			if (end == message.size())
+				break;
+
+			eci = GetECIDesignator(message, end);
+			index = end + 7;
+		}
+	}
+
+	//Adds the terminator and pad codewords up to the capacity of the symbol described by descriptor. stream must fit in it
+	template<typename Stream>
+	constexpr void AppendPadding(Stream &stream, const SymbolDescriptor &descriptor)
+	{
+		auto terminator = GetTerminator(descriptor.mType, descriptor.mVersion);
+		unsigned dataModuleCount = descriptor.mDataBitCapacity;
+
+		stream.append(0, static_cast<unsigned>(std::min<size_t>(dataModuleCount - stream.size(), terminator.mLength)));
+
+		if (stream.size() < dataModuleCount && stream.size() % 8)
+		{
+			stream.resize(stream.size() - stream.size() % 8 + 8);
+
+			//If I got past the limit after resizing to an 8 bit boundary, then it must be because of the 4 bit codeword in M1 or M3 symbols
+			if (stream.size() > dataModuleCount)
+				stream.resize(dataModuleCount);
+		}
+
+		if (stream.size() < dataModuleCount)
+		{
+			std::array<BitField, 2> padCodewords = { { { 0b11101100, 8 }, { 0b00010001, 8 } } };
+			size_t counter = 0, padCodewordCount = 2;
+
+			if (descriptor.mType == SymbolType::MICRO_QR && (descriptor.mVersion == 1 || descriptor.mVersion == 3))
+				padCodewords[0] = { 0b0000, 4 }, padCodewordCount = 1; //Pad codeword for M1 and M3
+
+			stream.reserve(dataModuleCount);
+
+			while (stream.size() < dataModuleCount)
+				stream.append(padCodewords[counter++ % padCodewordCount]);
+		}
+	}
+}
+
+#endif
\ No newline at end of file
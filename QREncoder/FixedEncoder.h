@@ -0,0 +1,491 @@
+#ifndef FIXEDENCODER_H
+#define FIXEDENCODER_H
+#include <array>
+#include <span>
+#include <string_view>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <bit>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include "QREncoder.h"
+#include "BitStream.h"
+#include "BitMatrix.h"
+#include "ReedSolomon.h"
+#include "SymbolTables.h"
+#include "CharacterClasses.h"
+#include "Encoding.h"
+
+namespace QR
+{
+	//Same layout as BitStream, in an array of Capacity bits instead of a vector. Appending past Capacity only grows size() and drops the bits,
+	//so callers can check size() against their capacity afterwards like Encoder does.
+	template<size_t Capacity>
+	class FixedBitStream
+	{
+	public:
+		using WordType = std::uint64_t;
+		static constexpr unsigned WORD_BITS = 64;
+	private:
+		std::array<WordType, (Capacity + WORD_BITS - 1) / WORD_BITS> mWords = {};
+		size_t mSize = 0;
+	public:
+		//Appends the bitCount least significant bits of value. bitCount must not be greater than 64
+		constexpr void append(std::uint64_t value, unsigned bitCount)
+		{
+			unsigned offset = mSize % WORD_BITS, freeBits = WORD_BITS - offset;
+
+			if (!bitCount || mSize + bitCount > Capacity)
+			{
+				mSize += bitCount;
+				return;
+			}
+
+			if (bitCount < WORD_BITS)
+				value &= (WordType{ 1 } << bitCount) - 1;
+
+			if (bitCount <= freeBits)
+				mWords[mSize / WORD_BITS] |= value << (freeBits - bitCount);
+			else
+			{
+				mWords[mSize / WORD_BITS] |= value >> (bitCount - freeBits);
+				mWords[mSize / WORD_BITS + 1] = value << (WORD_BITS - (bitCount - freeBits));
+			}
+
+			mSize += bitCount;
+		}
+
+		constexpr void append(BitField field)
+		{
+			append(field.mValue, field.mLength);
+		}
+
+		//Appends every byte in bytes, 8 bits each
+		constexpr void appendBytes(std::string_view bytes)
+		{
+			for (char byte : bytes)
+				append(static_cast<std::uint8_t>(byte), 8);
+		}
+
+		//Reads bitCount bits starting at position. Bits past the end of the stream are read as 0
+		constexpr std::uint64_t read(size_t position, unsigned bitCount) const
+		{
+			std::uint64_t result = 0;
+			size_t word = position / WORD_BITS;
+			unsigned offset = position % WORD_BITS;
+
+			if (!bitCount)
+				return 0;
+
+			if (word < mWords.size())
+				result = mWords[word] << offset;
+
+			if (offset && offset + bitCount > WORD_BITS && word + 1 < mWords.size())
+				result |= mWords[word + 1] >> (WORD_BITS - offset);
+
+			return result >> (WORD_BITS - bitCount);
+		}
+
+		//New bits are set to 0
+		constexpr void resize(size_t bitCount)
+		{
+			for (size_t word = bitCount / WORD_BITS; word < mWords.size() && word * WORD_BITS < mSize; ++word)
+				mWords[word] &= word == bitCount / WORD_BITS && bitCount % WORD_BITS ? ~WordType{ 0 } << (WORD_BITS - bitCount % WORD_BITS) : 0;
+
+			mSize = bitCount;
+		}
+
+		//Nothing to allocate, kept so EncodeCharacters and AppendPadding work with either stream
+		constexpr void reserve(size_t)
+		{}
+
+		constexpr void clear()
+		{
+			resize(0);
+		}
+
+		constexpr size_t size() const
+		{
+			return mSize;
+		}
+
+		//index must be lower than Capacity
+		constexpr bool operator[](size_t index) const
+		{
+			return mWords[index / WORD_BITS] >> (WORD_BITS - 1 - index % WORD_BITS) & 1;
+		}
+	};
+
+	//Symbol generated by FixedEncoder, without its quiet zone. Bit j of mRows[i] is the module in row i and column j, rows past mSize are empty
+	template<size_t MaxSize>
+	struct FixedSymbol
+	{
+		std::array<std::uint64_t, MaxSize> mRows;
+		unsigned mSize;
+		SymbolType mType;
+		unsigned mMaskId;
+
+		constexpr bool get(size_t row, size_t column) const
+		{
+			return mRows[row] >> column & 1;
+		}
+
+		//Same matrix Encoder::generateMatrixPacked returns, quiet zone included
+		BitMatrix toBitMatrix() const
+		{
+			unsigned quietZoneWidth = mType == SymbolType::MICRO_QR ? 2 : 4;
+			BitMatrix result(mSize + quietZoneWidth * 2, mSize + quietZoneWidth * 2);
+
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				BitMatrix::WordType *row = result.getRow(i + quietZoneWidth);
+
+				row[0] |= mRows[i] << quietZoneWidth;
+
+				if (mSize + quietZoneWidth > BitMatrix::WORD_BITS)
+					row[1] |= mRows[i] >> (BitMatrix::WORD_BITS - quietZoneWidth);
+			}
+
+			return result;
+		}
+
+		friend bool operator==(const FixedSymbol &, const FixedSymbol &) = default;
+	};
+
+	//Compile time versions of what Encoder builds per version at run time, and the helpers FixedEncoder shares between versions
+	namespace Fixed
+	{
+		template<size_t Size>
+		using Rows = std::array<std::uint64_t, Size>;
+
+		struct ModulePosition
+		{
+			std::uint8_t mRow;
+			std::uint8_t mColumn;
+		};
+
+		//Bits [0, count) set
+		constexpr std::uint64_t GetPrefix(size_t count)
+		{
+			return count >= 64 ? ~std::uint64_t{ 0 } : (std::uint64_t{ 1 } << count) - 1;
+		}
+
+		template<size_t Size>
+		constexpr void SetModule(Rows<Size> &rows, size_t row, size_t column, bool value)
+		{
+			rows[row] = rows[row] & ~(std::uint64_t{ 1 } << column) | std::uint64_t{ value } << column;
+		}
+
+		//Sets every module in rows [firstRow, lastRow] and columns [firstColumn, lastColumn]
+		template<size_t Size>
+		constexpr void FillRectangle(Rows<Size> &rows, size_t firstRow, size_t firstColumn, size_t lastRow, size_t lastColumn)
+		{
+			for (size_t i = firstRow; i <= lastRow; ++i)
+				rows[i] |= GetPrefix(lastColumn + 1) & ~GetPrefix(firstColumn);
+		}
+
+		template<SymbolType Type, unsigned Version>
+		struct VersionTables
+		{
+			static constexpr unsigned SIZE = GetSymbolSize(Type, static_cast<std::uint8_t>(Version));
+			static constexpr unsigned MASK_COUNT = Type == SymbolType::MICRO_QR ? 4 : 8;
+			Rows<SIZE> mFunctionPatterns; //Finder, alignment and timing patterns
+			Rows<SIZE> mVersionInformation; //Empty for versions below 7
+			std::array<Rows<SIZE>, MASK_COUNT> mMaskPatterns; //Cleared over function patterns and format/version information
+			std::array<ModulePosition, GetDataModuleCount(Type, static_cast<std::uint8_t>(Version))> mPlacementOrder;
+		};
+
+		//Same modules as the symbol template, mask patterns and placement order Encoder builds for this version, from the same builders
+		template<SymbolType Type, unsigned Version>
+		constexpr VersionTables<Type, Version> BuildVersionTables()
+		{
+			constexpr unsigned size = VersionTables<Type, Version>::SIZE;
+			VersionTables<Type, Version> result{};
+			Rows<size> dataRegionMask{}; //Same modules as GetDataRegionMask
+			size_t moduleIndex = 0;
+
+			DrawFunctionPatterns(Type, Version, [&result](unsigned row, unsigned column) { SetModule(result.mFunctionPatterns, row, column, true); });
+			DrawVersionInformation(Type, Version, [&result](unsigned row, unsigned column, bool value) { SetModule(result.mVersionInformation, row, column, value); });
+			ForEachFunctionArea(Type, Version, [&dataRegionMask](unsigned firstRow, unsigned firstColumn, unsigned lastRow, unsigned lastColumn) {
+				FillRectangle(dataRegionMask, firstRow, firstColumn, lastRow, lastColumn);
+			});
+
+			for (unsigned maskId = 0; maskId < result.mMaskPatterns.size(); ++maskId)
+				for (unsigned i = 0; i < size; ++i)
+					result.mMaskPatterns[maskId][i] = GetMaskPatternWord(Type, static_cast<std::uint8_t>(maskId), i, 0, size) & ~dataRegionMask[i];
+
+			WalkPlacementOrder(Type, Version, [&dataRegionMask](int row, int column) { return dataRegionMask[row] >> column & 1; }, [&](int row, int column) {
+				result.mPlacementOrder[moduleIndex++] = { static_cast<std::uint8_t>(row), static_cast<std::uint8_t>(column) };
+			});
+
+			return result;
+		}
+
+		template<SymbolType Type, unsigned Version>
+		inline constexpr VersionTables<Type, Version> VERSION_TABLES = BuildVersionTables<Type, Version>();
+
+		//Bit j of the result's row i is bit i of rows[j]
+		template<size_t Size>
+		constexpr Rows<Size> Transpose(const Rows<Size> &rows)
+		{
+			std::array<std::uint64_t, 64> block = {};
+			Rows<Size> result;
+
+			std::copy(rows.begin(), rows.end(), block.begin());
+			TransposeBlock(block);
+			std::copy(block.begin(), block.begin() + Size, result.begin());
+
+			return result;
+		}
+
+		//GetSymbolRating with every feature, for symbols whose rows fit in a single word
+		template<SymbolType Type, size_t Size>
+		constexpr unsigned GetSymbolRating(const Rows<Size> &symbol, unsigned bound)
+		{
+			if constexpr (Type == SymbolType::QR)
+			{
+				Rows<Size> transposed = Transpose(symbol);
+				std::array<PackedRow<1>, Size> rows, columns, lightRows;
+				size_t darkModules = 0;
+				unsigned feature4Score;
+
+				for (size_t i = 0; i < Size; ++i)
+				{
+					darkModules += std::popcount(symbol[i]);
+					rows[i] = PackedRow<1>(&symbol[i], 1);
+					columns[i] = PackedRow<1>(&transposed[i], 1);
+					lightRows[i] = ~rows[i] & PackedRow<1>::GetPrefix(Size);
+				}
+
+				feature4Score = GetFeature4Score(darkModules, Size);
+
+				if (feature4Score >= bound)
+					return feature4Score;
+
+				return AddRowFeatureScores<1>(rows, columns, lightRows, feature4Score, bound);
+			}
+			else
+				return GetMicroQRSymbolRating(Size, [&symbol](size_t row, size_t column) { return symbol[row] >> column & 1; });
+		}
+	}
+
+	//Encoder for QR symbols up to version MaxVersion, or Micro QR symbols up to M<MaxVersion>, that keeps the bit stream, codeword blocks and symbol
+	//in arrays instead of heap allocations. Function patterns, mask patterns and placement order are built at compile time for every version, and
+	//the whole encoder is constexpr.
+	//Generates the same symbols as Encoder with MaskPolicy::EXHAUSTIVE. Every symbol row fits in a 64 bit word, so QR symbols only go up to version 11
+	template<SymbolType Type, unsigned MaxVersion>
+	class FixedEncoder
+	{
+		static_assert(MaxVersion && MaxVersion <= (Type == SymbolType::MICRO_QR ? 4 : 11), "FixedEncoder supports versions 1 to 11 and M1 to M4");
+	public:
+		static constexpr unsigned MAX_SIZE = GetSymbolSize(Type, MaxVersion);
+		static constexpr size_t MAX_DATA_BITS = GetDataModuleCount(Type, MaxVersion);
+	private:
+		FixedBitStream<MAX_DATA_BITS> mBitStream;
+		unsigned mVersion;
+		ErrorCorrectionLevel mLevel;
+
+		template<unsigned Version>
+		constexpr void generate(FixedSymbol<MAX_SIZE> &output) const
+		{
+			constexpr unsigned size = Fixed::VersionTables<Type, Version>::SIZE;
+			constexpr size_t codewordCount = (GetDataModuleCount(Type, Version) + 7) / 8;
+			constexpr bool shortLastCodeword = Type == SymbolType::MICRO_QR && (Version == 1 || Version == 3);
+			constexpr auto &tables = Fixed::VERSION_TABLES<Type, Version>;
+			const SymbolDescriptor &descriptor = GetSymbolDescriptor(Type, Version, mLevel);
+			FixedBitStream<MAX_DATA_BITS> dataBitStream = mBitStream;
+			std::array<std::uint8_t, codewordCount> data = {}, errorCorrection = {};
+			std::array<size_t, 2> dataOffsets = {}, errorCorrectionOffsets = {};
+			std::array<unsigned, tables.MASK_COUNT> scores = {};
+			Fixed::Rows<size> symbol = tables.mFunctionPatterns;
+			size_t bitIndex = 0, moduleIndex = 0, maxDataLength = 0;
+			unsigned maskId = 0;
+
+			AppendPadding(dataBitStream, descriptor);
+
+			//Split bit stream into blocks, interleaved per group like in Encoder, and generate their error correction codewords
+			for (size_t groupIndex = 0; groupIndex < descriptor.mBlockLayout.size(); ++groupIndex)
+			{
+				const BlockLayout &blockLayout = descriptor.mBlockLayout[groupIndex];
+				unsigned parityLength = blockLayout.mCodewordCount - blockLayout.mDataCodewordCount;
+				size_t dataLength = blockLayout.mBlockCount * blockLayout.mDataCodewordCount, errorCorrectionLength = blockLayout.mBlockCount * parityLength;
+
+				if (groupIndex)
+				{
+					dataOffsets[groupIndex] = dataOffsets[groupIndex - 1] + descriptor.mBlockLayout[groupIndex - 1].mBlockCount * descriptor.mBlockLayout[groupIndex - 1].mDataCodewordCount;
+					errorCorrectionOffsets[groupIndex] = errorCorrectionOffsets[groupIndex - 1] + descriptor.mBlockLayout[groupIndex - 1].mBlockCount * parityLength;
+				}
+
+				maxDataLength = std::max<size_t>(maxDataLength, blockLayout.mDataCodewordCount);
+
+				for (unsigned block = 0; block < blockLayout.mBlockCount; ++block)
+					for (unsigned codewordIndex = 0; codewordIndex < blockLayout.mDataCodewordCount; ++codewordIndex)
+					{
+						unsigned lastBit = shortLastCodeword && codewordIndex + 1 == blockLayout.mDataCodewordCount ? 4 : 0;
+
+						data[dataOffsets[groupIndex] + codewordIndex * blockLayout.mBlockCount + block] = static_cast<std::uint8_t>(dataBitStream.read(bitIndex, 8 - lastBit) << lastBit);
+						bitIndex += 8 - lastBit;
+					}
+
+				//The product tables of ReedSolomonEncoder are built at run time, so constant evaluation encodes block by block from the generator polynomial
+				if (std::is_constant_evaluated())
+					for (unsigned block = 0; block < blockLayout.mBlockCount; ++block)
+					{
+						std::array<std::uint8_t, codewordCount> blockData = {}, blockParity = {};
+
+						for (unsigned codewordIndex = 0; codewordIndex < blockLayout.mDataCodewordCount; ++codewordIndex)
+							blockData[codewordIndex] = data[dataOffsets[groupIndex] + codewordIndex * blockLayout.mBlockCount + block];
+
+						EncodeReedSolomon(std::span(blockData).first(blockLayout.mDataCodewordCount), std::span(blockParity).first(parityLength));
+
+						for (unsigned codewordIndex = 0; codewordIndex < parityLength; ++codewordIndex)
+							errorCorrection[errorCorrectionOffsets[groupIndex] + codewordIndex * blockLayout.mBlockCount + block] = blockParity[codewordIndex];
+					}
+				else
+					ReedSolomonEncoder(parityLength).encodeBatch(std::span(data).subspan(dataOffsets[groupIndex], dataLength),
+						std::span(errorCorrection).subspan(errorCorrectionOffsets[groupIndex], errorCorrectionLength), blockLayout.mBlockCount);
+			}
+
+			//Place bits in symbol
+			for (bool isErrorCorrection : { false, true })
+			{
+				auto &codewords = isErrorCorrection ? errorCorrection : data;
+				auto &offsets = isErrorCorrection ? errorCorrectionOffsets : dataOffsets;
+				auto getLength = [&](const BlockLayout &blockLayout) -> size_t {
+					return isErrorCorrection ? blockLayout.mCodewordCount - blockLayout.mDataCodewordCount : blockLayout.mDataCodewordCount;
+				};
+
+				for (size_t codewordIndex = 0, maxLength = isErrorCorrection ? getLength(descriptor.mBlockLayout.front()) : maxDataLength; codewordIndex < maxLength; ++codewordIndex)
+					for (size_t groupIndex = 0; groupIndex < descriptor.mBlockLayout.size(); ++groupIndex)
+					{
+						const BlockLayout &blockLayout = descriptor.mBlockLayout[groupIndex];
+						size_t length = getLength(blockLayout);
+						unsigned lastBit = !isErrorCorrection && shortLastCodeword && codewordIndex + 1 == length ? 4 : 0;
+
+						if (codewordIndex < length)
+							for (unsigned block = 0; block < blockLayout.mBlockCount; ++block)
+							{
+								std::uint8_t codeword = codewords[offsets[groupIndex] + codewordIndex * blockLayout.mBlockCount + block];
+
+								for (unsigned codewordBit = 8; codewordBit > lastBit;)
+								{
+									auto position = tables.mPlacementOrder[moduleIndex++];
+
+									symbol[position.mRow] |= std::uint64_t{ codeword >> --codewordBit & 1u } << position.mColumn;
+								}
+							}
+					}
+			}
+
+			//QR symbols take the lowest score and stop rating a mask once it can't beat the best one so far. Micro QR symbols take the highest score
+			for (unsigned id = 0; id < tables.MASK_COUNT; ++id)
+			{
+				Fixed::Rows<size> maskedSymbol;
+
+				for (size_t i = 0; i < size; ++i)
+					maskedSymbol[i] = symbol[i] ^ tables.mMaskPatterns[id][i];
+
+				scores[id] = Fixed::GetSymbolRating<Type>(maskedSymbol,
+					id && Type == SymbolType::QR ? *std::min_element(scores.begin(), scores.begin() + id) : std::numeric_limits<unsigned>::max());
+
+				if (id && (Type == SymbolType::QR ? scores[id] < scores[maskId] : scores[id] > scores[maskId]))
+					maskId = id;
+			}
+
+			for (size_t i = 0; i < size; ++i)
+				symbol[i] ^= tables.mMaskPatterns[maskId][i];
+
+			DrawFormatInformation(Type, Version, mLevel, maskId, [&symbol](unsigned row, unsigned column, bool value) { Fixed::SetModule(symbol, row, column, value); });
+
+			for (size_t i = 0; i < size; ++i)
+				output.mRows[i] = symbol[i] | tables.mVersionInformation[i];
+
+			output.mSize = size;
+			output.mType = Type;
+			output.mMaskId = maskId;
+		}
+	public:
+		//Throws std::invalid_argument for the same reasons as Encoder, or if version is greater than MaxVersion
+		constexpr FixedEncoder(unsigned version, ErrorCorrectionLevel level)
+			:mVersion(version), mLevel(level)
+		{
+			ValidateArguments(Type, version, level);
+
+			if (version > MaxVersion)
+				throw std::invalid_argument("Version is greater than the encoder's max version");
+		}
+
+		//Same format and exceptions as Encoder::addCharacters. If an exception is thrown, the bit stream is left as it was
+		constexpr void addCharacters(std::string_view message, Mode mode)
+		{
+			const SymbolDescriptor &descriptor = GetSymbolDescriptor(Type, static_cast<std::uint8_t>(mVersion), mLevel);
+			size_t size = mBitStream.size();
+
+			try
+			{
+				EncodeCharacters(mBitStream, descriptor, message, mode);
+			}
+			catch (...)
+			{
+				mBitStream.resize(size);
+				throw;
+			}
+
+			if (mBitStream.size() > descriptor.mDataBitCapacity)
+			{
+				mBitStream.resize(size);
+				throw std::length_error("Data bit stream would exceed the symbol's capacity");
+			}
+		}
+
+		//Clear bit stream
+		constexpr void clear()
+		{
+			mBitStream.clear();
+		}
+
+		//Can run at compile time, see EncodeConstant
+		constexpr FixedSymbol<MAX_SIZE> generateMatrix() const
+		{
+			FixedSymbol<MAX_SIZE> result = {};
+
+			[&]<unsigned... Versions>(std::integer_sequence<unsigned, Versions...>) {
+				((mVersion == Versions + 1 && (generate<Versions + 1>(result), true)) || ...);
+			}(std::make_integer_sequence<unsigned, MaxVersion>());
+
+			return result;
+		}
+
+		constexpr const FixedBitStream<MAX_DATA_BITS>& getBitStream() const
+		{
+			return mBitStream;
+		}
+
+		constexpr unsigned getVersion() const
+		{
+			return mVersion;
+		}
+
+		constexpr ErrorCorrectionLevel getErrorCorrectionLevel() const
+		{
+			return mLevel;
+		}
+	};
+
+	//Symbol for a message known at compile time, in the same format Encoder::addCharacters takes. Same symbol as Encoder::generateMatrix, and a message
+	//that doesn't fit or can't be encoded in mode fails to compile. Version goes up to 11 like in FixedEncoder
+	template<SymbolType Type, unsigned Version>
+	consteval FixedSymbol<GetSymbolSize(Type, Version)> EncodeConstant(std::string_view message, Mode mode, ErrorCorrectionLevel level)
+	{
+		FixedEncoder<Type, Version> encoder(Version, level);
+
+		encoder.addCharacters(message, mode);
+
+		return encoder.generateMatrix();
+	}
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,338 @@
+#include "ImageCache.h"
+#include <fstream>
+#include <vector>
+#include <array>
+#include <span>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <bit>
+
+namespace QR
+{
+	#ifndef TESTS
+	namespace
+	{
+		#endif
+		//FIPS 180-4, section 6.2
+		std::array<std::uint8_t, 32> GetSHA256(std::span<const std::uint8_t> message)
+		{
+			static constexpr std::array<std::uint32_t, 64> ROUND_CONSTANTS = {
+				0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+				0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+				0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+				0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+				0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+				0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+				0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+				0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+			};
+			std::array<std::uint32_t, 8> hash = { 0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19 };
+			std::vector<std::uint8_t> padded(message.begin(), message.end());
+			std::uint64_t bitLength = static_cast<std::uint64_t>(message.size()) * 8;
+			std::array<std::uint8_t, 32> result;
+
+			padded.push_back(0x80);
+			padded.resize((padded.size() + 8 + 63) / 64 * 64 - 8);
+
+			for (int i = 7; i >= 0; --i)
+				padded.push_back(static_cast<std::uint8_t>(bitLength >> i * 8));
+
+			for (size_t block = 0; block < padded.size(); block += 64)
+			{
+				std::array<std::uint32_t, 64> schedule;
+				std::array<std::uint32_t, 8> working = hash;
+
+				for (unsigned i = 0; i < 16; ++i)
+					schedule[i] = static_cast<std::uint32_t>(padded[block + i * 4]) << 24 | padded[block + i * 4 + 1] << 16 | padded[block + i * 4 + 2] << 8 | padded[block + i * 4 + 3];
+
+				for (unsigned i = 16; i < 64; ++i)
+					schedule[i] = schedule[i - 16] + (std::rotr(schedule[i - 15], 7) ^ std::rotr(schedule[i - 15], 18) ^ schedule[i - 15] >> 3) + schedule[i - 7] +
+						(std::rotr(schedule[i - 2], 17) ^ std::rotr(schedule[i - 2], 19) ^ schedule[i - 2] >> 10);
+
+				for (unsigned i = 0; i < 64; ++i)
+				{
+					auto &[a, b, c, d, e, f, g, h] = working;
+					std::uint32_t first = h + (std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25)) + ((e & f) ^ (~e & g)) + ROUND_CONSTANTS[i] + schedule[i];
+					std::uint32_t second = (std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+					h = g;
+					g = f;
+					f = e;
+					e = d + first;
+					d = c;
+					c = b;
+					b = a;
+					a = first + second;
+				}
+
+				for (unsigned i = 0; i < 8; ++i)
+					hash[i] += working[i];
+			}
+
+			for (unsigned i = 0; i < 32; ++i)
+				result[i] = static_cast<std::uint8_t>(hash[i / 4] >> (24 - i % 4 * 8));
+
+			return result;
+		}
+
+		//Everything an image depends on, in a fixed byte order so file names are the same on every machine. The first byte is the key format
+		std::vector<std::uint8_t> GetImageKey(const Encoder &encoder, const RenderParameters &parameters)
+		{
+			std::vector<bool> bitStream = encoder.getBitStream();
+			std::vector<std::uint8_t> result = { 1, static_cast<std::uint8_t>(encoder.getSymbolType()), static_cast<std::uint8_t>(encoder.getVersion()),
+				static_cast<std::uint8_t>(encoder.getErrorCorrectionLevel()), static_cast<std::uint8_t>(encoder.getMaskPolicy()), static_cast<std::uint8_t>(encoder.getFixedMaskId()) };
+			size_t bitStreamStart;
+
+			for (int i = 7; i >= 0; --i)
+				result.push_back(static_cast<std::uint8_t>(static_cast<std::uint64_t>(bitStream.size()) >> i * 8));
+
+			bitStreamStart = result.size();
+			result.resize(bitStreamStart + (bitStream.size() + 7) / 8);
+
+			for (size_t i = 0; i < bitStream.size(); ++i)
+				result[bitStreamStart + i / 8] |= static_cast<std::uint8_t>(bitStream[i] << (7 - i % 8));
+
+			for (int i = 3; i >= 0; --i)
+				result.push_back(static_cast<std::uint8_t>(parameters.mMultiplier >> i * 8));
+
+			for (Color color : { parameters.mLightModuleColor, parameters.mDarkModuleColor })
+				result.insert(result.end(), { color.mRed, color.mGreen, color.mBlue });
+
+			return result;
+		}
+
+		//Unique among the threads and processes writing to the same directory
+		std::string GetTemporarySuffix()
+		{
+			static std::atomic<unsigned> counter = 0;
+
+			return ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + '-' +
+				std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + '-' + std::to_string(counter++);
+		}
+
+		//Renames temporary over destination. temporary is removed if that fails, or if it was already a hard link to destination, which rename leaves alone
+		void ReplaceWith(const std::filesystem::path &temporary, const std::filesystem::path &destination)
+		{
+			std::error_code error;
+
+			std::error_code removeError;
+
+			std::filesystem::rename(temporary, destination, error);
+			std::filesystem::remove(temporary, removeError);
+
+			if (error)
+				throw std::filesystem::filesystem_error("Couldn't replace file", temporary, destination, error);
+		}
+
+		//Writes image to a temporary file next to destination and renames it over destination, so destination is either left as it was or complete
+		void WriteImage(const BMPImage &image, const std::filesystem::path &destination)
+		{
+			std::filesystem::path temporary = destination;
+			std::error_code error;
+
+			temporary += GetTemporarySuffix();
+
+			std::ofstream stream(temporary, std::ios::binary);
+
+			stream << image;
+			stream.close();
+
+			if (!stream)
+			{
+				std::filesystem::remove(temporary, error);
+				throw std::runtime_error("Couldn't write " + temporary.string());
+			}
+
+			ReplaceWith(temporary, destination);
+		}
+
+		//Hard links or copies source to a temporary file next to destination, then renames it over destination. Returns false, with destination
+		//untouched, if source couldn't be linked or copied
+		bool LinkOrCopy(const std::filesystem::path &source, const std::filesystem::path &destination, bool hardLinks)
+		{
+			std::filesystem::path temporary = destination;
+			std::error_code error;
+
+			temporary += GetTemporarySuffix();
+
+			if (hardLinks)
+				std::filesystem::create_hard_link(source, temporary, error);
+
+			if ((!hardLinks || error) && !(std::filesystem::copy_file(source, temporary, error) && !error))
+			{
+				std::filesystem::remove(temporary, error);
+				return false;
+			}
+
+			ReplaceWith(temporary, destination);
+
+			return true;
+		}
+		#ifndef TESTS
+	}
+	#endif
+}
+
+struct QR::ImageCache::Impl
+{
+	std::filesystem::path mDirectory;
+	std::uintmax_t mByteCap;
+	bool mHardLinks = true;
+	std::mutex mMutex;
+	std::uintmax_t mByteCount = 0; //Bytes in the directory at the last trim, plus the images rendered since
+	ImageCacheStatistics mStatistics = {};
+
+	//Recounts the directory and removes the least recently written images until it's down to 90% of mByteCap, so a full directory is only rescanned
+	//once the misses since fill the rest rather than on every miss. Temporary files an hour old are left over from processes that stopped before
+	//renaming them. mMutex must be locked
+	void trim()
+	{
+		struct CachedFile
+		{
+			std::filesystem::file_time_type mTime;
+			std::uintmax_t mSize;
+			std::filesystem::path mPath;
+		};
+		std::vector<CachedFile> files;
+		std::error_code error;
+		auto staleTime = std::filesystem::file_time_type::clock::now() - std::chrono::hours(1);
+		std::uintmax_t byteTarget = mByteCap - mByteCap / 10;
+
+		mByteCount = 0;
+
+		for (const auto &entry : std::filesystem::directory_iterator(mDirectory))
+		{
+			if (!entry.is_regular_file(error))
+				continue;
+
+			CachedFile file = { entry.last_write_time(error), entry.file_size(error), entry.path() };
+
+			if (file.mPath.extension() == ".bmp")
+			{
+				files.push_back(file);
+				mByteCount += file.mSize;
+			}
+			else
+				if (file.mPath.stem().extension() == ".bmp" && file.mPath.extension().string().starts_with(".tmp") && file.mTime < staleTime)
+					std::filesystem::remove(file.mPath, error);
+		}
+
+		std::sort(files.begin(), files.end(), [](const CachedFile &lhs, const CachedFile &rhs) { return lhs.mTime < rhs.mTime; });
+
+		for (const auto &file : files)
+		{
+			if (mByteCount <= byteTarget)
+				break;
+
+			//Another process may have removed it already, or still have it open
+			if (std::filesystem::remove(file.mPath, error))
+			{
+				mByteCount -= file.mSize;
+				++mStatistics.mEvictions;
+			}
+		}
+	}
+};
+
+QR::ImageCache::ImageCache(const std::filesystem::path &directory, std::uintmax_t byteCap)
+	:mImpl(new Impl{ directory, byteCap })
+{
+	std::filesystem::create_directories(directory);
+	mImpl->trim();
+}
+
+QR::ImageCache::~ImageCache() = default;
+
+bool QR::ImageCache::render(const Encoder &encoder, const RenderParameters &parameters, const std::filesystem::path &destination)
+{
+	std::filesystem::path file = mImpl->mDirectory / getFileName(encoder, parameters);
+	bool hardLinks = getHardLinks();
+	std::error_code error;
+	std::uintmax_t size;
+
+	if (LinkOrCopy(file, destination, hardLinks))
+	{
+		std::lock_guard lock(mImpl->mMutex);
+
+		std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now(), error);
+		++mImpl->mStatistics.mHits;
+
+		return true;
+	}
+
+	BMPImage image = QRToBMP(encoder.generateMatrix(), parameters.mMultiplier, parameters.mLightModuleColor, parameters.mDarkModuleColor);
+
+	try
+	{
+		WriteImage(image, file);
+	}
+	catch (const std::filesystem::filesystem_error&)
+	{
+		//Another process may have renamed the same image into place and still have it open
+		if (!std::filesystem::exists(file))
+			throw;
+	}
+
+	size = std::filesystem::file_size(file, error);
+
+	if (error)
+		size = 0;
+
+	//Another process may have evicted it already
+	if (!LinkOrCopy(file, destination, hardLinks))
+		WriteImage(image, destination);
+
+	std::lock_guard lock(mImpl->mMutex);
+
+	++mImpl->mStatistics.mMisses;
+	mImpl->mByteCount += size;
+
+	if (mImpl->mByteCount > mImpl->mByteCap)
+		mImpl->trim();
+
+	return false;
+}
+
+void QR::ImageCache::setHardLinks(bool hardLinks)
+{
+	std::lock_guard lock(mImpl->mMutex);
+
+	mImpl->mHardLinks = hardLinks;
+}
+
+bool QR::ImageCache::getHardLinks() const
+{
+	std::lock_guard lock(mImpl->mMutex);
+
+	return mImpl->mHardLinks;
+}
+
+std::string QR::ImageCache::getFileName(const Encoder &encoder, const RenderParameters &parameters) const
+{
+	static constexpr char DIGITS[] = "0123456789abcdef";
+	std::string result;
+
+	for (std::uint8_t byte : GetSHA256(GetImageKey(encoder, parameters)))
+	{
+		result += DIGITS[byte >> 4];
+		result += DIGITS[byte & 15];
+	}
+
+	return result + ".bmp";
+}
+
+std::uintmax_t QR::ImageCache::getByteCap() const
+{
+	return mImpl->mByteCap;
+}
+
+QR::ImageCacheStatistics QR::ImageCache::getStatistics() const
+{
+	std::lock_guard lock(mImpl->mMutex);
+
+	return mImpl->mStatistics;
+}
\ No newline at end of file
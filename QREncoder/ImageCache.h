@@ -0,0 +1,59 @@
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+#include "Image.h"
+#include "QREncoder.h"
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace QR
+{
+	//Arguments QRToBMP renders a symbol with
+	struct RenderParameters
+	{
+		unsigned mMultiplier;
+		Color mLightModuleColor;
+		Color mDarkModuleColor;
+	};
+
+	struct ImageCacheStatistics
+	{
+		size_t mHits;
+		size_t mMisses;
+		size_t mEvictions;
+	};
+
+	//BMP files rendered from symbols, kept in a directory across runs. Each file is named after the SHA-256 of everything it depends on: the bit stream,
+	//the symbol type, version, level and mask policy, and the render parameters. Files are written under a temporary name and renamed into place,
+	//so processes sharing the directory never see a partial image. Hits update the file's last write time, and the least recently written files are
+	//removed once the directory holds more than the byte cap, until it's down to 90% of it. Files written by other processes are only counted when the
+	//directory is trimmed.
+	//Throws std::filesystem::filesystem_error if the directory can't be read or written
+	class ImageCache final
+	{
+		struct Impl;
+		std::unique_ptr<Impl> mImpl;
+	public:
+		//Creates directory if it doesn't exist
+		ImageCache(const std::filesystem::path &directory, std::uintmax_t byteCap);
+		ImageCache(const ImageCache&) = delete;
+		ImageCache& operator=(const ImageCache&) = delete;
+		~ImageCache();
+
+		//Writes encoder's symbol rendered with parameters to destination, replacing it if it exists. Cached images are hard linked to destination
+		//when hard links are on and the file system allows it, and copied otherwise. The new file is renamed over destination once it's complete,
+		//so destination is left as it was if this throws. Returns true if the image was cached, false if it was rendered
+		bool render(const Encoder &encoder, const RenderParameters &parameters, const std::filesystem::path &destination);
+		//On by default. A hard linked destination is the cached file itself, so it must be replaced rather than changed in place
+		void setHardLinks(bool hardLinks);
+		bool getHardLinks() const;
+		//Name of the file the image would be cached in, without the directory
+		std::string getFileName(const Encoder &encoder, const RenderParameters &parameters) const;
+		std::uintmax_t getByteCap() const;
+		ImageCacheStatistics getStatistics() const;
+	};
+}
+
+#endif
\ No newline at end of file
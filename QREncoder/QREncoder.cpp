@@ -1,869 +1,391 @@
 #include "QREncoder.h"
+#include "BitStream.h"
+#include "BitMatrix.h"
+#include "ReedSolomon.h"
+#include "SymbolTables.h"
+#include "CharacterClasses.h"
+#include "SymbolCache.h"
+#include "Encoding.h"
 #include <stdexcept>
 #include <array>
-#include <unordered_map>
-#include <unordered_set>
 #include <string>
 #include <sstream>
 #include <tuple>
-#include <bitset>
 #include <algorithm>
 #include <optional>
-#include <regex>
+#include <bit>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <span>
+#include <limits>
+#include <cstring>
 
 namespace QR
 {
-	using BlockLayoutVector = std::vector<std::tuple<unsigned, unsigned, unsigned>>;
-
 	#ifndef TESTS
 	namespace
 	{
 		#endif
-		unsigned GetSymbolSize(SymbolType type, std::uint8_t version)
+		//Returns a matrix with all the bits that correspond to function patterns or version/format information set to true
+		BitMatrix GetDataRegionMask(SymbolType type, std::uint8_t version)
 		{
-			unsigned result = 0;
+			auto symbolSize = GetSymbolSize(type, version);
+			BitMatrix result(symbolSize, symbolSize);
 
-			switch (type)
-			{
-				case SymbolType::QR:
-					if (version > 40)
-						throw std::invalid_argument("Invalid version");
-					result = 21u + (version - 1) * 4;
-					break;
-
-				case SymbolType::MICRO_QR:
-					if (version > 4)
-						throw std::invalid_argument("Invalid version");
-					result = 11u + (version - 1) * 2;
-					break;
-			}
+			ForEachFunctionArea(type, version, [&result](unsigned firstRow, unsigned firstColumn, unsigned lastRow, unsigned lastColumn) {
+				for (unsigned i = firstRow; i <= lastRow; ++i)
+					for (unsigned j = firstColumn; j <= lastColumn; ++j)
+						result.set(i, j, true);
+			});
 
 			return result;
 		}
 
-		//Divide by 8 to get data capacity in codewords, do % 8 to get remainder bits. Exceptions are M1 and M3, where the last data codeword is 4 bits long
-		unsigned GetDataModuleCount(SymbolType type, std::uint8_t version)
+		//Memory GetSymbolRating reuses between calls
+		struct RatingScratch
 		{
-			static const std::array<unsigned, 4> microModuleCount = { 36, 80, 132, 192 };
-			static const std::array<unsigned, 40> moduleCount = {
-				208, 359, 567, 807, 1079, 1383, 1568, 1936,
-				2336, 2768, 3232, 3728, 4256, 4651, 5243, 5867,
-				6523, 7211, 7931, 8683, 9252, 10068, 10916, 11796,
-				12708, 13652, 14628, 15371, 16411, 17483, 18587, 19723,
-				20891, 22091, 23008, 24272, 25568, 26896, 28256, 29648
-			};
-			unsigned result;
-
-			if (type == SymbolType::MICRO_QR)
-				result = microModuleCount[version - 1];
-			else
-				result = moduleCount[version - 1];
-
-			return result;
-		}
-
-		//From table 1, page 18
-		unsigned GetRemainderBitCount(SymbolType type, std::uint8_t version)
+			BitMatrix mTransposed;
+			std::vector<PackedRow<3>> mRows, mColumns, mLightRows; //Up to 192 modules, enough for version 40 symbols
+		};
+
+		//For QR symbols, rating stops as soon as the penalty reaches bound and returns what it got so far, which is at least bound.
+		//Feature 4 is computed first since it only needs a count, then every row adds its features 1, 2 and 3.
+		//If rowsOnly is true, features 1 and 3 skip columns, which saves transposing the symbol. Micro QR symbols are always rated in full
+		unsigned GetSymbolRating(const BitMatrix &symbol, SymbolType type, RatingScratch &scratch, unsigned bound = std::numeric_limits<unsigned>::max(), bool rowsOnly = false)
 		{
-			unsigned result = 0;
+			using Row = PackedRow<3>;
+			auto size = symbol.getWidth();
 
 			if (type == SymbolType::QR)
-				result = GetDataModuleCount(type, version) % 8;
+			{
+				const BitMatrix &transposed = scratch.mTransposed;
+				auto &rows = scratch.mRows, &columns = scratch.mColumns, &lightRows = scratch.mLightRows;
+				Row valid = Row::GetPrefix(size);
+				unsigned feature4Score = GetFeature4Score(symbol.count(), size);
 
-			return result;
-		}
+				if (symbol.getWordsPerRow() > Row::WORD_COUNT)
+					throw std::invalid_argument("Symbol is too big");
 
-		const std::vector<unsigned>& GetPolynomialCoefficientExponents(unsigned errorCorrectionCodewordCount)
-		{
-			static const std::unordered_map<unsigned, std::vector<unsigned>> polynomials = {
-				{ 2, { 25, 1 } },
-				{ 5, { 113, 164, 166, 119, 10 } },
-				{ 6, { 166, 0, 134, 5, 176, 15 } },
-				{ 7, { 87, 229, 146, 149, 238, 102, 21 } },
-				{ 8, { 175, 238, 208, 249, 215, 252, 196, 28 } },
-				{ 10, { 251, 67, 46, 61, 118, 70, 64, 94, 32, 45 } },
-				{ 13, { 74, 152, 176, 100, 86, 100, 106, 104, 130, 218, 206, 140, 78 } },
-				{ 14, { 199, 249, 155, 48, 190, 124, 218, 137, 216, 87, 207, 59, 22, 91 } },
-				{ 15, { 8, 183, 61, 91, 202, 37, 51, 58, 58, 237, 140, 124, 5, 99, 105 } },
-				{ 16, { 120, 104, 107, 109, 102, 161, 76, 3, 91, 191, 147, 169, 182, 194, 225, 120 } },
-				{ 17, { 43, 139, 206, 78, 43, 239, 123, 206, 214, 147, 24, 99, 150, 39, 243, 163, 136 } },
-				{ 18, { 215, 234, 158, 94, 184, 97, 118, 170, 79, 187, 152, 148, 252, 179, 5, 98, 96, 153 } },
-				{ 20, { 17, 60, 79, 50, 61, 163, 26, 187, 202, 180, 221, 225, 83, 239, 156, 164, 212, 212, 188, 190 } },
-				{ 22, { 210, 171, 247, 242, 93, 230, 14, 109, 221, 53, 200, 74, 8, 172, 98, 80, 219, 134, 160, 105, 165, 231 } },
-				{ 24, { 229, 121, 135, 48, 211, 117, 251, 126, 159, 180, 169, 152, 192, 226, 228, 218, 111, 0, 117, 232, 87, 96, 227, 21 } },
-				{ 26, { 173, 125, 158, 2, 103, 182, 118, 17, 145, 201, 111, 28, 165, 53, 161, 21, 245, 142, 13, 102, 48, 227, 153, 145, 218, 70 } },
-				{ 28, { 168, 223, 200, 104, 224, 234, 108, 180, 110, 190, 195, 147, 205, 27, 232, 201, 21, 43, 245, 87, 42, 195, 212, 119, 242, 37, 9, 123 } },
-				{ 30, { 41, 173, 145, 152, 216, 31, 179, 182, 50, 48, 110, 86, 239, 96, 222, 125, 42, 173, 226, 193, 224, 130, 156, 37, 251, 216, 238, 40, 192, 180 } },
-				{ 32, { 10, 6, 106, 190, 249, 167, 4, 67, 209, 138, 138, 32, 242, 123, 89, 27, 120, 185, 80, 156, 38, 69, 171, 60, 28, 222, 80, 52, 254, 185, 220, 241 }},
-				{ 34, { 111, 77, 146, 94, 26, 21, 108, 19, 105, 94, 113, 193, 86, 140, 163, 125, 58, 158, 229, 239, 218, 103, 56, 70, 114, 61, 183, 129, 167, 13, 98, 62, 129, 51 } },
-				{ 36, { 200, 183, 98, 16, 172, 31, 246, 234, 60, 152, 115, 0, 167, 152, 113, 248, 238, 107, 18, 63, 218, 37, 87, 210, 105, 177, 120, 74, 121, 196, 117, 251, 113, 233, 30, 120 } },
-				{ 40, { 59, 116, 79, 161, 252, 98, 128, 205, 128, 161, 247, 57, 163, 56, 235, 106, 53, 26, 187, 174, 226, 104, 170, 7, 175, 35, 181, 114, 88, 41, 47, 163, 125, 134, 72, 20, 232, 53, 35, 15 } },
-				{ 42, { 250, 103, 221, 230, 25, 18, 137, 231, 0, 3, 58, 242, 221, 191, 110, 84, 230, 8, 188, 106, 96, 147, 15, 131, 139, 34, 101, 223, 39, 101, 213, 199, 237, 254, 201, 123, 171, 162, 194, 117, 50, 96 } },
-				{ 44, { 190, 7, 61, 121, 71, 246, 69, 55, 168, 188, 89, 243, 191, 25, 72, 123, 9, 145, 14, 247, 1, 238, 44, 78, 143, 62, 224, 126, 118, 114, 68, 163, 52, 194, 217, 147, 204, 169, 37, 130, 113, 102, 73, 181 } },
-				{ 46, { 112, 94, 88, 112, 253, 224, 202, 115, 187, 99, 89, 5, 54, 113, 129, 44, 58, 16, 135, 216, 169, 211, 36, 1, 4, 96, 60, 241, 73, 104, 234, 8, 249, 245, 119, 174, 52, 25, 157, 224, 43, 202, 223, 19, 82, 15 } },
-				{ 48, { 228, 25, 196, 130, 211, 146, 60, 24, 251, 90, 39, 102, 240, 61, 178, 63, 46, 123, 115, 18, 221, 111, 135, 160, 182, 205, 107, 206, 95, 150, 120, 184, 91, 21, 247, 156, 140, 238, 191, 11, 94, 227, 84, 50, 163, 39, 34, 108 } },
-				{ 50, { 232, 125, 157, 161, 164, 9, 118, 46, 209, 99, 203, 193, 35, 3, 209, 111, 195, 242, 203, 225, 46, 13, 32, 160, 126, 209, 130, 160, 242, 215, 242, 75, 77, 42, 189, 32, 113, 65, 124, 69, 228, 114, 235, 175, 124, 170, 215, 232, 133, 205 } },
-				{ 52, { 116, 50, 86, 186, 50, 220, 251, 89, 192, 46, 86, 127, 124, 19, 184, 233, 151, 215, 22, 14, 59, 145, 37, 242, 203, 134, 254, 89, 190, 94, 59, 65, 124, 113, 100, 233, 235, 121, 22, 76, 86, 97, 39, 242, 200, 220, 101, 33, 239, 254, 113, 51 } },
-				{ 54, { 183, 26, 201, 87, 210, 221, 113, 21, 46, 65, 45, 50, 238, 184, 249, 225, 102, 58, 209, 218, 109, 165, 26, 95, 184, 192, 52, 245, 35, 254, 238, 175, 172, 79, 123, 25, 122, 43, 120, 108, 215, 80, 128, 201, 235, 8, 153, 59, 101, 31, 198, 76, 31, 156 } },
-				{ 56, { 106, 120, 107, 157, 164, 216, 112, 116, 2, 91, 248, 163, 36, 201, 202, 229, 6, 144, 254, 155, 135, 208, 170, 209, 12, 139, 127, 142, 182, 249, 177, 174, 190, 28, 10, 85, 239, 184, 101, 124, 152, 206, 96, 23, 163, 61, 27, 196, 247, 151, 154, 202, 207, 20, 61, 10 } },
-				{ 58, { 82, 116, 26, 247, 66, 27, 62, 107, 252, 182, 200, 185, 235, 55, 251, 242, 210, 144, 154, 237, 176, 141, 192, 248, 152, 249, 206, 85, 253, 142, 65, 165, 125, 23, 24, 30, 122, 240, 214, 6, 129, 218, 29, 145, 127, 134, 206, 245, 117, 29, 41, 63, 159, 142, 233, 125, 148, 123 } },
-				{ 60, { 107, 140, 26, 12, 9, 141, 243, 197, 226, 197, 219, 45, 211, 101, 219, 120, 28, 181, 127, 6, 100, 247, 2, 205, 198, 57, 115, 219, 101, 109, 160, 82, 37, 38, 238, 49, 160, 209, 121, 86, 11, 124, 30, 181, 84, 25, 194, 87, 65, 102, 190, 220, 70, 27, 209, 16, 89, 7, 33, 240 } },
-				{ 62, { 65, 202, 113, 98, 71, 223, 248, 118, 214, 94, 0, 122, 37, 23, 2, 228, 58, 121, 7, 105, 135, 78, 243, 118, 70, 76, 223, 89, 72, 50, 70, 111, 194, 17, 212, 126, 181, 35, 221, 117, 235, 11, 229, 149, 147, 123, 213, 40, 115, 6, 200, 100, 26, 246, 182, 218, 127, 215, 36, 186, 110, 106 } },
-				{ 64, { 45, 51, 175, 9, 7, 158, 159, 49, 68, 119, 92, 123, 177, 204, 187, 254, 200, 78, 141, 149, 119, 26, 127, 53, 160, 93, 199, 212, 29, 24, 145, 156, 208, 150, 218, 209, 4, 216, 91, 47, 184, 146, 47, 140, 195, 195, 125, 242, 238, 63, 99, 108, 140, 230, 242, 31, 204, 11, 178, 243, 217, 156, 213, 231 } },
-				{ 66, { 5, 118, 222, 180, 136, 136, 162, 51, 46, 117, 13, 215, 81, 17, 139, 247, 197, 171, 95, 173, 65, 137, 178, 68, 111, 95, 101, 41, 72, 214, 169, 197, 95, 7, 44, 154, 77, 111, 236, 40, 121, 143, 63, 87, 80, 253, 240, 126, 217, 77, 34, 232, 106, 50, 168, 82, 76, 146, 67, 106, 171, 25, 132, 93, 45, 105 } },
-				{ 68, { 247, 159, 223, 33, 224, 93, 77, 70, 90, 160, 32, 254, 43, 150, 84, 101, 190, 205, 133, 52, 60, 202, 165, 220, 203, 151, 93, 84, 15, 84, 253, 173, 160, 89, 227, 52, 199, 97, 95, 231, 52, 177, 41, 125, 137, 241, 166, 225, 118, 2, 54, 32, 82, 215, 175, 198, 43, 238, 235, 27, 101, 184, 127, 3, 5, 8, 163, 238 } }
-			};
+				if (feature4Score >= bound)
+					return feature4Score;
 
-			return polynomials.at(errorCorrectionCodewordCount);
-		}
+				if (!rowsOnly)
+					symbol.transposeInto(scratch.mTransposed);
 
-		unsigned GetAlphaValue(unsigned exponent)
-		{
-			static const std::array<unsigned, 256> values = {
-				1, 2, 4, 8, 16, 32, 64, 128, 29, 58, 116, 232, 205, 135, 19, 38,
-				76, 152, 45, 90, 180, 117, 234, 201, 143, 3, 6, 12, 24, 48, 96, 192,
-				157, 39, 78, 156, 37, 74, 148, 53, 106, 212, 181, 119, 238, 193, 159, 35,
-				70, 140, 5, 10, 20, 40, 80, 160, 93, 186, 105, 210, 185, 111, 222, 161,
-				95, 190, 97, 194, 153, 47, 94, 188, 101, 202, 137, 15, 30, 60, 120, 240,
-				253, 231, 211, 187, 107, 214, 177, 127, 254, 225, 223, 163, 91, 182, 113, 226,
-				217, 175, 67, 134, 17, 34, 68, 136, 13, 26, 52, 104, 208, 189, 103, 206,
-				129, 31, 62, 124, 248, 237, 199, 147, 59, 118, 236, 197, 151, 51, 102, 204,
-				133, 23, 46, 92, 184, 109, 218, 169, 79, 158, 33, 66, 132, 21, 42, 84,
-				168, 77, 154, 41, 82, 164, 85, 170, 73, 146, 57, 114, 228, 213, 183, 115,
-				230, 209, 191, 99, 198, 145, 63, 126, 252, 229, 215, 179, 123, 246, 241, 255,
-				227, 219, 171, 75, 150, 49, 98, 196, 149, 55, 110, 220, 165, 87, 174, 65,
-				130, 25, 50, 100, 200, 141, 7, 14, 28, 56, 112, 224, 221, 167, 83, 166,
-				81, 162, 89, 178, 121, 242, 249, 239, 195, 155, 43, 86, 172, 69, 138, 9,
-				18, 36, 72, 144, 61, 122, 244, 245, 247, 243, 251, 235, 203, 139, 11, 22,
-				44, 88, 176, 125, 250, 233, 207, 131, 27, 54, 108, 216, 173, 71, 142, 1
-			};
+				rows.resize(size);
+				columns.resize(rowsOnly ? 0 : size);
+				lightRows.resize(size);
 
-			return values[exponent];
-		}
+				for (BitMatrix::size_type i = 0; i < size; ++i)
+				{
+					rows[i] = Row(symbol.getRow(i), symbol.getWordsPerRow());
+					lightRows[i] = ~rows[i] & valid;
 
-		unsigned GetAlphaExponent(unsigned value)
-		{
-			static const std::array<unsigned, 255> exponents = {
-				0, 1, 25, 2, 50, 26, 198, 3, 223, 51, 238, 27, 104, 199, 75,
-				4, 100, 224, 14, 52, 141, 239, 129, 28, 193, 105, 248, 200, 8, 76, 113,
-				5, 138, 101, 47, 225, 36, 15, 33, 53, 147, 142, 218, 240, 18, 130, 69,
-				29, 181, 194, 125, 106, 39, 249, 185, 201, 154, 9, 120, 77, 228, 114, 166,
-				6, 191, 139, 98, 102, 221, 48, 253, 226, 152, 37, 179, 16, 145, 34, 136,
-				54, 208, 148, 206, 143, 150, 219, 189, 241, 210, 19, 92, 131, 56, 70, 64,
-				30, 66, 182, 163, 195, 72, 126, 110, 107, 58, 40, 84, 250, 133, 186, 61,
-				202, 94, 155, 159, 10, 21, 121, 43, 78, 212, 229, 172, 115, 243, 167, 87,
-				7, 112, 192, 247, 140, 128, 99, 13, 103, 74, 222, 237, 49, 197, 254, 24,
-				227, 165, 153, 119, 38, 184, 180, 124, 17, 68, 146, 217, 35, 32, 137, 46,
-				55, 63, 209, 91, 149, 188, 207, 205, 144, 135, 151, 178, 220, 252, 190, 97,
-				242, 86, 211, 171, 20, 42, 93, 158, 132, 60, 57, 83, 71, 109, 65, 162,
-				31, 45, 67, 216, 183, 123, 164, 118, 196, 23, 73, 236, 127, 12, 111, 246,
-				108, 161, 59, 82, 41, 157, 85, 170, 251, 96, 134, 177, 187, 204, 62, 90,
-				203, 89, 95, 176, 156, 169, 160, 81, 11, 245, 22, 235, 122, 117, 44, 215,
-				79, 174, 213, 233, 230, 231, 173, 232, 116, 214, 244, 234, 168, 80, 88, 175
-			};
+					if (!rowsOnly)
+						columns[i] = Row(transposed.getRow(i), transposed.getWordsPerRow());
+				}
 
-			return exponents[value - 1];
+				return AddRowFeatureScores<3>(rows, columns, lightRows, feature4Score, bound);
+			}
+			else
+				return GetMicroQRSymbolRating(size, [&symbol](size_t row, size_t column) { return symbol.get(row, column); });
 		}
 
-		//From table 9, page 38. <count, total, data>
-		BlockLayoutVector GetBlockLayout(SymbolType type, std::uint8_t version, ErrorCorrectionLevel level)
+		unsigned GetSymbolRating(const BitMatrix &symbol, SymbolType type, unsigned bound = std::numeric_limits<unsigned>::max(), bool rowsOnly = false)
 		{
-			using std::array;
-			using std::vector;
-			using std::tuple;
-			static const array<BlockLayoutVector, 4> microBlockLayouts = { {
-				{ { 1, 5, 3 } },
-				{ { 1, 10, 5 }, { 1, 10, 4 } },
-				{ { 1, 17, 11 }, { 1, 17, 9 } },
-				{ { 1, 24, 16 }, { 1, 24, 14 }, { 1, 24, 10 } },
-			} };
-			static const array<vector<BlockLayoutVector>, 40> blockLayouts = { {
-				{ { { 1, 26, 19 } }, { { 1, 26, 16 } }, { { 1, 26, 13 } }, { { 1, 26, 9 } } },
-				{ { { 1, 44, 34 } }, { { 1, 44, 28 } }, { { 1, 44, 22 } }, { { 1, 44, 16 } } },
-				{ { { 1, 70, 55 } }, { { 1, 70, 44 } }, { { 2, 35, 17 } }, { { 2, 35, 13 } } },
-				{ { { 1, 100, 80 } }, { { 2, 50, 32 } }, { { 2, 50, 24 } }, { { 4, 25, 9 } } },
-				{ { { 1, 134, 108 } }, { { 2, 67, 43 } }, { { 2, 33, 15 }, { 2, 34, 16 } }, { { 2, 33, 11 }, { 2, 34, 12 } } },
-				{ { { 2, 86, 68 } }, { { 4, 43, 27 } }, { { 4, 43, 19 } }, { { 4, 43, 15 } } },
-				{ { { 2, 98, 78 } }, { { 4, 49, 31 } }, { { 2, 32, 14 }, { 4, 33, 15 } }, { { 4, 39, 13 }, { 1, 40, 14 } } },
-				{ { { 2, 121, 97 } }, { { 2, 60, 38 }, { 2, 61, 39 } }, { { 4, 40, 18 }, { 2, 41, 19 } }, { { 4, 40, 14 }, { 2, 41, 15 } } },
-				{ { { 2, 146, 116 } }, { { 3, 58, 36 }, { 2, 59, 37 } }, { { 4, 36, 16 }, { 4, 37, 17 } }, { { 4, 36, 12 }, { 4, 37, 13 } } },
-				{ { { 2, 86, 68 }, { 2, 87, 69 } }, { { 4, 69, 43 }, { 1, 70, 44 } }, { { 6, 43, 19 }, { 2, 44, 20 } }, { { 6, 43, 15 }, { 2, 44, 16 } } },
-				{ { { 4, 101, 81 } }, { { 1, 80, 50 }, { 4, 81, 51 } }, { { 4, 50, 22 }, { 4, 51, 23 } }, { { 3, 36, 12 }, { 8, 37, 13 } } },
-				{ { { 2, 116, 92 }, { 2, 117, 93 } }, { { 6, 58, 36 }, { 2, 59, 37 } }, { { 4, 46, 20 }, { 6, 47, 21 } }, { { 7, 42, 14 }, { 4, 43, 15 } } },
-				{ { { 4, 133, 107 } }, { { 8, 59, 37 }, { 1, 60, 38 } }, { { 8, 44, 20 }, { 4, 45, 21 } }, { { 12, 33, 11 }, { 4, 34, 12 } } },
-				{ { { 3, 145, 115 }, { 1, 146, 116 } }, { { 4, 64, 40 }, { 5, 65, 41 } }, { { 11, 36, 16 }, { 5, 37, 17 } }, { { 11, 36, 12 }, { 5, 37, 13 } } },
-				{ { { 5, 109, 87 }, { 1, 110, 88 } }, { { 5, 65, 41 }, { 5, 66, 42 } }, { { 5, 54, 24 }, { 7, 55, 25 } }, { { 11, 36, 12 }, { 7, 37, 13 } } },
-				{ { { 5, 122, 98 }, { 1, 123, 99 } }, { { 7, 73, 45 }, { 3, 74, 46 } }, { { 15, 43, 19 }, { 2, 44, 20 } }, { { 3, 45, 15 }, { 13, 46, 16 } } },
-				{ { { 1, 135, 107 }, { 5, 136, 108 } }, { { 10, 74, 46 }, { 1, 75, 47 } }, { { 1, 50, 22 }, { 15, 51, 23 } }, { { 2, 42, 14 }, { 17, 43, 15 } } },
-				{ { { 5, 150, 120 }, { 1, 151, 121 } }, { { 9, 69, 43 }, { 4, 70, 44 } }, { { 17, 50, 22 }, { 1, 51, 23 } }, { { 2, 42, 14 }, { 19, 43, 15 } } },
-				{ { { 3, 141, 113 }, { 4, 142, 114 } }, { { 3, 70, 44 }, { 11, 71, 45 } }, { { 17, 47, 21 }, { 4, 48, 22 } }, { { 9, 39, 13 }, { 16, 40, 14 } } },
-				{ { { 3, 135, 107 }, { 5, 136, 108 } }, { { 3, 67, 41 }, { 13, 68, 42 } }, { { 15, 54, 24 }, { 5, 55, 25 } }, { { 15, 43, 15 }, { 10, 44, 16 } } },
-				{ { { 4, 144, 116 }, { 4, 145, 117 } }, { { 17, 68, 42 } }, { { 17, 50, 22 }, { 6, 51, 23 } }, { { 19, 46, 16 }, { 6, 47, 17 } } },
-				{ { { 2, 139, 111 }, { 7, 140, 112 } }, { { 17, 74, 46 } }, { { 7, 54, 24 }, { 16, 55, 25 } }, { { 34, 37, 13 } } },
-				{ { { 4, 151, 121 }, { 5, 152, 122 } }, { { 4, 75, 47 }, { 14, 76, 48 } }, { { 11, 54, 24 }, { 14, 55, 25 } }, { { 16, 45, 15 }, { 14, 46, 16 } } },
-				{ { { 6, 147, 117 }, { 4, 148, 118 } }, { { 6, 73, 45 }, { 14, 74, 46 } }, { { 11, 54, 24 }, { 16, 55, 25 } }, { { 30, 46, 16 }, { 2, 47, 17 } } },
-				{ { { 8, 132, 106 }, { 4, 133, 107 } }, { { 8, 75, 47 }, { 13, 76, 48 } }, { { 7, 54, 24 }, { 22, 55, 25 } }, { { 22, 45, 15 }, { 13, 46, 16 } } },
-				{ { { 10, 142, 114 }, { 2, 143, 115 } }, { { 19, 74, 46 }, { 4, 75, 47 } }, { { 28, 50, 22 }, { 6, 51, 23 } }, { { 33, 46, 16 }, { 4, 47, 17 } } },
-				{ { { 8, 152, 122 }, { 4, 153, 123 } }, { { 22, 73, 45 }, { 3, 74, 46 } }, { { 8, 53, 23 }, { 26, 54, 24 } }, { { 12, 45, 15 }, { 28, 46, 16 } } },
-				{ { { 3, 147, 117 }, { 10, 148, 118 } }, { { 3, 73, 45 }, { 23, 74, 46 } }, { { 4, 54, 24 }, { 31, 55, 25 } }, { { 11, 45, 15 }, { 31, 46, 16 } } },
-				{ { { 7, 146, 116 }, { 7, 147, 117 } }, { { 21, 73, 45 }, { 7, 74, 46 } }, { { 1, 53, 23 }, { 37, 54, 24 } }, { { 19, 45, 15 }, { 26, 46, 16 } } },
-				{ { { 5, 145, 115 }, { 10, 146, 116 } }, { { 19, 75, 47 }, { 10, 76, 48 } }, { { 15, 54, 24 }, { 25, 55, 25 } }, { { 23, 45, 15 }, { 25, 46, 16 } } },
-				{ { { 13, 145, 115 }, { 3, 146, 116 } }, { { 2, 74, 46 }, { 29, 75, 47 } }, { { 42, 54, 24 }, { 1, 55, 25 } }, { { 23, 45, 15 }, { 28, 46, 16 } } },
-				{ { { 17, 145, 115 } }, { { 10, 74, 46 }, { 23, 75, 47 } }, { { 10, 54, 24 }, { 35, 55, 25 } }, { { 19, 45, 15 }, { 35, 46, 16 } } },
-				{ { { 17, 145, 115 }, { 1, 146, 116 } }, { { 14, 74, 46 }, { 21, 75, 47 } }, { { 29, 54, 24 }, { 19, 55, 25 } }, { { 11, 45, 15 }, { 46, 46, 16 } } },
-				{ { { 13, 145, 115 }, { 6, 146, 116 } }, { { 14, 74, 46 }, { 23, 75, 47 } }, { { 44, 54, 24 }, { 7, 55, 25 } }, { { 59, 46, 16 }, { 1, 47, 17 } } },
-				{ { { 12, 151, 121 }, { 7, 152, 122 } }, { { 12, 75, 47 }, { 26, 76, 48 } }, { { 39, 54, 24 }, { 14, 55, 25 } }, { { 22, 45, 15 }, { 41, 46, 16 } } },
-				{ { { 6, 151, 121 }, { 14, 152, 122 } }, { { 6, 75, 47 }, { 34, 76, 48 } }, { { 46, 54, 24 }, { 10, 55, 25 } }, { { 2, 45, 15 }, { 64, 46, 16 } } },
-				{ { { 17, 152, 122 }, { 4, 153, 123 } }, { { 29, 74, 46 }, { 14, 75, 47 } }, { { 49, 54, 24 }, { 10, 55, 25 } }, { { 24, 45, 15 }, { 46, 46,15 } } },
-				{ { { 4, 152, 122 }, { 18, 153, 123 } }, { { 13, 74, 46 }, { 32, 75, 47 } }, { { 48, 54, 24 }, { 14, 55, 25 } }, { { 42, 45, 15 }, { 32, 46, 16 } } },
-				{ { { 20, 147, 117 }, { 4, 148, 118 } }, { { 40, 75, 47 }, { 7, 76, 48 } }, { { 43, 54, 24 }, { 22, 55, 25 } }, { { 10, 45, 15 }, { 67, 46, 16 } } },
-				{ { { 19, 148, 118 }, { 6, 149, 119 } }, { { 18, 75, 47 }, { 31, 76, 48 } }, { { 34, 54, 24 }, { 34, 55, 25 } }, { { 20, 45, 15 }, { 61, 46, 16 } } },
-			} };
-			vector<tuple<unsigned, unsigned, unsigned>> result;
-
-			if (level == ErrorCorrectionLevel::ERROR_DETECTION_ONLY)
-				level = ErrorCorrectionLevel::L;
+			RatingScratch scratch;
 
-			if (type == SymbolType::MICRO_QR)
-				result = { microBlockLayouts[version - 1][static_cast<decltype(microBlockLayouts)::size_type>(level)] };
-			else
-				result = blockLayouts[version - 1][static_cast<decltype(microBlockLayouts)::size_type>(level)];
-
-			return result;
+			return GetSymbolRating(symbol, type, scratch, bound, rowsOnly);
 		}
 
-		//From table 9, page 38
-		unsigned GetErrorCorrectionCodewordCount(SymbolType type, std::uint8_t version, ErrorCorrectionLevel level)
+		unsigned GetSymbolRating(const Symbol &symbol, SymbolType type)
 		{
-			static const std::array<std::array<unsigned, 4>, 4> microCodewordCount = { {
-				{ 2 }, //This will be used for M1 symbols, ErrorCorrectionLevel will be NONE
-				{ 5, 6 },
-				{ 6, 8 },
-				{ 8, 10, 14 },
-			} };
-			static const std::array<std::array<unsigned, 4>, 40> codewordCount = { {
-				{ 7, 10, 13, 17 },
-				{ 10, 16, 22, 28 },
-				{ 15, 26, 36, 44 },
-				{ 20, 36, 52, 64 },
-				{ 26, 48, 72, 88 },
-				{ 36, 64, 96, 112 },
-				{ 40, 72, 108, 130 },
-				{ 48, 88, 132, 156 },
-				{ 60, 110, 160, 192 },
-				{ 72, 130, 192, 224 },
-				{ 80, 150, 224, 264 },
-				{ 96, 176, 260, 308 },
-				{ 104, 198, 288, 352 },
-				{ 120, 216, 320, 384 },
-				{ 132, 240, 360, 432 },
-				{ 144, 280, 408, 480 },
-				{ 168, 308, 448, 532 },
-				{ 180, 338, 504, 588 },
-				{ 196, 364, 546, 650 },
-				{ 224, 416, 600, 700 },
-				{ 224, 442, 644, 750 },
-				{ 252, 476, 690, 816 },
-				{ 270, 504, 750, 900 },
-				{ 300, 560, 810, 960 },
-				{ 312, 588, 870, 1050 },
-				{ 336, 644, 952, 1110 },
-				{ 360, 700, 1020, 1200 },
-				{ 390, 728, 1050, 1260 },
-				{ 420, 784, 1140, 1350 },
-				{ 450, 812, 1200, 1440 },
-				{ 480, 868, 1290, 1530 },
-				{ 510, 924, 1350, 1620 },
-				{ 540, 980, 1440, 1710 },
-				{ 570, 1036, 1530, 1800 },
-				{ 570, 1064, 1590, 1890 },
-				{ 600, 1120, 1680, 1980 },
-				{ 630, 1204, 1770, 2100 },
-				{ 660, 1260, 1860, 2220 },
-				{ 720, 1316, 1950, 2310 },
-				{ 750, 1372, 2040, 2430 }
-			} };
-			unsigned result;
-
-			if (type == SymbolType::MICRO_QR)
-			{
-				if (version == 1)
-					result = microCodewordCount[0][0];
-				else
-					result = microCodewordCount[version - 1][static_cast<decltype(microCodewordCount)::size_type>(level)];
-			}
-			else
-				result = codewordCount[version - 1][static_cast<decltype(codewordCount)::size_type>(level)];
-
-			return result;
+			return GetSymbolRating(BitMatrix(symbol), type);
 		}
 
-		//From table 2, page 23. version parameter is only used for Micro QR
-		std::vector<bool> GetModeIndicator(SymbolType type, std::uint8_t version, Mode mode)
+		//Every module of a symbol under up to 8 masks, one byte per module with bit m for mask m. PAD rows and columns of zeroes surround the symbol,
+		//so modules outside it are never light and every load stays inside the buffers
+		struct BitSlicedScratch
 		{
-			std::vector<bool> result;
+			static constexpr size_t PAD = 16;
+			size_t mStride = 0;
+			std::vector<std::uint8_t> mLight; //Bit m is set if the module is light under mask m
+			std::vector<std::uint8_t> mLightTransposed; //Same, with rows and columns swapped
 
-			if (type == SymbolType::MICRO_QR)
+			const std::uint8_t* getLight(std::ptrdiff_t row, std::ptrdiff_t column) const
 			{
-				result.resize(version - 1);
-
-				if (version > 1)
-				{
-					if (mode == Mode::ALPHANUMERIC || mode == Mode::KANJI)
-						result.back() = 1;
-
-					if (version > 2 && (mode == Mode::BYTE || mode == Mode::KANJI))
-						result.at(result.size() - 2) = 1;
-				}
+				return mLight.data() + (PAD + row) * mStride + PAD + column;
 			}
-			else
-			{
-				switch (mode)
-				{
-					case Mode::NUMERIC:
-						result = { 0, 0, 0, 1 };
-						break;
-
-					case Mode::ALPHANUMERIC:
-						result = { 0, 0, 1, 0 };
-						break;
-
-					case Mode::BYTE:
-						result = { 0, 1, 0, 0 };
-						break;
 
-					case Mode::KANJI:
-						result = { 1, 0, 0, 0 };
-						break;
-				}
+			const std::uint8_t* getLightTransposed(std::ptrdiff_t row, std::ptrdiff_t column) const
+			{
+				return mLightTransposed.data() + (PAD + row) * mStride + PAD + column;
 			}
+		};
 
-			return result;
-		}
-
-		//From table 3, page 23
-		std::vector<bool> GetCharacterCountIndicator(SymbolType type, std::uint8_t version, Mode mode, size_t characterCount)
+		//Byte k of the result is bytes[k], so 8 consecutive modules are handled at once
+		std::uint64_t LoadLanes(const std::uint8_t *bytes)
 		{
-			using TableType = std::array<std::array<unsigned, 4>, 4>;
-			static const TableType microModeLengths = { { { 3 }, { 4, 3 }, { 5, 4, 4, 3 }, { 6, 5, 5, 4 } } };
-			static const TableType modeLengths = { { { 10, 9, 8, 8 }, { 12, 11, 16, 10 }, { 14, 13, 16, 12 } } };
-			unsigned length = 0;
-			std::vector<bool> result;
+			std::uint64_t result = 0;
 
-			if (type == SymbolType::MICRO_QR)
-				length = microModeLengths[version - 1][static_cast<size_t>(mode)];
+			if constexpr (std::endian::native == std::endian::little)
+				std::memcpy(&result, bytes, sizeof(result));
 			else
-			{
-				if (version <= 9)
-					length = modeLengths[0][static_cast<size_t>(mode)];
-				else
-					if (version <= 26)
-						length = modeLengths[1][static_cast<size_t>(mode)];
-					else
-						length = modeLengths[2][static_cast<size_t>(mode)];
-			}
-
-			result.resize(length);
-
-			for (decltype(result)::size_type i = 0; i < result.size(); ++i)
-				result.at(i) = characterCount & 1 << (length - 1) >> i ? true : false;
+				for (unsigned i = 8; i--;)
+					result = result << 8 | bytes[i];
 
 			return result;
 		}
 
-		//Returns bit sequence containing ECI mode indicator and ECI designator.
-		std::vector<bool> GetECISequence(unsigned assignmentNumber)
+		void StoreLanes(std::uint8_t *bytes, std::uint64_t lanes)
 		{
-			std::vector<bool> result = { 0, 1, 1, 1 };
-
-			if (assignmentNumber <= 127)
-				result.resize(result.size() + 8);
-			else
-				if (assignmentNumber <= 16383)
-					result.resize(result.size() + 16);
-				else
-					if (assignmentNumber <= 999999)
-						result.resize(result.size() + 24);
-					else
-						throw std::invalid_argument("Invalid ECI assignment number, max value is 999999");
-
-			for (decltype(result)::size_type i = 4, sz = (result.size() - 4) / 8 - 1; i < sz + 4; ++i)
-				result[i] = 1;
-
-			for (decltype(result)::size_type codewords = (result.size() - 4) / 8, bits = result.size() - 4 - codewords, i = 4 + codewords; i < result.size(); ++i)
-				result[i] = assignmentNumber & 1 << (bits - 1) >> (i - 4 - codewords);
-
-			return result;
+			for (unsigned i = 0; i < 8; ++i)
+				bytes[i] = static_cast<std::uint8_t>(lanes >> i * 8);
 		}
 
-		//version parameter is only used for Micro QR
-		std::vector<bool> GetTerminator(SymbolType type, std::uint8_t version)
+		//Lanes k with first <= k < limit
+		std::uint64_t GetLaneMask(std::ptrdiff_t first, std::ptrdiff_t limit)
 		{
-			return std::vector<bool>(type == SymbolType::MICRO_QR ? 3 + (version - 1) * 2 : 4, false);
+			auto prefix = [](std::ptrdiff_t count) { return count <= 0 ? std::uint64_t{ 0 } : count >= 8 ? ~std::uint64_t{ 0 } : (std::uint64_t{ 1 } << count * 8) - 1; };
+
+			return prefix(limit) & ~prefix(first);
 		}
 
-		std::bitset<15> GetFormatInformation(SymbolType type, std::uint8_t version, ErrorCorrectionLevel level, size_t maskId)
+		//Counts, for every mask bit, the lanes that have it set. Every one of the 64 bits has its own 8 bit counter, stored one bit per word in
+		//mPlanes, so adding is a short carry chain and the per mask popcounts only happen once every 255 additions
+		class LaneCounter
 		{
-			static const std::array<std::bitset<15>, 32> formats = {
-				0b000000000000000,
-				0b000010100110111,
-				0b000101001101110,
-				0b000111101011001,
-				0b001000111101011,
-				0b001010011011100,
-				0b001101110000101,
-				0b001111010110010,
-				0b010001111010110,
-				0b010011011100001,
-				0b010100110111000,
-				0b010110010001111,
-				0b011001000111101,
-				0b011011100001010,
-				0b011100001010011,
-				0b011110101100100,
-				0b100001010011011,
-				0b100011110101100,
-				0b100100011110101,
-				0b100110111000010,
-				0b101001101110000,
-				0b101011001000111,
-				0b101100100011110,
-				0b101110000101001,
-				0b110000101001101,
-				0b110010001111010,
-				0b110101100100011,
-				0b110111000010100,
-				0b111000010100110,
-				0b111010110010001,
-				0b111101011001000,
-				0b111111111111111
-			};
-			std::bitset<5> result;
-			std::bitset<15> mask;
+			std::array<std::uint64_t, 8> mPlanes = {};
+			std::array<unsigned, 8> mCounts = {};
+			unsigned mPending = 0;
 
-			if (type == SymbolType::QR)
+			void flush()
 			{
-				mask = 21522;
+				for (unsigned plane = 0; plane < mPlanes.size(); ++plane)
+					for (unsigned mask = 0; mask < mCounts.size(); ++mask)
+						mCounts[mask] += std::popcount(mPlanes[plane] & 0x0101010101010101 << mask) << plane;
 
-				switch (level)
-				{
-					case ErrorCorrectionLevel::L:
-						result[4] = 0;
-						result[3] = 1;
-						break;
-
-					case ErrorCorrectionLevel::M:
-						result[4] = result[3] = 0;
-						break;
-
-					case ErrorCorrectionLevel::Q:
-						result[4] = result[3] = 1;
-						break;
-
-					case ErrorCorrectionLevel::H:
-						result[4] = 1;
-						result[3] = 0;
-						break;
-				}
-
-				result[2] = maskId & 1 << 2;
-				result[1] = maskId & 1 << 1;
-				result[0] = maskId & 1;
+				mPlanes = {};
+				mPending = 0;
 			}
-			else
+		public:
+			void add(std::uint64_t lanes)
 			{
-				std::uint8_t symbolNumber = 0;
-				mask = 17477;
-
-				switch (version)
+				for (unsigned plane = 0; lanes; ++plane)
 				{
+					std::uint64_t carry = mPlanes[plane] & lanes;
 
-					case 1:
-					case 2:
-						symbolNumber = version - 1;
-						break;
-
-					case 3:
-						symbolNumber = 3;
-						break;
-
-					case 4:
-						symbolNumber = 5;
-						break;
+					mPlanes[plane] ^= lanes;
+					lanes = carry;
 				}
 
-				if (level != ErrorCorrectionLevel::ERROR_DETECTION_ONLY)
-					symbolNumber += static_cast<std::uint8_t>(level);
-
-				result[4] = symbolNumber & 1 << 2;
-				result[3] = symbolNumber & 1 << 1;
-				result[2] = symbolNumber & 1;
-				result[1] = maskId & 1 << 1;
-				result[0] = maskId & 1;
+				if (++mPending == 255)
+					flush();
 			}
 
-			return formats[result.to_ulong()] ^ mask;
-		}
+			const std::array<unsigned, 8>& getCounts()
+			{
+				flush();
 
-		std::bitset<18> GetVersionInformation(std::uint8_t version)
+				return mCounts;
+			}
+		};
+
+		//Bit c of byte r ends up in bit r of byte c
+		std::uint64_t TransposeBits(std::uint64_t bits)
 		{
-			static const std::array<std::bitset<18>, 34> versionInformation = {
-				0b000111110010010100,
-				0b001000010110111100,
-				0b001001101010011001,
-				0b001010010011010011,
-				0b001011101111110110,
-				0b001100011101100010,
-				0b001101100001000111,
-				0b001110011000001101,
-				0b001111100100101000,
-				0b010000101101111000,
-				0b010001010001011101,
-				0b010010101000010111,
-				0b010011010100110010,
-				0b010100100110100110,
-				0b010101011010000011,
-				0b010110100011001001,
-				0b010111011111101100,
-				0b011000111011000100,
-				0b011001000111100001,
-				0b011010111110101011,
-				0b011011000010001110,
-				0b011100110000011010,
-				0b011101001100111111,
-				0b011110110101110101,
-				0b011111001001010000,
-				0b100000100111010101,
-				0b100001011011110000,
-				0b100010100010111010,
-				0b100011011110011111,
-				0b100100101100001011,
-				0b100101010000101110,
-				0b100110101001100100,
-				0b100111010101000001,
-				0b101000110001101001
-			};
+			std::uint64_t swapped;
 
-			return versionInformation[version - 7];
-		}
+			swapped = (bits ^ bits >> 7) & 0x00AA00AA00AA00AA, bits ^= swapped ^ swapped << 7;
+			swapped = (bits ^ bits >> 14) & 0x0000CCCC0000CCCC, bits ^= swapped ^ swapped << 14;
+			swapped = (bits ^ bits >> 28) & 0x00000000F0F0F0F0, bits ^= swapped ^ swapped << 28;
 
-		const std::vector<Symbol::size_type>& GetAlignmentPatternCenters(std::uint8_t version)
-		{
-			static const std::array<std::vector<Symbol::size_type>, 40> centers = { {
-				{},
-				{ 6, 18 },
-				{ 6, 22 },
-				{ 6, 26 },
-				{ 6, 30 },
-				{ 6, 34 },
-				{ 6, 22, 38 },
-				{ 6, 24, 42 },
-				{ 6, 26, 46 },
-				{ 6, 28, 50 },
-				{ 6, 30, 54 },
-				{ 6, 32, 58 },
-				{ 6, 34, 62 },
-				{ 6, 26, 46, 66 },
-				{ 6, 26, 48, 70 },
-				{ 6, 26, 50, 74 },
-				{ 6, 30, 54, 78 },
-				{ 6, 30, 56, 82 },
-				{ 6, 30, 58, 86 },
-				{ 6, 34, 62, 90 },
-				{ 6, 28, 50, 72, 94 },
-				{ 6, 26, 50, 74, 98 },
-				{ 6, 30, 54, 78, 102 },
-				{ 6, 28, 54, 80, 106 },
-				{ 6, 32, 58, 84, 110 },
-				{ 6, 30, 58, 86, 114 },
-				{ 6, 34, 62, 90, 118 },
-				{ 6, 26, 50, 74, 98, 122 },
-				{ 6, 30, 54, 78, 102, 126 },
-				{ 6, 26, 52, 78, 104, 130 },
-				{ 6, 30, 56, 82, 108, 134 },
-				{ 6, 34, 60, 86, 112, 138 },
-				{ 6, 30, 58, 86, 114, 142 },
-				{ 6, 34, 62, 90, 118, 146 },
-				{ 6, 30, 54, 78, 102, 126, 150 },
-				{ 6, 24, 50, 76, 102, 128, 154 },
-				{ 6, 28, 54, 80, 106, 132, 158 },
-				{ 6, 32, 58, 84, 110, 136, 162 },
-				{ 6, 26, 54, 82, 110, 138, 166 },
-				{ 6, 30, 58, 86, 114, 142, 170 }
-			} };
-
-			return centers.at(version - 1);
+			return bits;
 		}
 
-		//Returns a matrix with all the bits that correspond to function patterns or version/format information set to true
-		std::vector<std::vector<bool>> GetDataRegionMask(SymbolType type, std::uint8_t version)
+		//Byte c of block[r] ends up in byte r of block[c]
+		void TransposeLanes(std::array<std::uint64_t, 8> &block)
 		{
-			using std::vector;
-			using std::pair;
-			using SizeType = Symbol::size_type;
-			struct Rectangle
-			{
-				struct Point
-				{
-					Symbol::size_type mX;
-					Symbol::size_type mY;
-				};
-				Point mFrom;
-				Point mTo;
-			};
-			auto symbolSize = GetSymbolSize(type, version);
-			vector<vector<bool>> result(symbolSize, vector<bool>(symbolSize));
-			auto &centers = GetAlignmentPatternCenters(version);
-			vector<Rectangle> functionPatterns;
-			SizeType timingRowColumn = type == SymbolType::MICRO_QR ? 0 : 6;
+			std::uint64_t mask = 0x00000000FFFFFFFF;
 
-			//Top left finder pattern
-			functionPatterns.push_back({ { 0, 0 }, { 7, 7 } });
+			for (unsigned width = 4; width; width >>= 1, mask ^= mask << width * 8)
+				for (unsigned k = 0; k < 8; k = (k + width + 1) & ~width)
+				{
+					std::uint64_t swapped = (block[k] >> width * 8 ^ block[k + width]) & mask;
 
-			//Timing patterns
-			functionPatterns.push_back({ { timingRowColumn, 0 }, { timingRowColumn, symbolSize - 1 } });
-			functionPatterns.push_back({ { 0, timingRowColumn }, { symbolSize - 1, timingRowColumn } });
+					block[k] ^= swapped << width * 8;
+					block[k + width] ^= swapped;
+				}
+		}
 
-			//Top left format information
-			functionPatterns.push_back({ { 8, 0 }, { 8, 8 } });
-			functionPatterns.push_back({ { 0, 8 }, { 8, 8 } });
+		//Same matcher as Tables::FEATURE3_TRANSITIONS, run on 64 independent module sequences at once. mStates[s] has the bits of the matchers in state s
+		struct Feature3Matcher
+		{
+			std::array<std::uint64_t, 7> mStates = { ~std::uint64_t{ 0 } };
 
-			if (type != SymbolType::MICRO_QR)
+			//Feeds one module to every matcher, returns the ones that completed the pattern
+			std::uint64_t step(std::uint64_t dark)
 			{
-				//Top right and bottom left finder patterns
-				functionPatterns.push_back({ { 0, symbolSize - 8 }, { 7, symbolSize - 1 } });
-				functionPatterns.push_back({ { symbolSize - 8, 0 }, { symbolSize - 1, 7 } });
+				//Bit s is set if state s expects a dark module
+				const unsigned pattern = 0b1011101;
+				std::uint64_t matches = mStates[6] & dark, mismatches = 0;
 
-				//Bottom left and top right format infomation
-				functionPatterns.push_back({ { 8, symbolSize - 8 }, { 8, symbolSize - 1 } });
-				functionPatterns.push_back({ { symbolSize - 8, 8 }, { symbolSize - 1, 8 } });
+				for (unsigned state = 0; state < 7; ++state)
+					mismatches |= mStates[state] & (pattern >> state & 1 ? ~dark : dark);
 
-				//Alignment patterns
-				for (unsigned i = 0; i < centers.size(); ++i)
-					for (unsigned j = i; j < centers.size(); ++j)
-					{
-						auto centerX = centers[j], centerY = centers[i];
+				for (unsigned state = 6; state; --state)
+					mStates[state] = mStates[state - 1] & (pattern >> (state - 1) & 1 ? dark : ~dark);
 
-						if (!(centerY == 6 && centerX == symbolSize - 7 || centerY == symbolSize - 7 && centerX == 6 || centerY == 6 && centerX == 6))
-						{
-							functionPatterns.push_back({ { centerX - 2, centerY - 2 }, { centerX + 2, centerY + 2 } });
-							functionPatterns.push_back({ { centerY - 2, centerX - 2 }, { centerY + 2, centerX + 2 } });
-						}
-					}
+				mStates[1] |= mismatches & dark;
+				mStates[0] = mismatches & ~dark | matches;
 
-				if (version >= 7)
-				{
-					functionPatterns.push_back({ { 0, symbolSize - 11 }, { 5, symbolSize - 9 } });
-					functionPatterns.push_back({ { symbolSize - 11, 0 }, { symbolSize - 9, 5 } });
-				}
+				return matches;
 			}
+		};
 
-			for (const auto &rectangle : functionPatterns)
-				for (auto x = rectangle.mFrom.mX; x <= rectangle.mTo.mX; ++x)
-					for (auto y = rectangle.mFrom.mY; y <= rectangle.mTo.mY; ++y)
-						result[y][x] = true;
-
-			return result;
-		}
-
-		//From table 10, page 50.
-		bool GetMaskBit(SymbolType type, std::uint8_t maskId, Symbol::size_type i, Symbol::size_type j)
+		//Same ratings as GetSymbolRating for symbol ^ masks[m], for every mask at once. Each module is expanded to a byte with one bit per mask,
+		//so every feature is computed in a single pass over the symbol for all of them. masks can't have more than 8 matrices.
+		//Slower than rating each mask with GetSymbolRating, so only the tests use it, to check GetSymbolRating against a separate implementation
+		std::array<unsigned, 8> GetSymbolRatings(const BitMatrix &symbol, std::span<const BitMatrix> masks, SymbolType type)
 		{
-			bool result = false;
-
-			if (type == SymbolType::MICRO_QR)
-				switch (maskId)
-				{
-					case 0b00:
-						maskId = 0b001;
-						break;
+			const size_t PAD = BitSlicedScratch::PAD;
+			BitSlicedScratch scratch;
+			std::ptrdiff_t size = symbol.getWidth();
+			std::array<unsigned, 8> result = {};
 
-					case 0b01:
-						maskId = 0b100;
-						break;
-
-					case 0b10:
-						maskId = 0b110;
-						break;
-
-					case 0b11:
-						maskId = 0b111;
-						break;
-				}
-
-			switch (maskId)
-			{
-				case 0b000:
-					result = !((i + j) % 2);
-					break;
+			if (masks.size() > 8)
+				throw std::invalid_argument("Too many masks");
 
-				case 0b001:
-					result = !(i % 2);
-					break;
+			scratch.mStride = PAD + (size + 7) / 8 * 8 + PAD;
+			scratch.mLight.assign((size + PAD * 2) * scratch.mStride, 0);
+			scratch.mLightTransposed.assign((size + PAD * 2) * scratch.mStride, 0);
 
-				case 0b010:
-					result = !(j % 3);
-					break;
-
-				case 0b011:
-					result = !((i + j) % 3);
-					break;
+			for (std::ptrdiff_t i = 0; i < size; ++i)
+				for (size_t word = 0; word < symbol.getWordsPerRow(); ++word)
+				{
+					std::array<BitMatrix::WordType, 8> masked;
 
-				case 0b100:
-					result = !((i / 2 + j / 3) % 2);
-					break;
+					for (size_t mask = 0; mask < masked.size(); ++mask)
+						masked[mask] = symbol.getRow(i)[word] ^ (mask < masks.size() ? masks[mask].getRow(i)[word] : 0);
 
-				case 0b101:
-					result = !((i * j) % 2 + (i * j) % 3);
-					break;
+					for (std::ptrdiff_t column = word * BitMatrix::WORD_BITS; column < size && column < static_cast<std::ptrdiff_t>((word + 1) * BitMatrix::WORD_BITS); column += 8)
+					{
+						std::uint64_t dark = 0;
 
-				case 0b110:
-					result = !(((i * j) % 2 + (i * j) % 3) % 2);
-					break;
+						for (size_t mask = 0; mask < masked.size(); ++mask)
+							dark |= (masked[mask] >> column % BitMatrix::WORD_BITS & 0xFF) << mask * 8;
 
-				case 0b111:
-					result = !(((i + j) % 2 + (i * j) % 3) % 2);
-					break;
-			}
+						StoreLanes(scratch.mLight.data() + (PAD + i) * scratch.mStride + PAD + column, ~TransposeBits(dark) & GetLaneMask(0, size - column));
+					}
+				}
 
-			return result;
-		}
+			for (std::ptrdiff_t i = 0; i < size; i += 8)
+				for (std::ptrdiff_t j = 0; j < size; j += 8)
+				{
+					std::array<std::uint64_t, 8> block;
 
-		unsigned GetFeature1Points(unsigned adjacentCount)
-		{
-			unsigned result = 0;
+					for (std::ptrdiff_t k = 0; k < 8; ++k)
+						block[k] = LoadLanes(scratch.getLight(i + k, j));
 
-			if (adjacentCount >= 5)
-				result += 3 + adjacentCount - 5;
+					TransposeLanes(block);
 
-			return result;
-		}
+					for (std::ptrdiff_t k = 0; k < 8; ++k)
+						StoreLanes(scratch.mLightTransposed.data() + (PAD + j + k) * scratch.mStride + PAD + i, block[k]);
+				}
 
-		unsigned GetSymbolRating(const Symbol &symbol, SymbolType type)
-		{
 			if (type == SymbolType::QR)
 			{
-				static const std::vector<bool> feature3Pattern = { 1, 0, 1, 1, 1, 0, 1 };
-				unsigned feature1Score = 0, feature2Score = 0, feature3Score = 0, feature4Score = 0;
-				size_t totalModules = symbol.size() * symbol.size(), darkModules = 0;
-				int percentage = 0;
+				LaneCounter fiveEqual, runStarts, blocks, patterns, light;
 
-				for (Symbol::size_type i = 0; i < symbol.size(); ++i)
+				//Features 1, 2 and 4, 8 modules at a time. Rows come from mLight and columns from mLightTransposed
+				for (std::ptrdiff_t j = 0; j < size; j += 8)
 				{
-					unsigned consecutiveRowCounter = 0, consecutiveColumnCounter = 0, feature3Row = 0, feature3Column = 0;
-					bool consecutiveRowValue = false, consecutiveColumnValue = false;
+					//equalMasks[k] keeps the lanes where modules j + k - 1 and j + k are both inside the symbol
+					std::array<std::uint64_t, 5> equalMasks;
+					std::uint64_t blockMask = GetLaneMask(0, size - 1 - j);
 
-					for (Symbol::value_type::size_type j = 0; j < symbol[i].size(); ++j)
-					{
-						//Feature 1
-						if (symbol[i][j] == consecutiveRowValue)
-							++consecutiveRowCounter;
-						else
-						{
-							feature1Score += GetFeature1Points(consecutiveRowCounter);
-							consecutiveRowValue = symbol[i][j], consecutiveRowCounter = 1;
-						}
+					for (std::ptrdiff_t k = 0; k < 5; ++k)
+						equalMasks[k] = GetLaneMask(1 - j - k, size - j - k);
 
-						if (symbol[j][i] == consecutiveColumnValue)
-							++consecutiveColumnCounter;
-						else
+					for (std::ptrdiff_t i = 0; i < size; ++i)
+					{
+						for (const std::uint8_t *modules : { scratch.getLight(i, j), scratch.getLightTransposed(i, j) })
 						{
-							feature1Score += GetFeature1Points(consecutiveColumnCounter);
-							consecutiveColumnValue = symbol[j][i], consecutiveColumnCounter = 1;
-						}
+							std::array<std::uint64_t, 5> equal;
+							std::uint64_t five;
 
-						//Feature 2
-						if (i < symbol.size() - 1 &&
-							j < symbol[i].size() - 1 &&
-							symbol[i][j] == symbol[i][j + 1] &&
-							symbol[i][j] == symbol[i + 1][j] &&
-							symbol[i][j] == symbol[i + 1][j + 1])
-							feature2Score += 3;
-
-						//Feature 3
-						if (symbol[i][j] == feature3Pattern[feature3Row])
-							++feature3Row;
-						else
-						{
-							feature3Row = 0;
-							if (symbol[i][j] == feature3Pattern[feature3Row])
-								++feature3Row;
-						}
+							for (std::ptrdiff_t k = 0; k < 5; ++k)
+								equal[k] = ~(LoadLanes(modules + k - 1) ^ LoadLanes(modules + k)) & equalMasks[k];
 
-						if (symbol[j][i] == feature3Pattern[feature3Column])
-							++feature3Column;
-						else
-						{
-							feature3Column = 0;
-							if (symbol[j][i] == feature3Pattern[feature3Column])
-								++feature3Column;
+							five = equal[1] & equal[2] & equal[3] & equal[4];
+							fiveEqual.add(five);
+							runStarts.add(five & ~equal[0]);
 						}
 
-						if (feature3Column == feature3Pattern.size())
+						if (i + 1 < size)
 						{
-							if (i + 4 < symbol.size() && !symbol[i + 1][j] && !symbol[i + 2][j] && !symbol[i + 3][j] && !symbol[i + 4][j] ||
-								i >= 10 && !symbol[i - 7][j] && !symbol[i - 8][j] && !symbol[i - 9][j] && !symbol[i - 10][j])
-								feature3Score += 40;
+							std::uint64_t row = LoadLanes(scratch.getLight(i, j)), nextRow = LoadLanes(scratch.getLight(i + 1, j));
+							std::uint64_t verticalEqual = ~(row ^ nextRow), nextVerticalEqual = ~(LoadLanes(scratch.getLight(i, j + 1)) ^ LoadLanes(scratch.getLight(i + 1, j + 1)));
 
-							feature3Column = 0;
+							blocks.add(verticalEqual & nextVerticalEqual & ~(row ^ LoadLanes(scratch.getLight(i, j + 1))) & blockMask);
 						}
 
-						if (feature3Row == feature3Pattern.size())
-						{
-							if (j + 4 < symbol.size() && !symbol[i][j + 1] && !symbol[i][j + 2] && !symbol[i][j + 3] && !symbol[i][j + 4] ||
-								j >= 10 && !symbol[i][j - 7] && !symbol[i][j - 8] && !symbol[i][j - 9] && !symbol[i][j - 10])
-								feature3Score += 40;
+						light.add(LoadLanes(scratch.getLight(i, j)));
+					}
+				}
 
-							feature3Row = 0;
-						}
+				//Feature 3, 8 rows or 8 columns at a time. Candidates use the same light modules as GetSymbolRating
+				for (std::ptrdiff_t first = 0; first < size; first += 8)
+				{
+					Feature3Matcher rowMatcher, columnMatcher;
+					std::uint64_t valid = GetLaneMask(0, size - first);
 
-						//Feature 4
-						if (symbol[j][i])
-							++darkModules;
-					}
+					for (std::ptrdiff_t p = 0; p < size; ++p)
+					{
+						auto rowLight = [&](std::ptrdiff_t offset) { return LoadLanes(scratch.getLightTransposed(p + offset, first)); };
+						auto columnLight = [&](std::ptrdiff_t offset) { return LoadLanes(scratch.getLightTransposed(p, first + offset)); };
+						std::uint64_t rowMatches = rowMatcher.step(~rowLight(0) & valid), columnMatches = columnMatcher.step(~LoadLanes(scratch.getLight(p, first)) & valid);
 
-					//Feature 1
-					//In case the row/column ended without breaking the chain of consecutive modules
-					feature1Score += GetFeature1Points(consecutiveRowCounter);
-					feature1Score += GetFeature1Points(consecutiveColumnCounter);
+						patterns.add(rowMatches & (rowLight(1) & rowLight(2) & rowLight(3) & rowLight(4) | rowLight(-7) & rowLight(-8) & rowLight(-9) & rowLight(-10)));
+						patterns.add(columnMatches & (columnLight(1) & columnLight(2) & columnLight(3) & columnLight(4) | columnLight(-7) & columnLight(-8) & columnLight(-9) & columnLight(-10)));
+					}
 				}
 
-				percentage = static_cast<int>(static_cast<double>(darkModules) / static_cast<double>(totalModules) * 100.);
-				feature4Score = std::abs(percentage - 50) / 5 * 10;
+				for (size_t mask = 0; mask < masks.size(); ++mask)
+				{
+					int percentage = static_cast<int>(static_cast<double>(size * size - light.getCounts()[mask]) / static_cast<double>(size * size) * 100.);
 
-				return feature1Score + feature2Score + feature3Score + feature4Score;
+					result[mask] = fiveEqual.getCounts()[mask] + runStarts.getCounts()[mask] * 2 + blocks.getCounts()[mask] * 3 + patterns.getCounts()[mask] * 40 + std::abs(percentage - 50) / 5 * 10;
+				}
 			}
 			else
 			{
-				unsigned darkRow = 0, darkColumn = 0;
+				std::array<unsigned, 8> darkRow = {}, darkColumn = {};
 
 				//Start at 1 to avoid timing pattern
-				for (Symbol::size_type i = 1, sz = symbol.size(); i < sz; ++i)
-				{
-					if (symbol[i][sz - 1])
-						++darkColumn;
-
-					if (symbol[sz - 1][i])
-						++darkRow;
-				}
+				for (std::ptrdiff_t i = 1; i < size; ++i)
+					for (size_t mask = 0; mask < masks.size(); ++mask)
+					{
+						darkColumn[mask] += ~*scratch.getLight(i, size - 1) >> mask & 1;
+						darkRow[mask] += ~*scratch.getLight(size - 1, i) >> mask & 1;
+					}
 
-				return darkColumn <= darkRow ? darkColumn * 16 + darkRow : darkRow * 16 + darkColumn;
+				for (size_t mask = 0; mask < masks.size(); ++mask)
+					result[mask] = darkColumn[mask] <= darkRow[mask] ? darkColumn[mask] * 16 + darkRow[mask] : darkRow[mask] * 16 + darkColumn[mask];
 			}
+
+			return result;
 		}
 
-		std::uint16_t ToInteger(const std::vector<std::string::value_type> &characters)
+		std::uint16_t ToInteger(std::string_view characters)
 		{
 			std::uint16_t result = 0, multiplier = 1;
 
-			for (std::vector<std::string::value_type>::const_reverse_iterator it = characters.crbegin(); it != characters.crend(); ++it, multiplier *= 10)
+			for (auto it = characters.crbegin(); it != characters.crend(); ++it, multiplier *= 10)
 			{
 				if (*it < 0x30 || *it > 0x39)
-				{
-					std::ostringstream stream;
-
-					stream << std::hex << std::uppercase << (static_cast<int>(*it) & 0xFF);
-					throw std::invalid_argument("Character 0x" + stream.str() + " can't be encoded in numeric mode");
-				}
+					ThrowInvalidCharacter(static_cast<std::uint8_t>(*it), "numeric");
 
 				result += (*it - 0x30) * multiplier;
 			}
@@ -871,55 +393,25 @@ namespace QR
 			return result;
 		}
 
+		//From table 5, page 27. Lowercase letters get the same values as uppercase ones
 		std::uint8_t GetAlphanumericCode(std::string_view::value_type character)
 		{
-			std::uint8_t result = 0;
-
-			if (character >= 0x30 && character <= 0x39) //numbers
-				result = character - 0x30;
-			else if (character >= 0x41 && character <= 0x5A) //uppercase letters
-				result = character - 0x41 + 10;
-			else if (character >= 0x61 && character <= 0x7A) //lowercase letters
-				result = character - 0x61 + 10;
-			else
-			{
-				std::string_view specialCharacters = " $%*+-./:";
-				auto index = specialCharacters.find(character);
-
-				if (index != std::string_view::npos)
-					result = 36 + index;
-				else
-				{
-					std::ostringstream stream;
-
-					stream << std::hex << std::uppercase << (static_cast<int>(character) & 0xFF);
-					throw std::invalid_argument("Character 0x" + stream.str() + " can't be encoded in alphanumeric mode");
-				}
-			}
-
-			return result;
-		}
-
-		//From figure H.1, page 93
-		bool IsKanji(std::uint16_t character)
-		{
-			std::uint8_t leadingByte = character >> 8, trailerByte = character & 0xFF;
+			if (!(GetCharacterClass(character) & ALPHANUMERIC_CHARACTER))
+				ThrowInvalidCharacter(static_cast<std::uint8_t>(character), "alphanumeric");
 
-			return (leadingByte >= 0x81 && leadingByte <= 0x9F || leadingByte >= 0xE0 && leadingByte <= 0xEA)
-				&& (trailerByte >= 0x40 && trailerByte <= 0x7E || trailerByte >= 0x80 && trailerByte <= 0xFC)
-				|| leadingByte == 0xEB && (trailerByte >= 0x40 && trailerByte <= 0x7E || trailerByte >= 0x80 && trailerByte <= 0xBF);
+			return GetAlphanumericValue(character);
 		}
 
-		//Returns the most compact Mode in which the character can be encoded in.
-		Mode GetMinimalMode(std::uint8_t leadingByte, std::optional<std::uint8_t> trailerByte = std::optional<std::uint8_t>())
+		//Returns the most compact Mode in which the character can be encoded in and read back unchanged, so lowercase letters are in byte mode.
+		//characterClass is the class of leadingByte
+		Mode GetMinimalMode(std::uint8_t characterClass, std::uint8_t leadingByte, std::optional<std::uint8_t> trailerByte)
 		{
-			static const std::unordered_set<std::uint8_t> characters = { ' ', '$', '%', '*', '+', '-', '.', '/', ':' };
 			Mode result;
 
-			if (leadingByte >= 0x30 && leadingByte <= 0x39)
+			if (characterClass & NUMERIC_CHARACTER)
 				result = Mode::NUMERIC;
 			else
-				if (leadingByte >= 0x41 && leadingByte <= 0x5A || leadingByte >= 0x61 && leadingByte <= 0x7A || characters.count(leadingByte))
+				if (characterClass & STRICT_ALPHANUMERIC_CHARACTER)
 					result = Mode::ALPHANUMERIC;
 				else
 					if (trailerByte.has_value() && IsKanji(leadingByte << 8 | trailerByte.value()))
@@ -930,573 +422,1141 @@ namespace QR
 			return result;
 		}
 
-		const std::regex& GetECIRegex()
+		Mode GetMinimalMode(std::uint8_t leadingByte, std::optional<std::uint8_t> trailerByte = std::optional<std::uint8_t>())
 		{
-			static const std::regex eciFormat(R"((\\)?\\([^\\]{0,6}))");
-
-			return eciFormat;
+			return GetMinimalMode(GetCharacterClass(leadingByte), leadingByte, trailerByte);
 		}
 
-		void DrawFinderPattern(Symbol &symbol, Symbol::size_type startingRow, Symbol::size_type startingColumn)
+		template<typename T>
+		struct VersionCacheEntry
 		{
-			for (decltype(startingRow) i = startingRow; i < startingRow + 7; ++i)
-				for (decltype(startingColumn) j = startingColumn; j < startingColumn + 7; ++j)
-				{
-					switch (i - startingRow)
-					{
-						case 0:
-						case 6:
-							symbol[i][j] = true;
-							break;
-
-						case 1:
-						case 5:
-							if (j - startingColumn == 0 || j - startingColumn == 6)
-								symbol[i][j] = true;
-							break;
-
-						case 2:
-						case 3:
-						case 4:
-							if (j - startingColumn == 0 || j - startingColumn == 2 || j - startingColumn == 3 || j - startingColumn == 4 || j - startingColumn == 6)
-								symbol[i][j] = true;
-							break;
-					}
-				}
+			std::once_flag mBuilt;
+			T mValue;
+		};
+
+		//Returns the value built by builder for the given symbol type and version. builder runs once per version for the whole process,
+		//every call site must use its own T/Builder pair.
+		template<typename T, typename Builder>
+		const T& GetVersionCacheEntry(SymbolType type, std::uint8_t version, Builder builder)
+		{
+			static std::array<VersionCacheEntry<T>, 40> entries;
+			static std::array<VersionCacheEntry<T>, 4> microEntries;
+
+			if (!version || version > (type == SymbolType::MICRO_QR ? microEntries.size() : entries.size()))
+				throw std::invalid_argument("Invalid version");
+
+			auto &entry = type == SymbolType::MICRO_QR ? microEntries[version - 1] : entries[version - 1];
+
+			std::call_once(entry.mBuilt, [&entry, &builder] { entry.mValue = builder(); });
+
+			return entry.mValue;
 		}
 
-		void DrawTimingPatterns(Symbol &symbol, SymbolType type, std::uint8_t version)
+		std::atomic<size_t>& GetMaskPatternCacheCounter()
 		{
-			auto size = GetSymbolSize(type, version);
-			unsigned rowColumn = type == SymbolType::MICRO_QR ? 0 : 6;
+			static std::atomic<size_t> bytes = 0;
 
-			for (unsigned i = 8; i < (type == SymbolType::MICRO_QR ? size : size - 8); ++i)
-				symbol[i][rowColumn] = symbol[rowColumn][i] = !(i % 2);
+			return bytes;
 		}
 
-		void DrawAlignmentPatterns(Symbol &symbol, std::uint8_t version)
+		//Everything in a symbol that only depends on its type and version
+		struct SymbolTemplate
 		{
-			const std::vector<Symbol::size_type> &centers = GetAlignmentPatternCenters(version);
-			auto symbolSize = GetSymbolSize(QR::SymbolType::QR, version);
+			BitMatrix mFunctionPatterns; //Finder, alignment and timing patterns
+			BitMatrix mDataRegionMask; //From GetDataRegionMask
+			BitMatrix mVersionInformation; //Empty for versions below 7
+		};
 
-			for (decltype(centers.size()) i = 0; i < centers.size(); ++i)
-				for (auto j = i; j < centers.size(); ++j)
-				{
-					auto centerX = centers[j], centerY = centers[i];
+		const SymbolTemplate& GetSymbolTemplate(SymbolType type, std::uint8_t version)
+		{
+			return GetVersionCacheEntry<SymbolTemplate>(type, version, [type, version] {
+				auto size = GetSymbolSize(type, version);
+				SymbolTemplate result = { BitMatrix(size, size), GetDataRegionMask(type, version), BitMatrix(size, size) };
 
-					if (!(centerY == 6 && centerX == symbolSize - 7 || centerY == symbolSize - 7 && centerX == 6 || centerY == 6 && centerX == 6))
-						for (auto startX = centerX - 2, x = startX; x < centerX + 3; ++x)
-							for (auto startY = centerY - 2, y = startY; y < centerY + 3; ++y)
-							{
-								switch (y - startY)
-								{
-									case 0:
-									case 4:
-										symbol[y][x] = symbol[x][y] = true;
-										break;
-
-									case 2:
-										if (x - startX == 0 || x - startX == 2 || x - startX == 4)
-										{
-											symbol[y][x] = symbol[x][y] = true;
-											break;
-										}
-										[[fallthrough]];
-
-									case 1:
-									case 3:
-										if (x - startX == 0 || x - startX == 4)
-											symbol[y][x] = symbol[x][y] = true;
-										break;
-								}
-							}
-				}
+				DrawFunctionPatterns(type, version, [&result](unsigned row, unsigned column) { result.mFunctionPatterns.set(row, column, true); });
+				DrawVersionInformation(type, version, [&result](unsigned row, unsigned column, bool value) { result.mVersionInformation.set(row, column, value); });
+
+				return result;
+			});
 		}
 
-		void DrawFormatInformation(Symbol &symbol, SymbolType type, std::uint8_t version, ErrorCorrectionLevel level, size_t maskId)
+		//Mask patterns for every mask id, already cleared over function patterns and format/version information, so masking a symbol is a single XOR.
+		//Micro QR symbols only use the first 4.
+		const std::array<BitMatrix, 8>& GetMaskPatterns(SymbolType type, std::uint8_t version)
 		{
-			auto formatInfo = GetFormatInformation(type, version, level, maskId);
-			unsigned timingPatternRowColumn = type == SymbolType::MICRO_QR ? 0 : 6, symbolSize = GetSymbolSize(type, version), bitIndex = 0;
+			return GetVersionCacheEntry<std::array<BitMatrix, 8>>(type, version, [type, version] {
+				std::array<BitMatrix, 8> result;
+				auto &mask = GetSymbolTemplate(type, version).mDataRegionMask;
+				auto size = GetSymbolSize(type, version);
 
-			for (unsigned i = 0; i < 8; ++i)
-				if (i != timingPatternRowColumn)
-					symbol[i][8] = formatInfo[bitIndex++];
+				for (std::uint8_t maskId = 0, sz = type == SymbolType::MICRO_QR ? 4 : 8; maskId < sz; ++maskId)
+				{
+					result[maskId] = BitMatrix(size, size);
 
-			for (unsigned i = 9; i--;)
-				if (i != timingPatternRowColumn)
-					symbol[8][i] = formatInfo[bitIndex++];
+					for (BitMatrix::size_type i = 0; i < size; ++i)
+						for (BitMatrix::size_type word = 0; word < mask.getWordsPerRow(); ++word)
+							result[maskId].getRow(i)[word] = GetMaskPatternWord(type, maskId, static_cast<unsigned>(i), static_cast<unsigned>(word * BitMatrix::WORD_BITS), size)
+								& ~mask.getRow(i)[word];
 
-			if (type == SymbolType::QR)
-			{
-				symbol[symbolSize - 8][8] = 1; //This module is always dark
+					GetMaskPatternCacheCounter() += result[maskId].getWords().size() * sizeof(BitMatrix::WordType);
+				}
 
-				for (bitIndex = 0; bitIndex < formatInfo.size(); ++bitIndex)
-					if (bitIndex <= 7)
-						symbol[8][symbolSize - 1 - bitIndex] = formatInfo[bitIndex];
-					else
-						symbol[symbolSize - formatInfo.size() + bitIndex][8] = formatInfo[bitIndex];
-			}
+				return result;
+			});
 		}
 
-		void DrawVersionInformation(Symbol &symbol, SymbolType type, std::uint8_t version)
+		struct ModulePosition
 		{
-			auto versionInfo = GetVersionInformation(version);
-			auto symbolSize = GetSymbolSize(type, version);
+			std::uint8_t mRow;
+			std::uint8_t mColumn;
+		};
 
-			for (unsigned i = symbolSize - 11, j = 0, bitIndex = 0; bitIndex < versionInfo.size(); ++i, ++bitIndex)
-			{
-				if (!(bitIndex % 3) && bitIndex)
-					i -= 3, ++j;
+		//Positions of every data and error correction module, in the order codeword bits are placed. From figure 13, page 47
+		const std::vector<ModulePosition>& GetPlacementOrder(SymbolType type, std::uint8_t version)
+		{
+			return GetVersionCacheEntry<std::vector<ModulePosition>>(type, version, [type, version] {
+				std::vector<ModulePosition> result;
+				auto &mask = GetSymbolTemplate(type, version).mDataRegionMask;
 
-				symbol[i][j] = symbol[j][i] = versionInfo[bitIndex];
-			}
+				result.reserve(GetDataModuleCount(type, version));
+				WalkPlacementOrder(type, version, [&mask](int row, int column) { return mask.get(row, column); },
+					[&result](int row, int column) { result.push_back({ static_cast<std::uint8_t>(row), static_cast<std::uint8_t>(column) }); });
+
+				return result;
+			});
 		}
 
-		void ValidateArguments(SymbolType type, std::uint8_t version, ErrorCorrectionLevel level)
+		//Blocks with the same number of data codewords. Codeword i of block b is at index i * mBlockCount + b
+		struct BlockGroup
 		{
-			if (!version)
-				throw std::invalid_argument("Minimum version for QR and Micro QR symbols is 1");
+			unsigned mBlockCount;
+			unsigned mDataLength;
+			std::vector<std::uint8_t> mData;
+			std::vector<std::uint8_t> mErrorCorrection;
+		};
+
+		//Runs task(0) to task(count - 1), each on its own thread except the last one, which runs on the calling thread. If a thread can't be started,
+		//the calling thread runs that task and the ones after it. Rethrows the first exception of a task
+		template<typename Function>
+		void RunInParallel(size_t count, Function task)
+		{
+			std::vector<std::future<void>> futures;
+			size_t first = 0;
 
-			if (type == SymbolType::MICRO_QR)
+			futures.reserve(count);
+
+			try
+			{
+				for (; first + 1 < count; ++first)
+					futures.push_back(std::async(std::launch::async, task, first));
+			}
+			catch (const std::exception&)
 			{
-				if (version > 4)
-					throw std::invalid_argument("Max version for Micro QR symbols is M4");
+				//Out of threads or memory, the symbol is still generated
+			}
 
-				if (version == 1 && level != ErrorCorrectionLevel::ERROR_DETECTION_ONLY)
-					throw std::invalid_argument("M1 symbols don't support error correction");
+			for (; first < count; ++first)
+				task(first);
 
-				if (version != 1 && level == ErrorCorrectionLevel::ERROR_DETECTION_ONLY)
-					throw std::invalid_argument("ERROR_DETECTION_ONLY is only for M1 symbols");
+			for (auto &future : futures)
+				future.get();
+		}
 
-				if (level == ErrorCorrectionLevel::Q && version != 4)
-					throw std::invalid_argument("Level Q error correction in Micro QR symbols is only supported in version M4");
+		//Calls encode, which appends to stream. If encode throws or stream grows past capacity, stream is left as it was
+		template<typename Function>
+		void AppendWithinCapacity(BitStream &stream, size_t capacity, Function encode)
+		{
+			size_t size = stream.size();
 
-				if (level == ErrorCorrectionLevel::H)
-					throw std::invalid_argument("Level H error correction is not supported in Micro QR symbols");
+			try
+			{
+				encode();
 			}
-			else if (type == SymbolType::QR)
+			catch (...)
 			{
-				if (version > 40)
-					throw std::invalid_argument("Max version for QR symbols is 40");
+				stream.resize(size);
+				throw;
+			}
 
-				if (level == ErrorCorrectionLevel::ERROR_DETECTION_ONLY)
-					throw std::invalid_argument("ERROR_DETECTION_ONLY is only for M1 symbols");
+			if (stream.size() > capacity)
+			{
+				stream.resize(size);
+				throw std::length_error("Data bit stream would exceed the symbol's capacity");
 			}
 		}
 
-		#ifndef TESTS
-	}
-	#endif
-}
+		//Splits message into the segments that give the shortest bit stream for the symbol described by descriptor. ECI sequences start a new segment.
+		//Bits are counted exactly, numeric and alphanumeric states remember how many characters of the current group are already encoded.
+		std::vector<Segment> GetOptimalSegments(const SymbolDescriptor &descriptor, std::string_view message)
+		{
+			struct Unit
+			{
+				size_t mIndex;
+				unsigned mLength; //Bytes in message
+				unsigned mByteCount; //Bytes in byte mode, a double backslash is a single byte
+				Mode mMode;
+			};
+			enum State : std::uint8_t { NUMERIC_0, NUMERIC_1, NUMERIC_2, ALPHANUMERIC_0, ALPHANUMERIC_1, BYTE, KANJI, STATE_COUNT };
+			static const std::array<Mode, STATE_COUNT> stateModes = { Mode::NUMERIC, Mode::NUMERIC, Mode::NUMERIC, Mode::ALPHANUMERIC, Mode::ALPHANUMERIC, Mode::BYTE, Mode::KANJI };
+			const size_t UNREACHABLE = std::numeric_limits<size_t>::max();
+			std::array<unsigned, 4> headerLengths;
+			std::array<bool, 4> supportedModes;
+			std::vector<Segment> result;
+			std::vector<std::uint8_t> classes(message.size());
+
+			for (size_t mode = 0; mode < headerLengths.size(); ++mode)
+			{
+				headerLengths[mode] = GetModeIndicator(descriptor.mType, descriptor.mVersion, static_cast<Mode>(mode)).mLength + descriptor.mCharacterCountLengths[mode];
+				supportedModes[mode] = descriptor.mType == SymbolType::QR || descriptor.mVersion >= 3 || mode == 0 || mode == 1 && descriptor.mVersion == 2;
+			}
 
-struct QR::Encoder::Impl
-{
-	std::vector<bool> mBitStream;
-	unsigned mVersion;
-	SymbolType mType;
-	ErrorCorrectionLevel mLevel;
-};
+			ClassifyCharacters(message, classes);
 
-QR::Encoder::Encoder(SymbolType type, unsigned version, ErrorCorrectionLevel level)
-	:mImpl(new Impl{ {}, version, type, level })
-{
-	ValidateArguments(type, version, level);
-}
+			for (size_t partIndex = 0; partIndex < message.size();)
+			{
+				std::vector<Unit> units;
+				std::vector<std::array<size_t, STATE_COUNT>> costs;
+				std::vector<std::array<std::uint8_t, STATE_COUNT>> previousStates;
+				size_t i = partIndex;
 
-QR::Encoder::Encoder(const Encoder &other)
-	:mImpl(new Impl{ *other.mImpl })
-{}
+				//Same ECI sequence format as addCharacters, a backslash and 6 digits
+				if (message[i] == 0x5C && (i + 1 == message.size() || message[i + 1] != 0x5C))
+				{
+					auto digits = message.substr(i + 1, 6);
 
-QR::Encoder::Encoder(Encoder&&) noexcept = default;
+					if (digits.size() != 6 || digits.find(0x5C) != std::string_view::npos)
+						throw std::invalid_argument("Invalid ECI sequence");
 
-QR::Encoder &QR::Encoder::operator=(const Encoder &other)
-{
-	*mImpl = *other.mImpl;
+					i += 7;
+				}
 
-	return *this;
-}
+				while (i < message.size() && (message[i] != 0x5C || i + 1 < message.size() && message[i + 1] == 0x5C))
+				{
+					Unit unit = { i, 1, 1, Mode::BYTE };
 
-QR::Encoder &QR::Encoder::operator=(Encoder&&) noexcept = default;
+					if (message[i] == 0x5C)
+						unit.mLength = 2;
+					else
+					{
+						unit.mMode = GetMinimalMode(classes[i], message[i], i + 1 < message.size() ? std::optional<std::uint8_t>(message[i + 1]) : std::optional<std::uint8_t>());
 
-QR::Encoder::~Encoder() = default;
+						//A trailing backslash would be read as an escape
+						if (unit.mMode == Mode::KANJI && message[i + 1] == 0x5C)
+							unit.mMode = Mode::BYTE;
 
-void QR::Encoder::addCharacters(std::string_view message, Mode mode)
-{
-	using std::get;
-	const std::regex &eciFormat = GetECIRegex();
-	std::vector<bool> modeIndicator = GetModeIndicator(mImpl->mType, mImpl->mVersion, mode), dataBits;
-	std::vector<std::tuple<size_t, size_t, std::optional<unsigned>>> ranges; //<index, byte count, ECI>
-	unsigned dataModuleCount = GetDataModuleCount(mImpl->mType, mImpl->mVersion) - GetRemainderBitCount(mImpl->mType, mImpl->mVersion) - GetErrorCorrectionCodewordCount(mImpl->mType, mImpl->mVersion, mImpl->mLevel) * 8;
-	unsigned doubleSlashCount = 0;
-
-	for (std::regex_iterator<decltype(message)::const_iterator> it(message.cbegin(), message.cend(), eciFormat), end; it != end; ++it)
-	{
-		if (auto &results = *it; !results[1].matched)
-		{
-			if (results[2].length() != 6)
-				throw std::invalid_argument("Invalid ECI sequence");
-			try
-			{
-				if (!ranges.empty())
-					get<1>(ranges.back()) = results.position() - get<0>(ranges.back());
-				else
-					if (results.position())
-						ranges.emplace_back(0, results.position(), std::optional<unsigned>());
+						if (unit.mMode == Mode::KANJI)
+							unit.mLength = unit.mByteCount = 2;
+					}
 
-				ranges.emplace_back(results.position() + results.length(), message.size() - (results.position() + results.length()), std::stoul(results[2].str()));
-			}
-			catch (const std::invalid_argument&)
-			{
-				throw std::invalid_argument("Invalid ECI sequence");
-			}
-		}
-		else
-			++doubleSlashCount;
-	}
+					units.push_back(unit);
+					i += unit.mLength;
+				}
 
-	if (ranges.empty())
-		ranges.emplace_back(0, message.size(), std::optional<unsigned>());
-	else
-		if (mImpl->mType == QR::SymbolType::MICRO_QR)
-			throw std::invalid_argument("ECI is not supported in Micro QR symbols");
+				costs.assign(units.size() + 1, {});
+				costs[0].fill(UNREACHABLE);
+				previousStates.resize(units.size() + 1);
 
-	for (auto [index, byteCount, eci] : ranges)
-	{
-		auto characterCount = GetCharacterCountIndicator(mImpl->mType, mImpl->mVersion, mode, mode == Mode::KANJI ? byteCount / 2 : byteCount - doubleSlashCount);
+				for (size_t unitIndex = 0; unitIndex < units.size(); ++unitIndex)
+				{
+					const auto &unit = units[unitIndex];
+					auto &next = costs[unitIndex + 1];
 
-		if (mode == Mode::KANJI && byteCount % 2)
-			throw std::invalid_argument("Invalid Kanji sequence");
+					next.fill(UNREACHABLE);
 
-		if (eci)
-		{
-			auto eciBits = GetECISequence(eci.value());
+					for (std::uint8_t state = 0; state < STATE_COUNT; ++state)
+					{
+						Mode mode = stateModes[state];
+						bool allowed = mode == Mode::BYTE || mode == unit.mMode || mode == Mode::ALPHANUMERIC && unit.mMode == Mode::NUMERIC;
+						unsigned bitCount;
+						std::uint8_t previousState;
 
-			dataBits.insert(dataBits.end(), eciBits.begin(), eciBits.end());
-		}
+						if (!allowed || !supportedModes[static_cast<size_t>(mode)])
+							continue;
 
-		dataBits.insert(dataBits.end(), modeIndicator.begin(), modeIndicator.end());
-		dataBits.insert(dataBits.end(), characterCount.begin(), characterCount.end());
+						//Characters that complete a group cost less than the ones that start it
+						switch (state)
+						{
+							case NUMERIC_1:
+								bitCount = 4, previousState = NUMERIC_0;
+								break;
 
-		switch (mode)
-		{
-			case Mode::NUMERIC:
-			{
-				std::vector<decltype(message)::value_type> digits;
+							case NUMERIC_2:
+								bitCount = 3, previousState = NUMERIC_1;
+								break;
 
-				for (decltype(message)::size_type i = index; i < index + byteCount; ++i)
-				{
-					digits.push_back(message[i]);
+							case NUMERIC_0:
+								bitCount = 3, previousState = NUMERIC_2;
+								break;
 
-					if (digits.size() == 3 || i == (index + byteCount) - 1 && !digits.empty())
-					{
-						unsigned encodedDigits = ToInteger(digits);
+							case ALPHANUMERIC_1:
+								bitCount = 6, previousState = ALPHANUMERIC_0;
+								break;
 
-						for (size_t bit = 0, bitCount = digits.size() * 3 + 1; bit < bitCount; ++bit)
-							dataBits.push_back(encodedDigits & 1 << (bitCount - 1) >> bit);
+							case ALPHANUMERIC_0:
+								bitCount = 5, previousState = ALPHANUMERIC_1;
+								break;
+
+							case BYTE:
+								bitCount = unit.mByteCount * 8, previousState = BYTE;
+								break;
+
+							default:
+								bitCount = 13, previousState = KANJI;
+								break;
+						}
+
+						//Continue the current segment
+						if (unitIndex && costs[unitIndex][previousState] != UNREACHABLE)
+							next[state] = costs[unitIndex][previousState] + bitCount, previousStates[unitIndex + 1][state] = previousState;
+
+						//Or start a new one, which always begins a group
+						if (state == NUMERIC_1 || state == ALPHANUMERIC_1 || state == BYTE || state == KANJI)
+						{
+							size_t start = 0;
+							std::uint8_t startState = STATE_COUNT;
 
-						digits.clear();
+							if (unitIndex)
+							{
+								start = UNREACHABLE;
+
+								for (std::uint8_t candidate = 0; candidate < STATE_COUNT; ++candidate)
+									if (stateModes[candidate] != mode && costs[unitIndex][candidate] < start)
+										start = costs[unitIndex][candidate], startState = candidate;
+							}
+
+							if (start != UNREACHABLE && start + headerLengths[static_cast<size_t>(mode)] + bitCount < next[state])
+								next[state] = start + headerLengths[static_cast<size_t>(mode)] + bitCount, previousStates[unitIndex + 1][state] = startState;
+						}
 					}
-				}
 
-				break;
-			}
+					if (std::all_of(next.begin(), next.end(), [UNREACHABLE](size_t cost) { return cost == UNREACHABLE; }))
+					{
+						std::ostringstream stream;
 
-			case Mode::ALPHANUMERIC:
-			{
-				std::vector<decltype(message)::value_type> characters;
+						stream << std::hex << std::uppercase << (static_cast<int>(message[unit.mIndex]) & 0xFF);
+						throw std::invalid_argument("Character 0x" + stream.str() + " can't be encoded in any mode this symbol supports");
+					}
+				}
 
-				if (mImpl->mType == SymbolType::MICRO_QR && mImpl->mVersion < 2)
-					throw std::invalid_argument("Alphanumeric mode is not supported in M1 symbols");
+				if (units.empty())
+				{
+					//Only an ECI sequence, use the mode with the shortest header
+					Mode mode = Mode::NUMERIC;
+
+					for (size_t candidate = 0; candidate < headerLengths.size(); ++candidate)
+						if (supportedModes[candidate] && headerLengths[candidate] < headerLengths[static_cast<size_t>(mode)])
+							mode = static_cast<Mode>(candidate);
 
-				for (decltype(message)::size_type i = index; i < index + byteCount; ++i)
+					result.push_back({ message.substr(partIndex, i - partIndex), mode });
+				}
+				else
 				{
-					characters.push_back(message[i]);
+					std::vector<Segment> segments;
+					auto state = static_cast<std::uint8_t>(std::min_element(costs.back().begin(), costs.back().end()) - costs.back().begin());
+					size_t end = i;
 
-					if (characters.size() == 2 || i == (index + byteCount) - 1 && !characters.empty())
+					//Walk back, a segment starts wherever the mode changes
+					for (size_t unitIndex = units.size(); unitIndex; --unitIndex)
 					{
-						unsigned encodedCharacters = characters.size() == 2 ? GetAlphanumericCode(characters[0]) * 45 + GetAlphanumericCode(characters[1]) : GetAlphanumericCode(characters[0]);
+						auto previousState = previousStates[unitIndex][state];
+
+						if (previousState == STATE_COUNT || stateModes[previousState] != stateModes[state])
+						{
+							size_t start = unitIndex == 1 ? partIndex : units[unitIndex - 1].mIndex;
 
-						for (size_t bit = 0, bitCount = characters.size() == 2 ? 11 : 6; bit < bitCount; ++bit)
-							dataBits.push_back(encodedCharacters & 1 << (bitCount - 1) >> bit);
+							segments.push_back({ message.substr(start, end - start), stateModes[state] });
+							end = start;
+						}
 
-						characters.clear();
+						state = previousState;
 					}
+
+					result.insert(result.end(), segments.rbegin(), segments.rend());
 				}
 
-				break;
+				partIndex = i;
+			}
+
+			return result;
+		}
+
+		//Levels supported by a version, from lowest to highest
+		std::span<const ErrorCorrectionLevel> GetSupportedLevels(SymbolType type, std::uint8_t version)
+		{
+			static const std::array<ErrorCorrectionLevel, 4> levels = { ErrorCorrectionLevel::L, ErrorCorrectionLevel::M, ErrorCorrectionLevel::Q, ErrorCorrectionLevel::H };
+			static const std::array<ErrorCorrectionLevel, 1> errorDetectionOnly = { ErrorCorrectionLevel::ERROR_DETECTION_ONLY };
+			std::span<const ErrorCorrectionLevel> result = levels;
+
+			if (type == SymbolType::MICRO_QR)
+			{
+				if (version == 1)
+					result = errorDetectionOnly;
+				else
+					result = result.first(version == 4 ? 3 : 2);
 			}
 
-			case Mode::BYTE:
+			return result;
+		}
+
+		//ERROR_DETECTION_ONLY is weaker than L
+		unsigned GetLevelStrength(ErrorCorrectionLevel level)
+		{
+			return level == ErrorCorrectionLevel::ERROR_DETECTION_ONLY ? 0 : static_cast<unsigned>(level) + 1;
+		}
+
+		//Mode and segments of a Segment, with its bit count when encoded in a version 1 QR symbol
+		struct SegmentLength
+		{
+			Mode mMode;
+			size_t mBitCount;
+			std::vector<SegmentInformation> mSegments;
+		};
+
+		//Only the mode and character count indicators change between versions, so bit counts are adjusted instead of encoding again
+		bool Fits(const SymbolDescriptor &descriptor, const std::vector<SegmentLength> &segmentLengths)
+		{
+			const SymbolDescriptor &reference = GetSymbolDescriptor(SymbolType::QR, 1, ErrorCorrectionLevel::L);
+			size_t bitCount = 0;
+
+			for (const auto &segmentLength : segmentLengths)
 			{
-				if (mImpl->mType == SymbolType::MICRO_QR && mImpl->mVersion < 3)
-					throw std::invalid_argument("Byte mode is not supported in M1 and M2 symbols");
+				unsigned modeIndicatorLength = GetModeIndicator(descriptor.mType, descriptor.mVersion, segmentLength.mMode).mLength;
+				unsigned countLength = descriptor.mCharacterCountLengths[static_cast<size_t>(segmentLength.mMode)];
+				unsigned referenceLength = GetModeIndicator(reference.mType, reference.mVersion, segmentLength.mMode).mLength + reference.mCharacterCountLengths[static_cast<size_t>(segmentLength.mMode)];
 
-				for (size_t i = index; i < index + byteCount; ++i)
+				//Same restrictions as EncodeCharacters
+				if (descriptor.mType == SymbolType::MICRO_QR)
 				{
-					for (size_t bit = 0; bit < 8; ++bit)
-						dataBits.push_back(*(message.data() + i) & 1 << 7 >> bit);
+					if (segmentLength.mMode == Mode::ALPHANUMERIC && descriptor.mVersion < 2 || (segmentLength.mMode == Mode::BYTE || segmentLength.mMode == Mode::KANJI) && descriptor.mVersion < 3)
+						return false;
 
-					if (message[i] == 0x5C)
-						++i;
+					if (std::any_of(segmentLength.mSegments.begin(), segmentLength.mSegments.end(), [](const SegmentInformation &segment) { return segment.mECI; }))
+						return false;
 				}
 
-				break;
+				for (const auto &segment : segmentLength.mSegments)
+					if (segment.mCharacterCount >> countLength)
+						return false;
+
+				bitCount += segmentLength.mBitCount - segmentLength.mSegments.size() * referenceLength + segmentLength.mSegments.size() * (modeIndicatorLength + countLength);
 			}
 
-			case Mode::KANJI:
+			return bitCount <= descriptor.mDataBitCapacity;
+		}
+
+		//Data codeword index of a stream padded to the symbol's capacity. The last one is only 4 bits long if shortLastCodeword is true
+		std::uint8_t ReadCodeword(const BitStream &stream, unsigned index, unsigned codewordCount, bool shortLastCodeword)
+		{
+			unsigned lastBit = shortLastCodeword && index + 1 == codewordCount ? 4 : 0;
+
+			return static_cast<std::uint8_t>(stream.read(index * size_t{ 8 }, 8 - lastBit) << lastBit);
+		}
+
+		//Sets the modules of the 8 - lastBit most significant bits of codeword, starting at moduleIndex in the placement order
+		void PlaceCodeword(BitMatrix &symbol, const std::vector<ModulePosition> &placementOrder, size_t moduleIndex, std::uint8_t codeword, unsigned lastBit)
+		{
+			for (unsigned bitIndex = 8; bitIndex > lastBit;)
 			{
-				if (mImpl->mType == SymbolType::MICRO_QR && mImpl->mVersion < 3)
-					throw std::invalid_argument("Kanji mode is not supported in M1 and M2 symbols");
+				auto position = placementOrder[moduleIndex++];
 
-				for (decltype(message)::size_type i = index; i < index + byteCount; i += 2)
-				{
-					std::uint16_t kanjiCharacter = message[i] << 8 | message[i + 1] & 0xFF;
+				symbol.set(position.mRow, position.mColumn, codeword >> --bitIndex & 1);
+			}
+		}
 
-					if (!IsKanji(kanjiCharacter))
-					{
-						std::ostringstream stream;
+		//Block of a TemplateEncoder with data codewords past the prefix
+		struct TemplateBlock
+		{
+			unsigned mFirstCodeword; //Index of the block's first data codeword in the data bit stream
+			unsigned mDataLength;
+			std::vector<std::uint8_t> mParity; //Shift register after the block's data codewords that only hold prefix bits, all 0 if it has none
+			std::vector<std::uint16_t> mParityModuleIndices; //Position in the placement order of the first module of each error correction codeword
+		};
+
+		//Last symbol an Encoder generated. Locked because generating is const, so threads can share an Encoder. Copies share the symbol
+		class SymbolMemo
+		{
+			mutable std::mutex mMutex;
+			std::shared_ptr<const GeneratedSymbol> mSymbol;
+		public:
+			SymbolMemo() = default;
 
-						stream << std::hex << std::uppercase << (static_cast<int>(kanjiCharacter) & 0xFFFF);
-						throw std::invalid_argument("Character 0x" + stream.str() + " can't be encoded in Kanji mode");
-					}
+			SymbolMemo(const SymbolMemo &other)
+				:mSymbol(other.get())
+			{}
 
-					if (kanjiCharacter >= 0x8140 && kanjiCharacter <= 0x9FFC)
-						kanjiCharacter -= 0x8140;
-					else
-						if (kanjiCharacter >= 0xE040 && kanjiCharacter <= 0xEBBF)
-							kanjiCharacter -= 0xC140;
+			SymbolMemo& operator=(const SymbolMemo &other)
+			{
+				set(other.get());
 
-					kanjiCharacter = (kanjiCharacter >> 8) * 0xC0 + (kanjiCharacter & 0xFF);
+				return *this;
+			}
 
-					for (size_t bit = 0; bit < 13; ++bit)
-						dataBits.push_back(kanjiCharacter & 1 << 12 >> bit);
-				}
+			std::shared_ptr<const GeneratedSymbol> get() const
+			{
+				std::lock_guard lock(mMutex);
 
-				break;
+				return mSymbol;
 			}
-		}
+
+			void set(std::shared_ptr<const GeneratedSymbol> symbol)
+			{
+				std::lock_guard lock(mMutex);
+
+				mSymbol = std::move(symbol);
+			}
+		};
+
+		#ifndef TESTS
 	}
+	#endif
+}
 
-	if (mImpl->mBitStream.size() + dataBits.size() <= dataModuleCount)
-		mImpl->mBitStream.insert(mImpl->mBitStream.end(), dataBits.begin(), dataBits.end());
-	else
-		throw std::length_error("Data bit stream would exceed the symbol's capacity");
+struct QR::Encoder::Impl
+{
+	BitStream mBitStream;
+	unsigned mVersion;
+	SymbolType mType;
+	ErrorCorrectionLevel mLevel;
+	bool mParallel = false;
+	MaskPolicy mMaskPolicy = MaskPolicy::EXHAUSTIVE;
+	unsigned mFixedMaskId = 0;
+	std::shared_ptr<SymbolCache> mCache;
+	SymbolMemo mMemo; //Reset whenever the bit stream or the mask policy changes
+};
+
+struct QR::EncodeContext::Impl
+{
+	BitStream mDataBits;
+	std::vector<BlockGroup> mBlockGroups; //Never shrinks, only the first descriptor.mBlockLayout.size() are used
+	BitMatrix mSymbol;
+	BitMatrix mMaskedSymbol;
+	RatingScratch mRatingScratch;
+	std::array<BitMatrix, 8> mParallelMaskedSymbols; //One per mask, only used by parallel encoders
+	std::array<RatingScratch, 8> mParallelRatingScratches;
+	std::vector<std::uint8_t> mBlockData; //Data and error correction codewords of one block, only used by TemplateEncoder
+	std::vector<std::uint8_t> mBlockParity;
+};
+
+struct QR::TemplateEncoder::Impl
+{
+	Encoder mEncoder; //Its bit stream is the prefix. Picks the mask of every symbol
+	Mode mSlotMode;
+	size_t mMaxSlotLength;
+	unsigned mFixedCodewordCount = 0; //Data codewords that only hold prefix bits. The slot starts in the next one
+	unsigned mPaddingStart = 0; //Data codewords from here on are pad codewords whatever the slot is
+	unsigned mDataCodewordCount = 0;
+	unsigned mParityLength = 0;
+	//Function patterns, fixed data codewords, and the error correction codewords of blocks with only fixed data codewords or only pad codewords, unmasked.
+	//Pad codewords alternate, so there's one symbol for pad codewords starting at an even index and one for an odd index
+	std::array<BitMatrix, 2> mFixedSymbols;
+	std::vector<std::uint16_t> mDataModuleIndices; //Position in the placement order of the first module of each data codeword
+	std::vector<TemplateBlock> mVariableBlocks; //Blocks the slot can reach, in data bit stream order
+};
+
+QR::EncodeContext::EncodeContext()
+	:mImpl(new Impl())
+{}
+
+QR::EncodeContext::EncodeContext(EncodeContext&&) noexcept = default;
+
+QR::EncodeContext &QR::EncodeContext::operator=(EncodeContext&&) noexcept = default;
+
+QR::EncodeContext::~EncodeContext() = default;
+
+QR::Encoder::Encoder(SymbolType type, unsigned version, ErrorCorrectionLevel level)
+	:mImpl(new Impl{ {}, version, type, level })
+{
+	ValidateArguments(type, version, level);
+}
+
+QR::Encoder::Encoder(const Encoder &other)
+	:mImpl(new Impl{ *other.mImpl })
+{}
+
+QR::Encoder::Encoder(Encoder&&) noexcept = default;
+
+QR::Encoder &QR::Encoder::operator=(const Encoder &other)
+{
+	*mImpl = *other.mImpl;
+
+	return *this;
+}
+
+QR::Encoder &QR::Encoder::operator=(Encoder&&) noexcept = default;
+
+QR::Encoder::~Encoder() = default;
+
+void QR::Encoder::addCharacters(std::string_view message, Mode mode)
+{
+	const SymbolDescriptor &descriptor = GetSymbolDescriptor(mImpl->mType, mImpl->mVersion, mImpl->mLevel);
+
+	mImpl->mMemo.set(nullptr);
+	AppendWithinCapacity(mImpl->mBitStream, descriptor.mDataBitCapacity, [&] { EncodeCharacters(mImpl->mBitStream, descriptor, message, mode); });
+}
+
+void QR::Encoder::addText(std::string_view message)
+{
+	const SymbolDescriptor &descriptor = GetSymbolDescriptor(mImpl->mType, mImpl->mVersion, mImpl->mLevel);
+	auto segments = GetOptimalSegments(descriptor, message);
+
+	mImpl->mMemo.set(nullptr);
+	AppendWithinCapacity(mImpl->mBitStream, descriptor.mDataBitCapacity, [&] {
+		for (const auto &segment : segments)
+			EncodeCharacters(mImpl->mBitStream, descriptor, segment.mCharacters, segment.mMode);
+	});
 }
 
 void QR::Encoder::clear()
 {
 	mImpl->mBitStream.clear();
+	mImpl->mMemo.set(nullptr);
+}
+
+void QR::Encoder::setParallel(bool parallel)
+{
+	mImpl->mParallel = parallel;
+}
+
+bool QR::Encoder::getParallel() const
+{
+	return mImpl->mParallel;
+}
+
+void QR::Encoder::setMaskPolicy(MaskPolicy policy, unsigned fixedMaskId)
+{
+	if (policy == MaskPolicy::FIXED && fixedMaskId >= (mImpl->mType == SymbolType::MICRO_QR ? 4u : 8u))
+		throw std::invalid_argument("Invalid mask id");
+
+	mImpl->mMaskPolicy = policy;
+	mImpl->mFixedMaskId = policy == MaskPolicy::FIXED ? fixedMaskId : 0;
+	mImpl->mMemo.set(nullptr);
+}
+
+QR::MaskPolicy QR::Encoder::getMaskPolicy() const
+{
+	return mImpl->mMaskPolicy;
+}
+
+unsigned QR::Encoder::getFixedMaskId() const
+{
+	return mImpl->mFixedMaskId;
+}
+
+void QR::Encoder::setCache(std::shared_ptr<SymbolCache> cache)
+{
+	mImpl->mCache = std::move(cache);
+}
+
+const std::shared_ptr<QR::SymbolCache>& QR::Encoder::getCache() const
+{
+	return mImpl->mCache;
 }
 
 QR::Symbol QR::Encoder::generateMatrix() const
 {
-	using std::vector; using std::tuple; using std::bitset; using std::get;
-	vector<vector<bool>> result(GetSymbolSize(mImpl->mType, mImpl->mVersion), vector<bool>(GetSymbolSize(mImpl->mType, mImpl->mVersion))), mask = GetDataRegionMask(mImpl->mType, mImpl->mVersion);
-	vector<Symbol> maskedSymbols;
-	vector<unsigned> maskedSymbolScores;
-	vector<bool> dataBitStream = mImpl->mBitStream;
-	vector<vector<bitset<8>>> dataBlocks, errorCorrectionBlocks;
-	decltype(dataBitStream)::size_type bitIndex = 0;
-	int currentRow = GetSymbolSize(mImpl->mType, mImpl->mVersion) - 1, currentColumn = currentRow, delta = -1;
-	unsigned quietZoneWidth = mImpl->mType == SymbolType::MICRO_QR ? 2 : 4;
-	unsigned dataModuleCount = GetDataModuleCount(mImpl->mType, mImpl->mVersion) - GetRemainderBitCount(mImpl->mType, mImpl->mVersion) - GetErrorCorrectionCodewordCount(mImpl->mType, mImpl->mVersion, mImpl->mLevel) * 8;
-	size_t maskId;
+	return generateSymbol()->mMatrix.toVector();
+}
 
-	DrawFinderPattern(result, 0, 0);
-	if (mImpl->mType != SymbolType::MICRO_QR)
+QR::BitMatrix QR::Encoder::generateMatrixPacked() const
+{
+	return generateSymbol()->mMatrix;
+}
+
+QR::MaskSelection QR::Encoder::generateMatrixInto(BitMatrix &output, EncodeContext &context) const
+{
+	MaskSelection selection;
+
+	if (auto symbol = findSymbol())
 	{
-		DrawFinderPattern(result, 0, GetSymbolSize(mImpl->mType, mImpl->mVersion) - 7);
-		DrawFinderPattern(result, GetSymbolSize(mImpl->mType, mImpl->mVersion) - 7, 0);
-		DrawAlignmentPatterns(result, mImpl->mVersion);
+		output = symbol->mMatrix;
+		return symbol->mSelection;
 	}
-	DrawTimingPatterns(result, mImpl->mType, mImpl->mVersion);
 
-	//Add terminator and pad codewords
-	if (dataBitStream.size() <= dataModuleCount)
+	selection = generateUncached(output, context);
+
+	if (mImpl->mCache)
+		mImpl->mMemo.set(mImpl->mCache->insert({ mImpl->mBitStream, mImpl->mType, mImpl->mVersion, mImpl->mLevel, mImpl->mMaskPolicy, mImpl->mFixedMaskId },
+			std::make_shared<const GeneratedSymbol>(GeneratedSymbol{ output, selection })));
+
+	return selection;
+}
+
+std::shared_ptr<const QR::GeneratedSymbol> QR::Encoder::generateSymbol() const
+{
+	std::shared_ptr<const GeneratedSymbol> result = findSymbol();
+
+	if (!result)
 	{
-		auto terminator = GetTerminator(mImpl->mType, mImpl->mVersion);
+		EncodeContext context;
+		GeneratedSymbol generated;
 
-		dataBitStream.insert(dataBitStream.end(), terminator.begin(), terminator.begin() + std::min(dataModuleCount - dataBitStream.size(), terminator.size()));
+		generated.mSelection = generateUncached(generated.mMatrix, context);
+		result = std::make_shared<const GeneratedSymbol>(std::move(generated));
 
-		if (dataBitStream.size() < dataModuleCount && dataBitStream.size() % 8)
-		{
-			dataBitStream.resize(dataBitStream.size() - dataBitStream.size() % 8 + 8);
+		if (mImpl->mCache)
+			result = mImpl->mCache->insert({ mImpl->mBitStream, mImpl->mType, mImpl->mVersion, mImpl->mLevel, mImpl->mMaskPolicy, mImpl->mFixedMaskId }, std::move(result));
 
-			//If I got past the limit after resizing to an 8 bit boundary, then it must be because of the 4 bit codeword in M1 or M3 symbols
-			if (dataBitStream.size() > dataModuleCount)
-				dataBitStream.resize(dataModuleCount);
-		}
+		mImpl->mMemo.set(result);
+	}
 
-		if (dataBitStream.size() < dataModuleCount)
-		{
-			vector<vector<bool>> padCodewords;
-			decltype(padCodewords)::size_type counter = 0;
+	return result;
+}
 
-			if (mImpl->mType == SymbolType::MICRO_QR && (mImpl->mVersion == 1 || mImpl->mVersion == 3))
-				padCodewords = { { 0, 0, 0, 0 } }; //Pad codeword for M1 and M3
-			else
-				padCodewords = { { 1, 1, 1, 0, 1, 1, 0, 0 }, { 0, 0, 0, 1, 0, 0, 0, 1 } };
+std::shared_ptr<const QR::GeneratedSymbol> QR::Encoder::findSymbol() const
+{
+	std::shared_ptr<const GeneratedSymbol> result = mImpl->mMemo.get();
 
-			while (dataBitStream.size() < dataModuleCount)
-				dataBitStream.insert(dataBitStream.end(), padCodewords[counter % padCodewords.size()].begin(), padCodewords[counter % padCodewords.size()].end()), ++counter;
-		}
+	if (!result && mImpl->mCache)
+	{
+		result = mImpl->mCache->find({ mImpl->mBitStream, mImpl->mType, mImpl->mVersion, mImpl->mLevel, mImpl->mMaskPolicy, mImpl->mFixedMaskId });
+
+		if (result)
+			mImpl->mMemo.set(result);
 	}
+
+	return result;
+}
+
+QR::MaskSelection QR::Encoder::generateUncached(BitMatrix &output, EncodeContext &context) const
+{
+	const SymbolDescriptor &descriptor = GetSymbolDescriptor(mImpl->mType, mImpl->mVersion, mImpl->mLevel);
+	BitMatrix &result = context.mImpl->mSymbol;
+	BitStream &dataBitStream = context.mImpl->mDataBits;
+	std::span<BlockGroup> blockGroups;
+	size_t bitIndex = 0, maxDataLength = 0;
+	bool shortLastCodeword = mImpl->mType == SymbolType::MICRO_QR && (mImpl->mVersion == 1 || mImpl->mVersion == 3);
+	auto &placementOrder = GetPlacementOrder(mImpl->mType, mImpl->mVersion);
+	size_t moduleIndex = 0;
+	unsigned dataModuleCount = descriptor.mDataBitCapacity;
+
+	result = GetSymbolTemplate(mImpl->mType, mImpl->mVersion).mFunctionPatterns;
+	dataBitStream = mImpl->mBitStream;
+
+	//Add terminator and pad codewords
+	if (dataBitStream.size() <= dataModuleCount)
+		AppendPadding(dataBitStream, descriptor);
 	else
 		throw std::length_error("Message exceeds symbol capacity");
 
-	//Split bit stream into data blocks and generate the corresponding error correction blocks
-	for (const auto &blockLayout : GetBlockLayout(mImpl->mType, mImpl->mVersion, mImpl->mLevel))
-	{
-		auto blockCounter = std::get<0>(blockLayout);
+	if (context.mImpl->mBlockGroups.size() < descriptor.mBlockLayout.size())
+		context.mImpl->mBlockGroups.resize(descriptor.mBlockLayout.size());
 
-		while (blockCounter--)
-		{
-			decltype(dataBlocks)::value_type block(get<2>(blockLayout)), errorBlock;
-			auto &generatorPolynomial = GetPolynomialCoefficientExponents(get<1>(blockLayout) - get<2>(blockLayout));
-			unsigned n = get<2>(blockLayout);
+	blockGroups = std::span<BlockGroup>(context.mImpl->mBlockGroups).first(descriptor.mBlockLayout.size());
 
-			for (auto &codeword : block)
+	//Split bit stream into data blocks and generate the corresponding error correction blocks. Blocks of the same length are stored interleaved, so they can be encoded together
+	for (size_t groupIndex = 0; groupIndex < blockGroups.size(); ++groupIndex)
+	{
+		const BlockLayout &blockLayout = descriptor.mBlockLayout[groupIndex];
+		BlockGroup &group = blockGroups[groupIndex];
+		ReedSolomonEncoder encoder(blockLayout.mCodewordCount - blockLayout.mDataCodewordCount);
+
+		group.mBlockCount = blockLayout.mBlockCount;
+		group.mDataLength = blockLayout.mDataCodewordCount;
+		group.mData.resize(group.mBlockCount * group.mDataLength);
+		group.mErrorCorrection.resize(group.mBlockCount * encoder.getParityLength());
+		maxDataLength = std::max<size_t>(maxDataLength, group.mDataLength);
+
+		for (unsigned block = 0; block < group.mBlockCount; ++block)
+			for (unsigned codewordIndex = 0; codewordIndex < group.mDataLength; ++codewordIndex)
 			{
-				decltype(dataBitStream)::size_type lastBit = 0;
-
-				if (mImpl->mType == SymbolType::MICRO_QR && (mImpl->mVersion == 1 || mImpl->mVersion == 3) && &codeword == &block.back())
-					lastBit = 4;
+				unsigned lastBit = shortLastCodeword && codewordIndex + 1 == group.mDataLength ? 4 : 0;
 
-				for (decltype(dataBitStream)::size_type i = 8; i-- > lastBit;)
-					codeword[i] = dataBitStream[bitIndex++];
+				group.mData[codewordIndex * group.mBlockCount + block] = static_cast<std::uint8_t>(dataBitStream.read(bitIndex, 8 - lastBit) << lastBit);
+				bitIndex += 8 - lastBit;
 			}
 
-			errorBlock = block;
-			errorBlock.resize(get<1>(blockLayout));
+		if (!mImpl->mParallel)
+			encoder.encodeBatch(group.mData, group.mErrorCorrection, group.mBlockCount);
+	}
 
-			while (n--)
-			{
-				auto current = errorBlock.front().to_ulong();
+	//Every task encodes up to 32 blocks, as many as an AVX2 kernel does at once
+	if (mImpl->mParallel)
+	{
+		std::array<size_t, 2> taskCounts = {};
 
-				errorBlock.erase(errorBlock.begin());
+		for (size_t groupIndex = 0; groupIndex < blockGroups.size(); ++groupIndex)
+			taskCounts[groupIndex] = (blockGroups[groupIndex].mBlockCount + 31) / 32;
 
-				if (current)
-				{
-					current = GetAlphaExponent(current);
+		RunInParallel(taskCounts[0] + taskCounts[1], [&](size_t task) {
+			BlockGroup &group = blockGroups[task < taskCounts[0] ? 0 : 1];
+			size_t firstBlock = (task < taskCounts[0] ? task : task - taskCounts[0]) * 32;
+			ReedSolomonEncoder encoder(static_cast<unsigned>(group.mErrorCorrection.size() / group.mBlockCount));
 
-					for (unsigned i = 0; i < generatorPolynomial.size(); ++i)
-					{
-						auto exponentSum = current + generatorPolynomial[i];
+			encoder.encodeBatch(group.mData, group.mErrorCorrection, group.mBlockCount, firstBlock, std::min<size_t>(firstBlock + 32, group.mBlockCount));
+		});
+	}
 
-						if (exponentSum > 255)
-							exponentSum %= 255;
+	//Place bits in symbol
+	for (bool errorCorrection : { false, true })
+	{
+		size_t maxLength = errorCorrection ? blockGroups.front().mErrorCorrection.size() / blockGroups.front().mBlockCount : maxDataLength;
+
+		for (size_t codewordIndex = 0; codewordIndex < maxLength; ++codewordIndex)
+			for (const auto &group : blockGroups)
+			{
+				const auto &codewords = errorCorrection ? group.mErrorCorrection : group.mData;
+				size_t length = errorCorrection ? codewords.size() / group.mBlockCount : group.mDataLength;
+				unsigned lastBit = !errorCorrection && shortLastCodeword && codewordIndex + 1 == length ? 4 : 0;
 
-						errorBlock[i] = errorBlock[i].to_ulong() ^ GetAlphaValue(exponentSum);
+				if (codewordIndex < length)
+					for (unsigned block = 0; block < group.mBlockCount; ++block)
+					{
+						PlaceCodeword(result, placementOrder, moduleIndex, codewords[codewordIndex * group.mBlockCount + block], lastBit);
+						moduleIndex += 8 - lastBit;
 					}
-				}
 			}
+	}
 
-			dataBlocks.push_back(block);
-			errorCorrectionBlocks.push_back(errorBlock);
-		}
+	return finishSymbol(output, context);
+}
+
+QR::MaskSelection QR::Encoder::finishSymbol(BitMatrix &output, EncodeContext &context) const
+{
+	auto &symbolTemplate = GetSymbolTemplate(mImpl->mType, mImpl->mVersion);
+	BitMatrix &result = context.mImpl->mSymbol, &maskedSymbol = context.mImpl->mMaskedSymbol;
+	auto &maskPatterns = GetMaskPatterns(mImpl->mType, mImpl->mVersion);
+	unsigned quietZoneWidth = mImpl->mType == SymbolType::MICRO_QR ? 2 : 4;
+	size_t maskId = 0;
+	unsigned maskCount = mImpl->mType == SymbolType::MICRO_QR ? 4 : 8;
+	std::array<unsigned, 8> scores;
+	MaskSelection selection = {};
+
+	if (mImpl->mMaskPolicy == MaskPolicy::FIXED)
+		maskId = mImpl->mFixedMaskId;
+	else
+	{
+		bool rowsOnly = mImpl->mMaskPolicy == MaskPolicy::FAST;
+
+		if (mImpl->mParallel)
+			RunInParallel(maskCount, [&](size_t id) {
+				BitMatrix &parallelMaskedSymbol = context.mImpl->mParallelMaskedSymbols[id];
+
+				parallelMaskedSymbol = result;
+				parallelMaskedSymbol ^= maskPatterns[id];
+				scores[id] = GetSymbolRating(parallelMaskedSymbol, mImpl->mType, context.mImpl->mParallelRatingScratches[id], std::numeric_limits<unsigned>::max(), rowsOnly);
+			});
+		else
+			for (unsigned id = 0; id < maskCount; ++id)
+			{
+				//A QR mask is only useful if it beats the best one so far, so its rating can stop when it gets there. Only one masked copy is kept
+				maskedSymbol = result;
+				maskedSymbol ^= maskPatterns[id];
+				scores[id] = GetSymbolRating(maskedSymbol, mImpl->mType, context.mImpl->mRatingScratch,
+					id && mImpl->mType == SymbolType::QR ? *std::min_element(scores.begin(), scores.begin() + id) : std::numeric_limits<unsigned>::max(), rowsOnly);
+			}
+
+		//QR symbols take the lowest score and Micro QR symbols the highest one, the first mask wins ties
+		for (unsigned id = 0; id < maskCount; ++id)
+			if (!id || (mImpl->mType == SymbolType::QR ? scores[id] < scores[maskId] : scores[id] > scores[maskId]))
+				maskId = id;
+
+		selection.mScore = scores[maskId];
 	}
 
-	//Place bits in symbol
-	for (const decltype(dataBlocks) &blocks : { std::ref(dataBlocks), std::ref(errorCorrectionBlocks) })
+	selection.mMaskId = static_cast<unsigned>(maskId);
+	result ^= maskPatterns[maskId];
+
+	DrawFormatInformation(mImpl->mType, mImpl->mVersion, mImpl->mLevel, maskId, [&result](unsigned row, unsigned column, bool value) { result.set(row, column, value); });
+	result |= symbolTemplate.mVersionInformation; //Those modules are still light at this point
+
+	//Add quiet zone
+	output.reset(result.getWidth() + quietZoneWidth * 2, result.getHeight() + quietZoneWidth * 2);
+	output.paste(result, quietZoneWidth, quietZoneWidth);
+
+	return selection;
+}
+
+std::vector<bool> QR::Encoder::getBitStream() const
+{
+	return mImpl->mBitStream.toVector();
+}
+
+unsigned QR::Encoder::getVersion() const
+{
+	return mImpl->mVersion;
+}
+
+QR::SymbolType QR::Encoder::getSymbolType() const
+{
+	return mImpl->mType;
+}
+
+QR::ErrorCorrectionLevel QR::Encoder::getErrorCorrectionLevel() const
+{
+	return mImpl->mLevel;
+}
+
+QR::TemplateEncoder::TemplateEncoder(SymbolType type, unsigned version, ErrorCorrectionLevel level, std::span<const Segment> prefix, Mode slotMode, size_t maxSlotLength)
+	:mImpl(new Impl{ Encoder(type, version, level), slotMode, maxSlotLength })
+{
+	const SymbolDescriptor &descriptor = GetSymbolDescriptor(type, version, level);
+	const BitStream &prefixBits = mImpl->mEncoder.mImpl->mBitStream;
+	auto &placementOrder = GetPlacementOrder(type, version);
+	bool shortLastCodeword = type == SymbolType::MICRO_QR && (version == 1 || version == 3);
+	unsigned maxDataLength = 0;
+	size_t moduleIndex = 0;
+	std::vector<TemplateBlock> blocks;
+	std::vector<std::uint8_t> data;
+
+	for (const auto &segment : prefix)
+		mImpl->mEncoder.addCharacters(segment.mCharacters, segment.mMode);
+
+	//Every character of a mode takes as many bits as any other, so any slot fits if this one does, and its pad codewords start last
 	{
-		auto maxLength = std::max_element(blocks.begin(), blocks.end(), [](const decltype(dataBlocks)::value_type &lhs, const decltype(dataBlocks)::value_type &rhs) { return lhs.size() < rhs.size(); })->size();
+		Encoder longest = mImpl->mEncoder;
+		size_t terminatedSize;
+
+		if (slotMode == Mode::KANJI)
+			for (size_t i = 0; i < maxSlotLength; ++i)
+				longest.addCharacters("\x93\x5F", slotMode);
+		else
+			longest.addCharacters(std::string(maxSlotLength, slotMode == Mode::BYTE ? 'a' : '0'), slotMode);
+
+		terminatedSize = std::min<size_t>(longest.mImpl->mBitStream.size() + GetTerminator(type, version).mLength, descriptor.mDataBitCapacity);
+		mImpl->mPaddingStart = static_cast<unsigned>((terminatedSize + 7) / 8);
+	}
+
+	mImpl->mFixedCodewordCount = static_cast<unsigned>(prefixBits.size() / 8);
+	mImpl->mParityLength = descriptor.mBlockLayout.front().mCodewordCount - descriptor.mBlockLayout.front().mDataCodewordCount;
 
-		for (decltype(maxLength) codewordIndex = 0; codewordIndex < maxLength; ++codewordIndex)
+	for (const BlockLayout &layout : descriptor.mBlockLayout)
+		for (unsigned block = 0; block < layout.mBlockCount; ++block)
 		{
-			for (const auto &block : blocks)
+			blocks.push_back({ mImpl->mDataCodewordCount, layout.mDataCodewordCount, std::vector<std::uint8_t>(mImpl->mParityLength), std::vector<std::uint16_t>(mImpl->mParityLength) });
+			mImpl->mDataCodewordCount += layout.mDataCodewordCount;
+			maxDataLength = std::max<unsigned>(maxDataLength, layout.mDataCodewordCount);
+		}
+
+	//Same order generateUncached places codewords in
+	mImpl->mDataModuleIndices.resize(mImpl->mDataCodewordCount);
+
+	for (unsigned codewordIndex = 0; codewordIndex < maxDataLength; ++codewordIndex)
+		for (const auto &block : blocks)
+			if (codewordIndex < block.mDataLength)
 			{
-				if (codewordIndex < block.size())
-				{
-					auto lastBit = 0;
+				mImpl->mDataModuleIndices[block.mFirstCodeword + codewordIndex] = static_cast<std::uint16_t>(moduleIndex);
+				moduleIndex += shortLastCodeword && codewordIndex + 1 == block.mDataLength ? 4 : 8;
+			}
 
-					if (mImpl->mType == SymbolType::MICRO_QR && (mImpl->mVersion == 1 || mImpl->mVersion == 3) && &block[codewordIndex] == &block.back() && &blocks == &dataBlocks)
-						lastBit = 4;
+	for (unsigned codewordIndex = 0; codewordIndex < mImpl->mParityLength; ++codewordIndex)
+		for (auto &block : blocks)
+		{
+			block.mParityModuleIndices[codewordIndex] = static_cast<std::uint16_t>(moduleIndex);
+			moduleIndex += 8;
+		}
 
-					for (auto bitIndex = 8; bitIndex > lastBit;)
-					{
-						if (!mask[currentRow][currentColumn])
-							result[currentRow][currentColumn] = block[codewordIndex][--bitIndex];
+	mImpl->mFixedSymbols.fill(GetSymbolTemplate(type, version).mFunctionPatterns);
 
-						if (mImpl->mType == SymbolType::MICRO_QR && currentColumn % 2 ||
-							mImpl->mType == SymbolType::QR && currentColumn > 6 && currentColumn % 2 ||
-							mImpl->mType == SymbolType::QR && currentColumn < 6 && !(currentColumn % 2))
-						{
-							if (!currentRow && delta != 1)
-								delta = 1, currentColumn -= 2;
-							else
-								if (currentRow == GetSymbolSize(mImpl->mType, mImpl->mVersion) - 1 && delta != -1)
-									delta = -1, currentColumn -= 2;
-								else
-									currentRow += delta;
-
-							++currentColumn;
-
-							if (currentColumn == 6 && mImpl->mType != SymbolType::MICRO_QR)
-								currentColumn = 5;
-						}
-						else
-							--currentColumn;
-					}
+	for (auto &block : blocks)
+	{
+		ReedSolomonEncoder encoder(mImpl->mParityLength);
+		unsigned end = block.mFirstCodeword + block.mDataLength;
+
+		//Pad codewords are 0xEC and 0x11 in turn, or 0 in M1 and M3 symbols, whose pad codewords are 4 bits long
+		if (block.mFirstCodeword >= mImpl->mPaddingStart)
+			for (unsigned parity = 0; parity < 2; ++parity)
+			{
+				data.clear();
+
+				for (unsigned index = block.mFirstCodeword; index < end; ++index)
+				{
+					data.push_back(shortLastCodeword ? 0 : index % 2 == parity ? 0b11101100 : 0b00010001);
+					PlaceCodeword(mImpl->mFixedSymbols[parity], placementOrder, mImpl->mDataModuleIndices[index], data.back(), shortLastCodeword && index + 1 == end ? 4 : 0);
 				}
+
+				encoder.encode(data, block.mParity);
+
+				for (unsigned codewordIndex = 0; codewordIndex < mImpl->mParityLength; ++codewordIndex)
+					PlaceCodeword(mImpl->mFixedSymbols[parity], placementOrder, block.mParityModuleIndices[codewordIndex], block.mParity[codewordIndex], 0);
+			}
+		else
+		{
+			data.clear();
+
+			for (unsigned index = block.mFirstCodeword; index < std::min(end, mImpl->mFixedCodewordCount); ++index)
+			{
+				data.push_back(ReadCodeword(prefixBits, index, mImpl->mDataCodewordCount, shortLastCodeword));
+
+				for (auto &symbol : mImpl->mFixedSymbols)
+					PlaceCodeword(symbol, placementOrder, mImpl->mDataModuleIndices[index], data.back(), 0);
 			}
+
+			encoder.encode(data, block.mParity);
+
+			if (end > mImpl->mFixedCodewordCount)
+				mImpl->mVariableBlocks.push_back(std::move(block));
+			else
+				for (unsigned codewordIndex = 0; codewordIndex < mImpl->mParityLength; ++codewordIndex)
+					for (auto &symbol : mImpl->mFixedSymbols)
+						PlaceCodeword(symbol, placementOrder, block.mParityModuleIndices[codewordIndex], block.mParity[codewordIndex], 0);
 		}
 	}
+}
 
-	for (unsigned maskId = 0, sz = mImpl->mType == SymbolType::MICRO_QR ? 4 : 8; maskId < sz; ++maskId)
-	{
-		maskedSymbols.push_back(result);
+QR::TemplateEncoder::TemplateEncoder(const TemplateEncoder &other)
+	:mImpl(new Impl{ *other.mImpl })
+{}
 
-		for (Symbol::size_type i = 0, sz = maskedSymbols.back().size(); i < sz; ++i)
-			for (Symbol::value_type::size_type j = 0, sz = maskedSymbols.back()[i].size(); j < sz; ++j)
-				if (!mask[i][j])
-					maskedSymbols.back()[i][j] = maskedSymbols.back()[i][j] ^ GetMaskBit(mImpl->mType, maskId, i, j);
+QR::TemplateEncoder::TemplateEncoder(TemplateEncoder&&) noexcept = default;
 
-		maskedSymbolScores.push_back(GetSymbolRating(maskedSymbols.back(), mImpl->mType));
-	}
+QR::TemplateEncoder &QR::TemplateEncoder::operator=(const TemplateEncoder &other)
+{
+	*mImpl = *other.mImpl;
 
-	if (mImpl->mType == SymbolType::QR)
-		maskId = std::min_element(maskedSymbolScores.begin(), maskedSymbolScores.end()) - maskedSymbolScores.begin();
-	else
-		maskId = std::max_element(maskedSymbolScores.begin(), maskedSymbolScores.end()) - maskedSymbolScores.begin();
+	return *this;
+}
 
-	result = maskedSymbols[maskId];
+QR::TemplateEncoder &QR::TemplateEncoder::operator=(TemplateEncoder&&) noexcept = default;
 
-	DrawFormatInformation(result, mImpl->mType, mImpl->mVersion, mImpl->mLevel, maskId);
-	if (mImpl->mVersion >= 7)
-		DrawVersionInformation(result, mImpl->mType, mImpl->mVersion);
+QR::TemplateEncoder::~TemplateEncoder() = default;
 
-	//Add quiet zone
-	for (auto &row : result)
-	{
-		row.insert(row.begin(), quietZoneWidth, false);
-		row.insert(row.end(), quietZoneWidth, false);
-	}
+void QR::TemplateEncoder::setMaskPolicy(MaskPolicy policy, unsigned fixedMaskId)
+{
+	mImpl->mEncoder.setMaskPolicy(policy, fixedMaskId);
+}
+
+QR::MaskPolicy QR::TemplateEncoder::getMaskPolicy() const
+{
+	return mImpl->mEncoder.getMaskPolicy();
+}
+
+QR::MaskSelection QR::TemplateEncoder::generateMatrixInto(std::string_view slot, BitMatrix &output, EncodeContext &context) const
+{
+	const Encoder::Impl &encoder = *mImpl->mEncoder.mImpl;
+	const SymbolDescriptor &descriptor = GetSymbolDescriptor(encoder.mType, encoder.mVersion, encoder.mLevel);
+	auto &placementOrder = GetPlacementOrder(encoder.mType, encoder.mVersion);
+	bool shortLastCodeword = encoder.mType == SymbolType::MICRO_QR && (encoder.mVersion == 1 || encoder.mVersion == 3);
+	BitStream &dataBitStream = context.mImpl->mDataBits;
+	BitMatrix &result = context.mImpl->mSymbol;
+	std::vector<std::uint8_t> &blockData = context.mImpl->mBlockData, &parity = context.mImpl->mBlockParity;
+	ReedSolomonEncoder reedSolomonEncoder(mImpl->mParityLength);
+	size_t slotLength = slot.size(), paddingStart;
+
+	//An ECI sequence would start a segment the constructor didn't make room for
+	for (size_t i = slot.find(0x5C); i != std::string_view::npos; i = slot.find(0x5C, i + 2))
+		if (i + 1 < slot.size() && slot[i + 1] == 0x5C)
+			--slotLength;
+		else
+			throw std::invalid_argument("Template slots can't have ECI sequences");
 
-	for (unsigned i = 0; i < quietZoneWidth; ++i)
+	if ((mImpl->mSlotMode == Mode::KANJI ? slotLength / 2 : slotLength) > mImpl->mMaxSlotLength)
+		throw std::length_error("Slot is longer than the template allows");
+
+	dataBitStream = encoder.mBitStream;
+	EncodeCharacters(dataBitStream, descriptor, slot, mImpl->mSlotMode);
+	paddingStart = (std::min<size_t>(dataBitStream.size() + GetTerminator(encoder.mType, encoder.mVersion).mLength, descriptor.mDataBitCapacity) + 7) / 8;
+	AppendPadding(dataBitStream, descriptor);
+	result = mImpl->mFixedSymbols[shortLastCodeword ? 0 : paddingStart % 2];
+
+	for (const auto &block : mImpl->mVariableBlocks)
 	{
-		result.insert(result.begin(), std::vector<bool>(GetSymbolSize(mImpl->mType, mImpl->mVersion) + quietZoneWidth * 2));
-		result.insert(result.end(), std::vector<bool>(GetSymbolSize(mImpl->mType, mImpl->mVersion) + quietZoneWidth * 2));
+		blockData.clear();
+
+		for (unsigned index = std::max(block.mFirstCodeword, mImpl->mFixedCodewordCount); index < block.mFirstCodeword + block.mDataLength; ++index)
+		{
+			unsigned lastBit = shortLastCodeword && index + 1 == mImpl->mDataCodewordCount ? 4 : 0;
+
+			blockData.push_back(ReadCodeword(dataBitStream, index, mImpl->mDataCodewordCount, shortLastCodeword));
+			PlaceCodeword(result, placementOrder, mImpl->mDataModuleIndices[index], blockData.back(), lastBit);
+		}
+
+		parity = block.mParity;
+		reedSolomonEncoder.append(blockData, parity);
+
+		for (unsigned codewordIndex = 0; codewordIndex < mImpl->mParityLength; ++codewordIndex)
+			PlaceCodeword(result, placementOrder, block.mParityModuleIndices[codewordIndex], parity[codewordIndex], 0);
 	}
 
+	return mImpl->mEncoder.finishSymbol(output, context);
+}
+
+QR::BitMatrix QR::TemplateEncoder::generateMatrixPacked(std::string_view slot) const
+{
+	EncodeContext context;
+	BitMatrix result;
+
+	generateMatrixInto(slot, result, context);
+
 	return result;
 }
 
-std::vector<bool> QR::Encoder::getBitStream() const
+void QR::PrecomputeMaskPatterns(SymbolType type, unsigned version)
 {
-	return mImpl->mBitStream;
+	ValidateVersion(type, version);
+	GetMaskPatterns(type, static_cast<std::uint8_t>(version));
 }
 
-unsigned QR::Encoder::getVersion() const
+void QR::PrecomputeMaskPatterns()
 {
-	return mImpl->mVersion;
+	for (unsigned version = 1; version <= 40; ++version)
+		GetMaskPatterns(SymbolType::QR, version);
+
+	for (unsigned version = 1; version <= 4; ++version)
+		GetMaskPatterns(SymbolType::MICRO_QR, version);
 }
 
-QR::SymbolType QR::Encoder::getSymbolType() const
+size_t QR::GetMaskPatternCacheSize()
 {
-	return mImpl->mType;
+	return GetMaskPatternCacheCounter();
 }
 
-QR::ErrorCorrectionLevel QR::Encoder::getErrorCorrectionLevel() const
+QR::SymbolParameters QR::ChooseSymbol(std::span<const Segment> segments, ErrorCorrectionLevel minimumLevel, bool allowMicroQR)
 {
-	return mImpl->mLevel;
+	std::vector<SegmentLength> segmentLengths;
+	const SymbolDescriptor &reference = GetSymbolDescriptor(SymbolType::QR, 1, ErrorCorrectionLevel::L);
+	BitStream stream;
+
+	for (const auto &segment : segments)
+	{
+		auto &segmentLength = segmentLengths.emplace_back();
+
+		stream.clear();
+		EncodeCharacters(stream, reference, segment.mCharacters, segment.mMode, &segmentLength.mSegments);
+		segmentLength.mMode = segment.mMode;
+		segmentLength.mBitCount = stream.size();
+	}
+
+	for (SymbolType type : { SymbolType::MICRO_QR, SymbolType::QR })
+	{
+		if (type == SymbolType::MICRO_QR && !allowMicroQR)
+			continue;
+
+		for (std::uint8_t version = 1; version <= (type == SymbolType::MICRO_QR ? 4 : 40); ++version)
+		{
+			std::optional<ErrorCorrectionLevel> level;
+
+			//Capacity goes down as the level goes up, so stop at the first one that doesn't fit
+			for (ErrorCorrectionLevel candidate : GetSupportedLevels(type, version))
+				if (GetLevelStrength(candidate) >= GetLevelStrength(minimumLevel))
+				{
+					if (Fits(GetSymbolDescriptor(type, version, candidate), segmentLengths))
+						level = candidate;
+					else
+						break;
+				}
+
+			if (level)
+				return { type, version, level.value() };
+		}
+	}
+
+	throw std::length_error("Message exceeds the capacity of every symbol");
+}
+
+QR::Encoder QR::CreateEncoder(std::span<const Segment> segments, ErrorCorrectionLevel minimumLevel, bool allowMicroQR)
+{
+	auto parameters = ChooseSymbol(segments, minimumLevel, allowMicroQR);
+	Encoder result(parameters.mType, parameters.mVersion, parameters.mLevel);
+
+	for (const auto &segment : segments)
+		result.addCharacters(segment.mCharacters, segment.mMode);
+
+	return result;
+}
+
+std::vector<QR::Segment> QR::GetOptimalSegments(std::string_view message, SymbolType type, unsigned version)
+{
+	ValidateVersion(type, version);
+
+	return GetOptimalSegments(GetSymbolDescriptor(type, version, type == SymbolType::MICRO_QR && version == 1 ? ErrorCorrectionLevel::ERROR_DETECTION_ONLY : ErrorCorrectionLevel::L), message);
 }
\ No newline at end of file
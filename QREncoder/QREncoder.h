@@ -3,6 +3,9 @@
 #include <vector>
 #include <string_view>
 #include <memory>
+#include <span>
+#include <optional>
+#include "BitMatrix.h"
 
 namespace QR
 {
@@ -11,10 +14,66 @@ namespace QR
 	enum class Mode : std::uint8_t { NUMERIC, ALPHANUMERIC, BYTE, KANJI };
 	using Symbol = std::vector<std::vector<bool>>;
 
+	//Characters to encode in one mode, in the same format Encoder::addCharacters takes
+	struct Segment
+	{
+		std::string_view mCharacters;
+		Mode mMode;
+	};
+
+	//How Encoder picks the mask pattern. EXHAUSTIVE rates every mask with all the penalty rules from section 7.8.3, FIXED always uses the same mask.
+	//FAST rates every mask but only looks at rows for features 1 and 3, which halves the rating time of QR symbols. Micro QR symbols are rated in full either way
+	enum class MaskPolicy : std::uint8_t { EXHAUSTIVE, FIXED, FAST };
+
+	//Mask a symbol was generated with
+	struct MaskSelection
+	{
+		unsigned mMaskId;
+		std::optional<unsigned> mScore; //Rating of the mask with the policy used, empty for MaskPolicy::FIXED
+	};
+
+	//Symbol with its quiet zone, as generateMatrixInto returns it. Shared between Encoders and SymbolCache, so never changed once generated
+	struct GeneratedSymbol
+	{
+		BitMatrix mMatrix;
+		MaskSelection mSelection;
+	};
+
+	struct SymbolParameters
+	{
+		SymbolType mType;
+		unsigned mVersion;
+		ErrorCorrectionLevel mLevel;
+	};
+
+	//Memory reused by Encoder::generateMatrixInto. Encoding a symbol of a type and version the context has already encoded doesn't allocate.
+	//A context can't be used by two threads at once
+	class EncodeContext final
+	{
+		struct Impl;
+		std::unique_ptr<Impl> mImpl;
+		friend class Encoder;
+		friend class TemplateEncoder;
+	public:
+		EncodeContext();
+		EncodeContext(EncodeContext&&) noexcept;
+		EncodeContext& operator=(EncodeContext&&) noexcept;
+		~EncodeContext();
+	};
+
+	class SymbolCache;
+
 	class Encoder final
 	{
 		struct Impl;
 		std::unique_ptr<Impl> mImpl;
+
+		//Symbol for the current bit stream and mask policy from the last generation or the cache, or null
+		std::shared_ptr<const GeneratedSymbol> findSymbol() const;
+		MaskSelection generateUncached(BitMatrix &output, EncodeContext &context) const;
+		//Picks the mask for the unmasked symbol in context, then draws format and version information and the quiet zone into output
+		MaskSelection finishSymbol(BitMatrix &output, EncodeContext &context) const;
+		friend class TemplateEncoder;
 	public:
 		Encoder(SymbolType type, unsigned version, ErrorCorrectionLevel level);
 		Encoder(const Encoder&);
@@ -24,14 +83,78 @@ namespace QR
 		~Encoder();
 
 		void addCharacters(std::string_view message, Mode mode);
+		//Same format as addCharacters, split into the segments that give the shortest bit stream. Lowercase letters always go in byte mode,
+		//since scanners read them back uppercase from alphanumeric mode
+		void addText(std::string_view message);
 		//Clear bit stream
 		void clear();
+		//Computes error correction blocks and rates mask patterns on several threads. Off by default, generated symbols are the same either way.
+		//Only pays off for large symbols, and generateMatrixInto allocates while it's on
+		void setParallel(bool parallel);
+		bool getParallel() const;
+		//EXHAUSTIVE by default. fixedMaskId is only used by MaskPolicy::FIXED, and must be lower than 8 for QR symbols and lower than 4 for Micro QR symbols
+		void setMaskPolicy(MaskPolicy policy, unsigned fixedMaskId = 0);
+		MaskPolicy getMaskPolicy() const;
+		//0 unless the policy is MaskPolicy::FIXED
+		unsigned getFixedMaskId() const;
+		//Symbols are looked up in cache before they're generated, and stored in it after. Null by default, for no cache
+		void setCache(std::shared_ptr<SymbolCache> cache);
+		const std::shared_ptr<SymbolCache>& getCache() const;
+		//The last symbol generated is kept until the bit stream or the mask policy changes, and copies of the Encoder share it.
+		//Generating again before that returns it without encoding anything
 		Symbol generateMatrix() const;
+		//Same as generateMatrix, in a single contiguous allocation
+		BitMatrix generateMatrixPacked() const;
+		//Same as generateMatrixPacked, into output. output only allocates if it doesn't have enough memory for the symbol and its quiet zone.
+		//Only keeps the symbol for later calls if the Encoder has a cache, since that allocates
+		MaskSelection generateMatrixInto(BitMatrix &output, EncodeContext &context) const;
+		//Same symbol generateMatrixPacked returns, without copying it
+		std::shared_ptr<const GeneratedSymbol> generateSymbol() const;
 		std::vector<bool> getBitStream() const;
 		unsigned getVersion() const;
 		SymbolType getSymbolType() const;
 		ErrorCorrectionLevel getErrorCorrectionLevel() const;
 	};
+
+	//Messages made of a fixed prefix followed by a slot that changes from one symbol to the next, like a URL ending in a serial number.
+	//The constructor encodes the prefix once, along with the data codewords it fills, the error correction codewords of blocks it fills entirely and
+	//the shift register of the block the slot starts in. Each symbol then only encodes the codewords and blocks the slot reaches, before picking its mask
+	class TemplateEncoder final
+	{
+		struct Impl;
+		std::unique_ptr<Impl> mImpl;
+	public:
+		//maxSlotLength counts characters like the character count indicator does. Throws for the same reasons as Encoder's constructor and
+		//Encoder::addCharacters, including std::length_error if prefix followed by maxSlotLength characters in slotMode doesn't fit in the symbol
+		TemplateEncoder(SymbolType type, unsigned version, ErrorCorrectionLevel level, std::span<const Segment> prefix, Mode slotMode, size_t maxSlotLength);
+		TemplateEncoder(const TemplateEncoder&);
+		TemplateEncoder(TemplateEncoder&&) noexcept;
+		TemplateEncoder& operator=(const TemplateEncoder&);
+		TemplateEncoder& operator=(TemplateEncoder&&) noexcept;
+		~TemplateEncoder();
+
+		//Same as Encoder::setMaskPolicy
+		void setMaskPolicy(MaskPolicy policy, unsigned fixedMaskId = 0);
+		MaskPolicy getMaskPolicy() const;
+		//Same symbol as an Encoder that got every prefix segment and then slot in slotMode from addCharacters. slot is in the same format, without ECI sequences.
+		//Throws std::invalid_argument for the same reasons as addCharacters or if slot has an ECI sequence, and std::length_error if it's longer than maxSlotLength
+		MaskSelection generateMatrixInto(std::string_view slot, BitMatrix &output, EncodeContext &context) const;
+		BitMatrix generateMatrixPacked(std::string_view slot) const;
+	};
+
+	//Mask patterns are cached for the whole process and built on first use. These build them ahead of time, for one version or for all of them.
+	void PrecomputeMaskPatterns(SymbolType type, unsigned version);
+	void PrecomputeMaskPatterns();
+	//Memory used by the mask pattern cache, in bytes
+	size_t GetMaskPatternCacheSize();
+	//Smallest symbol that fits segments with at least minimumLevel, trying Micro QR symbols first if allowMicroQR is true. The level is then raised as far as
+	//that version allows. M1 symbols only have error detection, so they're only chosen if minimumLevel is ERROR_DETECTION_ONLY.
+	//Throws std::length_error if segments don't fit in any symbol, and std::invalid_argument for the same reasons as Encoder::addCharacters
+	SymbolParameters ChooseSymbol(std::span<const Segment> segments, ErrorCorrectionLevel minimumLevel = ErrorCorrectionLevel::L, bool allowMicroQR = false);
+	//Segments that addText would encode message as, in a symbol of that type and version. Views into message
+	std::vector<Segment> GetOptimalSegments(std::string_view message, SymbolType type, unsigned version);
+	//Encoder for the symbol ChooseSymbol picks, with segments already added
+	Encoder CreateEncoder(std::span<const Segment> segments, ErrorCorrectionLevel minimumLevel = ErrorCorrectionLevel::L, bool allowMicroQR = false);
 }
 
 #endif
\ No newline at end of file
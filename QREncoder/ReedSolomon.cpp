@@ -0,0 +1,323 @@
+#include "ReedSolomon.h"
+#include <stdexcept>
+#include <array>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define QR_X86
+	#include <immintrin.h>
+#endif
+
+//GCC and Clang only emit SSSE3/AVX2 instructions in functions that ask for them, MSVC doesn't need it
+#if defined(__GNUC__) || defined(__clang__)
+	#define QR_TARGET(instructions) __attribute__((target(instructions)))
+#else
+	#define QR_TARGET(instructions)
+#endif
+
+namespace QR
+{
+	#ifndef TESTS
+	namespace
+	{
+		#endif
+		//Every generated coefficient must match annex A
+		constexpr bool MatchesLiteralPolynomials()
+		{
+			for (const auto &polynomial : Tables::LITERAL_POLYNOMIALS)
+				for (unsigned i = 0; i < polynomial.mLength; ++i)
+					if (Tables::GENERATOR_POLYNOMIALS.mExponents[polynomial.mLength * (polynomial.mLength - 1) / 2 + i] != polynomial.mExponents[i])
+						return false;
+
+			return true;
+		}
+
+		//Every generated power and logarithm must match the tables in use before they were generated
+		constexpr bool MatchesLiteralGaloisField()
+		{
+			constexpr std::array<std::uint8_t, 256> values = {
+				1, 2, 4, 8, 16, 32, 64, 128, 29, 58, 116, 232, 205, 135, 19, 38,
+				76, 152, 45, 90, 180, 117, 234, 201, 143, 3, 6, 12, 24, 48, 96, 192,
+				157, 39, 78, 156, 37, 74, 148, 53, 106, 212, 181, 119, 238, 193, 159, 35,
+				70, 140, 5, 10, 20, 40, 80, 160, 93, 186, 105, 210, 185, 111, 222, 161,
+				95, 190, 97, 194, 153, 47, 94, 188, 101, 202, 137, 15, 30, 60, 120, 240,
+				253, 231, 211, 187, 107, 214, 177, 127, 254, 225, 223, 163, 91, 182, 113, 226,
+				217, 175, 67, 134, 17, 34, 68, 136, 13, 26, 52, 104, 208, 189, 103, 206,
+				129, 31, 62, 124, 248, 237, 199, 147, 59, 118, 236, 197, 151, 51, 102, 204,
+				133, 23, 46, 92, 184, 109, 218, 169, 79, 158, 33, 66, 132, 21, 42, 84,
+				168, 77, 154, 41, 82, 164, 85, 170, 73, 146, 57, 114, 228, 213, 183, 115,
+				230, 209, 191, 99, 198, 145, 63, 126, 252, 229, 215, 179, 123, 246, 241, 255,
+				227, 219, 171, 75, 150, 49, 98, 196, 149, 55, 110, 220, 165, 87, 174, 65,
+				130, 25, 50, 100, 200, 141, 7, 14, 28, 56, 112, 224, 221, 167, 83, 166,
+				81, 162, 89, 178, 121, 242, 249, 239, 195, 155, 43, 86, 172, 69, 138, 9,
+				18, 36, 72, 144, 61, 122, 244, 245, 247, 243, 251, 235, 203, 139, 11, 22,
+				44, 88, 176, 125, 250, 233, 207, 131, 27, 54, 108, 216, 173, 71, 142, 1
+			};
+			constexpr std::array<std::uint8_t, 255> exponents = {
+				0, 1, 25, 2, 50, 26, 198, 3, 223, 51, 238, 27, 104, 199, 75,
+				4, 100, 224, 14, 52, 141, 239, 129, 28, 193, 105, 248, 200, 8, 76, 113,
+				5, 138, 101, 47, 225, 36, 15, 33, 53, 147, 142, 218, 240, 18, 130, 69,
+				29, 181, 194, 125, 106, 39, 249, 185, 201, 154, 9, 120, 77, 228, 114, 166,
+				6, 191, 139, 98, 102, 221, 48, 253, 226, 152, 37, 179, 16, 145, 34, 136,
+				54, 208, 148, 206, 143, 150, 219, 189, 241, 210, 19, 92, 131, 56, 70, 64,
+				30, 66, 182, 163, 195, 72, 126, 110, 107, 58, 40, 84, 250, 133, 186, 61,
+				202, 94, 155, 159, 10, 21, 121, 43, 78, 212, 229, 172, 115, 243, 167, 87,
+				7, 112, 192, 247, 140, 128, 99, 13, 103, 74, 222, 237, 49, 197, 254, 24,
+				227, 165, 153, 119, 38, 184, 180, 124, 17, 68, 146, 217, 35, 32, 137, 46,
+				55, 63, 209, 91, 149, 188, 207, 205, 144, 135, 151, 178, 220, 252, 190, 97,
+				242, 86, 211, 171, 20, 42, 93, 158, 132, 60, 57, 83, 71, 109, 65, 162,
+				31, 45, 67, 216, 183, 123, 164, 118, 196, 23, 73, 236, 127, 12, 111, 246,
+				108, 161, 59, 82, 41, 157, 85, 170, 251, 96, 134, 177, 187, 204, 62, 90,
+				203, 89, 95, 176, 156, 169, 160, 81, 11, 245, 22, 235, 122, 117, 44, 215,
+				79, 174, 213, 233, 230, 231, 173, 232, 116, 214, 244, 234, 168, 80, 88, 175
+			};
+
+			for (unsigned i = 0; i < 256; ++i)
+				if (GetAlphaValue(i) != values[i] || i && GetAlphaExponent(i) != exponents[i - 1])
+					return false;
+
+			return true;
+		}
+
+		static_assert(MatchesLiteralGaloisField(), "Generated GF(256) tables don't match");
+		static_assert(MatchesLiteralPolynomials(), "Generated generator polynomials don't match");
+
+		struct ProductTable
+		{
+			std::once_flag mBuilt;
+			std::vector<std::uint8_t> mProducts;
+			std::vector<std::uint8_t> mNibbleProducts;
+		};
+
+		const ProductTable& GetProductTable(unsigned parityLength)
+		{
+			static std::array<ProductTable, Tables::MAX_PARITY_LENGTH + 1> tables;
+			auto generatorPolynomial = GetPolynomialCoefficientExponents(parityLength);
+			auto &table = tables[parityLength];
+
+			std::call_once(table.mBuilt, [&table, parityLength, generatorPolynomial] {
+				table.mProducts.resize(256 * parityLength);
+
+				for (unsigned value = 1; value < 256; ++value)
+					for (unsigned i = 0; i < parityLength; ++i)
+						table.mProducts[value * parityLength + i] = static_cast<std::uint8_t>(GetAlphaValue((GetAlphaExponent(value) + generatorPolynomial[i]) % 255));
+
+				//Multiplication distributes over XOR, so v * g = (v & 0x0F) * g ^ (v & 0xF0) * g
+				table.mNibbleProducts.resize(32 * parityLength);
+
+				for (unsigned i = 0; i < parityLength; ++i)
+					for (unsigned nibble = 0; nibble < 16; ++nibble)
+					{
+						table.mNibbleProducts[i * 32 + nibble] = table.mProducts[nibble * parityLength + i];
+						table.mNibbleProducts[i * 32 + 16 + nibble] = table.mProducts[(nibble << 4) * parityLength + i];
+					}
+			});
+
+			return table;
+		}
+
+		struct BatchArguments
+		{
+			const std::uint8_t *mProducts;
+			const std::uint8_t *mNibbleProducts;
+			unsigned mParityLength;
+			const std::uint8_t *mData;
+			size_t mDataLength;
+			std::uint8_t *mParity;
+			size_t mBlockCount;
+		};
+
+		//Encodes blocks [first, last) of the batch
+		void EncodeBatchScalar(const BatchArguments &arguments, size_t first, size_t last)
+		{
+			const size_t stride = arguments.mBlockCount;
+			const unsigned length = arguments.mParityLength;
+
+			for (size_t block = first; block < last; ++block)
+			{
+				std::uint8_t *parity = arguments.mParity + block;
+
+				for (size_t i = 0; i < arguments.mDataLength; ++i)
+				{
+					const std::uint8_t *products = arguments.mProducts + (arguments.mData[i * stride + block] ^ parity[0]) * length;
+
+					for (unsigned j = 0; j + 1 < length; ++j)
+						parity[j * stride] = parity[(j + 1) * stride] ^ products[j];
+
+					parity[(length - 1) * stride] = products[length - 1];
+				}
+			}
+		}
+
+		#ifdef QR_X86
+		//Encodes blocks [first, last) 16 at a time with split nibble multiplication, returns the first block that wasn't encoded
+		QR_TARGET("ssse3")
+		size_t EncodeBatchSSSE3(const BatchArguments &arguments, size_t first, size_t last)
+		{
+			const size_t stride = arguments.mBlockCount;
+			const unsigned length = arguments.mParityLength;
+			const __m128i lowMask = _mm_set1_epi8(0x0F);
+			size_t block = first;
+
+			for (; block + 16 <= last; block += 16)
+			{
+				std::uint8_t *parity = arguments.mParity + block;
+
+				for (size_t i = 0; i < arguments.mDataLength; ++i)
+				{
+					__m128i feedback = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(arguments.mData + i * stride + block)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(parity)));
+					__m128i low = _mm_and_si128(feedback, lowMask), high = _mm_and_si128(_mm_srli_epi16(feedback, 4), lowMask);
+
+					for (unsigned j = 0; j < length; ++j)
+					{
+						const std::uint8_t *nibbleProducts = arguments.mNibbleProducts + j * 32;
+						__m128i product = _mm_xor_si128(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(nibbleProducts)), low),
+							_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(nibbleProducts + 16)), high));
+
+						if (j + 1 < length)
+							product = _mm_xor_si128(product, _mm_loadu_si128(reinterpret_cast<const __m128i *>(parity + (j + 1) * stride)));
+
+						_mm_storeu_si128(reinterpret_cast<__m128i *>(parity + j * stride), product);
+					}
+				}
+			}
+
+			return block;
+		}
+
+		//Encodes blocks [first, last) 32 at a time with split nibble multiplication, returns the first block that wasn't encoded
+		QR_TARGET("avx2")
+		size_t EncodeBatchAVX2(const BatchArguments &arguments, size_t first, size_t last)
+		{
+			const size_t stride = arguments.mBlockCount;
+			const unsigned length = arguments.mParityLength;
+			const __m256i lowMask = _mm256_set1_epi8(0x0F);
+			size_t block = first;
+
+			for (; block + 32 <= last; block += 32)
+			{
+				std::uint8_t *parity = arguments.mParity + block;
+
+				for (size_t i = 0; i < arguments.mDataLength; ++i)
+				{
+					__m256i feedback = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(arguments.mData + i * stride + block)), _mm256_loadu_si256(reinterpret_cast<const __m256i *>(parity)));
+					__m256i low = _mm256_and_si256(feedback, lowMask), high = _mm256_and_si256(_mm256_srli_epi16(feedback, 4), lowMask);
+
+					for (unsigned j = 0; j < length; ++j)
+					{
+						const std::uint8_t *nibbleProducts = arguments.mNibbleProducts + j * 32;
+						__m256i product = _mm256_xor_si256(_mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(nibbleProducts))), low),
+							_mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(nibbleProducts + 16))), high));
+
+						if (j + 1 < length)
+							product = _mm256_xor_si256(product, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(parity + (j + 1) * stride)));
+
+						_mm256_storeu_si256(reinterpret_cast<__m256i *>(parity + j * stride), product);
+					}
+				}
+			}
+
+			return block;
+		}
+		#endif
+
+		void ValidateBatch(std::span<const std::uint8_t> data, std::span<std::uint8_t> parity, size_t blockCount, unsigned parityLength)
+		{
+			if (data.size() % blockCount)
+				throw std::invalid_argument("Data size must be a multiple of the block count");
+
+			if (parity.size() != parityLength * blockCount)
+				throw std::invalid_argument("Parity buffer size doesn't match the error correction codeword count");
+		}
+
+		//Encodes blocks [first, last) with the best kernel up to level. Parity of those blocks must be 0
+		void EncodeBatchRange(const BatchArguments &arguments, size_t first, size_t last, SimdLevel level)
+		{
+			#ifdef QR_X86
+			if (level == SimdLevel::AVX2)
+				first = EncodeBatchAVX2(arguments, first, last);
+
+			//SSSE3 takes the blocks that are left when there aren't enough for AVX2
+			if (level >= SimdLevel::SSSE3)
+				first = EncodeBatchSSSE3(arguments, first, last);
+			#endif
+
+			EncodeBatchScalar(arguments, first, last);
+		}
+		#ifndef TESTS
+	}
+	#endif
+
+	ReedSolomonEncoder::ReedSolomonEncoder(unsigned parityLength)
+		:mProducts(GetProductTable(parityLength).mProducts.data()), mNibbleProducts(GetProductTable(parityLength).mNibbleProducts.data()), mParityLength(parityLength)
+	{}
+
+	void ReedSolomonEncoder::encode(std::span<const std::uint8_t> data, std::span<std::uint8_t> parity) const
+	{
+		if (parity.size() != mParityLength)
+			throw std::invalid_argument("Parity buffer size doesn't match the error correction codeword count");
+
+		std::fill(parity.begin(), parity.end(), std::uint8_t{ 0 });
+		append(data, parity);
+	}
+
+	void ReedSolomonEncoder::append(std::span<const std::uint8_t> data, std::span<std::uint8_t> parity) const
+	{
+		if (parity.size() != mParityLength)
+			throw std::invalid_argument("Parity buffer size doesn't match the error correction codeword count");
+
+		for (std::uint8_t codeword : data)
+		{
+			const std::uint8_t *products = mProducts + (codeword ^ parity[0]) * mParityLength;
+
+			for (unsigned i = 0; i + 1 < mParityLength; ++i)
+				parity[i] = parity[i + 1] ^ products[i];
+
+			parity[mParityLength - 1] = products[mParityLength - 1];
+		}
+	}
+
+	void ReedSolomonEncoder::encodeBatch(std::span<const std::uint8_t> data, std::span<std::uint8_t> parity, size_t blockCount) const
+	{
+		encodeBatch(data, parity, blockCount, GetSimdLevel());
+	}
+
+	void ReedSolomonEncoder::encodeBatch(std::span<const std::uint8_t> data, std::span<std::uint8_t> parity, size_t blockCount, SimdLevel level) const
+	{
+		BatchArguments arguments = { mProducts, mNibbleProducts, mParityLength, data.data(), 0, parity.data(), blockCount };
+
+		if (!blockCount)
+			return;
+
+		ValidateBatch(data, parity, blockCount, mParityLength);
+		arguments.mDataLength = data.size() / blockCount;
+		std::fill(parity.begin(), parity.end(), std::uint8_t{ 0 });
+		EncodeBatchRange(arguments, 0, blockCount, std::min(level, GetSimdLevel()));
+	}
+
+	void ReedSolomonEncoder::encodeBatch(std::span<const std::uint8_t> data, std::span<std::uint8_t> parity, size_t blockCount, size_t firstBlock, size_t lastBlock) const
+	{
+		BatchArguments arguments = { mProducts, mNibbleProducts, mParityLength, data.data(), 0, parity.data(), blockCount };
+
+		if (firstBlock > lastBlock || lastBlock > blockCount)
+			throw std::invalid_argument("Invalid block range");
+
+		if (firstBlock == lastBlock)
+			return;
+
+		ValidateBatch(data, parity, blockCount, mParityLength);
+		arguments.mDataLength = data.size() / blockCount;
+
+		for (unsigned i = 0; i < mParityLength; ++i)
+			std::fill(parity.begin() + i * blockCount + firstBlock, parity.begin() + i * blockCount + lastBlock, std::uint8_t{ 0 });
+
+		EncodeBatchRange(arguments, firstBlock, lastBlock, GetSimdLevel());
+	}
+
+	unsigned ReedSolomonEncoder::getParityLength() const
+	{
+		return mParityLength;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "SimdLevel.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define QR_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
+namespace QR
+{
+	#ifndef TESTS
+	namespace
+	{
+		#endif
+		SimdLevel DetectSimdLevel()
+		{
+			SimdLevel result = SimdLevel::NONE;
+
+			#ifdef QR_X86
+			#ifdef _MSC_VER
+			int info[4];
+
+			__cpuid(info, 0);
+
+			if (info[0] >= 1)
+			{
+				int maxLeaf = info[0];
+
+				__cpuid(info, 1);
+
+				if (info[2] & 1 << 9)
+					result = SimdLevel::SSSE3;
+
+				//AVX2 also needs the OS to save YMM registers
+				if (maxLeaf >= 7 && info[2] & 1 << 27 && info[2] & 1 << 28 && (_xgetbv(0) & 6) == 6)
+				{
+					__cpuidex(info, 7, 0);
+
+					if (info[1] & 1 << 5)
+						result = SimdLevel::AVX2;
+				}
+			}
+			#else
+			__builtin_cpu_init();
+
+			if (__builtin_cpu_supports("avx2"))
+				result = SimdLevel::AVX2;
+			else
+				if (__builtin_cpu_supports("ssse3"))
+					result = SimdLevel::SSSE3;
+			#endif
+			#endif
+
+			return result;
+		}
+		#ifndef TESTS
+	}
+	#endif
+
+	SimdLevel GetSimdLevel()
+	{
+		static const SimdLevel level = DetectSimdLevel();
+
+		return level;
+	}
+}
\ No newline at end of file
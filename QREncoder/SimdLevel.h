@@ -0,0 +1,14 @@
+#ifndef SIMDLEVEL_H
+#define SIMDLEVEL_H
+#include <cstdint>
+
+namespace QR
+{
+	//SIMD instructions the Reed-Solomon and character class kernels can use. Each level includes the ones before it
+	enum class SimdLevel : std::uint8_t { NONE, SSSE3, AVX2 };
+
+	//Best SIMD level supported by the CPU, detected on first use
+	SimdLevel GetSimdLevel();
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "SymbolCache.h"
+#include <stdexcept>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <iterator>
+#include <cstdint>
+
+namespace QR
+{
+	#ifndef TESTS
+	namespace
+	{
+		#endif
+		struct CacheEntry
+		{
+			size_t mHash;
+			BitStream mBitStream;
+			SymbolType mType;
+			unsigned mVersion;
+			ErrorCorrectionLevel mLevel;
+			MaskPolicy mMaskPolicy;
+			unsigned mFixedMaskId;
+			std::shared_ptr<const GeneratedSymbol> mSymbol;
+			size_t mByteCount;
+		};
+
+		struct CacheShard
+		{
+			std::mutex mMutex;
+			std::list<CacheEntry> mEntries; //Most recently used first
+			std::unordered_multimap<size_t, std::list<CacheEntry>::iterator> mIndex; //Equal hashes are told apart by comparing the whole key
+			size_t mByteCount = 0;
+			size_t mHits = 0;
+			size_t mMisses = 0;
+			size_t mEvictions = 0;
+		};
+
+		//Finalizer from SplitMix64, every input bit affects every output bit
+		std::uint64_t MixBits(std::uint64_t value)
+		{
+			value = (value ^ value >> 30) * 0xBF58476D1CE4E5B9;
+			value = (value ^ value >> 27) * 0x94D049BB133111EB;
+
+			return value ^ value >> 31;
+		}
+
+		size_t GetHash(const SymbolCacheKey &key)
+		{
+			std::uint64_t result = MixBits(static_cast<std::uint64_t>(key.mType) | static_cast<std::uint64_t>(key.mVersion) << 8 | static_cast<std::uint64_t>(key.mLevel) << 16 |
+				static_cast<std::uint64_t>(key.mMaskPolicy) << 24 | static_cast<std::uint64_t>(key.mFixedMaskId) << 32);
+
+			result = MixBits(result ^ key.mBitStream.size());
+
+			for (BitStream::WordType word : key.mBitStream.getWords())
+				result = MixBits(result ^ word);
+
+			return static_cast<size_t>(result);
+		}
+
+		bool Matches(const CacheEntry &entry, const SymbolCacheKey &key)
+		{
+			return entry.mType == key.mType && entry.mVersion == key.mVersion && entry.mLevel == key.mLevel && entry.mMaskPolicy == key.mMaskPolicy &&
+				entry.mFixedMaskId == key.mFixedMaskId && entry.mBitStream == key.mBitStream;
+		}
+
+		//Entry for key in shard, or shard.mEntries.end(). The shard must be locked
+		std::list<CacheEntry>::iterator FindEntry(CacheShard &shard, size_t hash, const SymbolCacheKey &key)
+		{
+			auto [first, last] = shard.mIndex.equal_range(hash);
+
+			for (; first != last; ++first)
+				if (Matches(*first->second, key))
+					return first->second;
+
+			return shard.mEntries.end();
+		}
+
+		void EraseEntry(CacheShard &shard, std::list<CacheEntry>::iterator entry)
+		{
+			auto [first, last] = shard.mIndex.equal_range(entry->mHash);
+
+			for (; first != last; ++first)
+				if (first->second == entry)
+				{
+					shard.mIndex.erase(first);
+					break;
+				}
+
+			shard.mByteCount -= entry->mByteCount;
+			shard.mEntries.erase(entry);
+		}
+		#ifndef TESTS
+	}
+	#endif
+}
+
+struct QR::SymbolCache::Impl
+{
+	std::unique_ptr<CacheShard[]> mShards;
+	unsigned mShardCount;
+	size_t mByteBudget;
+
+	CacheShard& getShard(size_t hash)
+	{
+		return mShards[hash % mShardCount];
+	}
+};
+
+QR::SymbolCache::SymbolCache(size_t byteBudget, unsigned shardCount)
+{
+	if (!shardCount)
+		throw std::invalid_argument("Invalid shard count");
+
+	mImpl.reset(new Impl{ std::make_unique<CacheShard[]>(shardCount), shardCount, byteBudget });
+}
+
+QR::SymbolCache::~SymbolCache() = default;
+
+std::shared_ptr<const QR::GeneratedSymbol> QR::SymbolCache::find(const SymbolCacheKey &key)
+{
+	size_t hash = GetHash(key);
+	CacheShard &shard = mImpl->getShard(hash);
+	std::lock_guard lock(shard.mMutex);
+	auto entry = FindEntry(shard, hash, key);
+
+	if (entry == shard.mEntries.end())
+	{
+		++shard.mMisses;
+		return nullptr;
+	}
+
+	++shard.mHits;
+	shard.mEntries.splice(shard.mEntries.begin(), shard.mEntries, entry);
+
+	return entry->mSymbol;
+}
+
+std::shared_ptr<const QR::GeneratedSymbol> QR::SymbolCache::insert(const SymbolCacheKey &key, std::shared_ptr<const GeneratedSymbol> symbol)
+{
+	size_t hash = GetHash(key), shardBudget = mImpl->mByteBudget / mImpl->mShardCount;
+	size_t byteCount = sizeof(CacheEntry) + (symbol->mMatrix.getWords().size() + key.mBitStream.getWords().size()) * sizeof(BitStream::WordType);
+	CacheShard &shard = mImpl->getShard(hash);
+	std::lock_guard lock(shard.mMutex);
+	auto entry = FindEntry(shard, hash, key);
+
+	//Another thread generated the same symbol first
+	if (entry != shard.mEntries.end())
+	{
+		shard.mEntries.splice(shard.mEntries.begin(), shard.mEntries, entry);
+		return entry->mSymbol;
+	}
+
+	if (byteCount > shardBudget)
+		return symbol;
+
+	while (shard.mByteCount + byteCount > shardBudget)
+	{
+		EraseEntry(shard, std::prev(shard.mEntries.end()));
+		++shard.mEvictions;
+	}
+
+	shard.mEntries.push_front({ hash, key.mBitStream, key.mType, key.mVersion, key.mLevel, key.mMaskPolicy, key.mFixedMaskId, symbol, byteCount });
+	shard.mIndex.emplace(hash, shard.mEntries.begin());
+	shard.mByteCount += byteCount;
+
+	return symbol;
+}
+
+void QR::SymbolCache::clear()
+{
+	for (unsigned i = 0; i < mImpl->mShardCount; ++i)
+	{
+		CacheShard &shard = mImpl->mShards[i];
+		std::lock_guard lock(shard.mMutex);
+
+		shard.mEntries.clear();
+		shard.mIndex.clear();
+		shard.mByteCount = 0;
+	}
+}
+
+size_t QR::SymbolCache::getByteBudget() const
+{
+	return mImpl->mByteBudget;
+}
+
+QR::SymbolCacheStatistics QR::SymbolCache::getStatistics() const
+{
+	SymbolCacheStatistics result = {};
+
+	for (unsigned i = 0; i < mImpl->mShardCount; ++i)
+	{
+		CacheShard &shard = mImpl->mShards[i];
+		std::lock_guard lock(shard.mMutex);
+
+		result.mHits += shard.mHits;
+		result.mMisses += shard.mMisses;
+		result.mEvictions += shard.mEvictions;
+		result.mEntryCount += shard.mEntries.size();
+		result.mByteCount += shard.mByteCount;
+	}
+
+	return result;
+}
\ No newline at end of file
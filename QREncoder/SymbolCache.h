@@ -0,0 +1,57 @@
+#ifndef SYMBOLCACHE_H
+#define SYMBOLCACHE_H
+#include "QREncoder.h"
+#include "BitStream.h"
+#include <memory>
+#include <cstddef>
+
+namespace QR
+{
+	//Everything a generated symbol depends on. mBitStream is only borrowed for the call, the cache keeps its own copy
+	struct SymbolCacheKey
+	{
+		const BitStream &mBitStream;
+		SymbolType mType;
+		unsigned mVersion;
+		ErrorCorrectionLevel mLevel;
+		MaskPolicy mMaskPolicy;
+		unsigned mFixedMaskId;
+	};
+
+	struct SymbolCacheStatistics
+	{
+		size_t mHits;
+		size_t mMisses;
+		size_t mEvictions;
+		size_t mEntryCount;
+		size_t mByteCount;
+	};
+
+	//Least recently used symbols, shared by every Encoder given the cache with Encoder::setCache. Keys are hashed into shards with their own lock
+	//and an equal part of the byte budget, so threads only wait on each other when they look up the same shard.
+	//Symbols are immutable once stored, so the pointers returned stay valid and unchanged after they're evicted
+	class SymbolCache final
+	{
+		struct Impl;
+		std::unique_ptr<Impl> mImpl;
+	public:
+		//Throws std::invalid_argument if shardCount is 0
+		explicit SymbolCache(size_t byteBudget, unsigned shardCount = 16);
+		SymbolCache(const SymbolCache&) = delete;
+		SymbolCache& operator=(const SymbolCache&) = delete;
+		~SymbolCache();
+
+		//Symbol stored for key, or null. Counts a hit or a miss
+		std::shared_ptr<const GeneratedSymbol> find(const SymbolCacheKey &key);
+		//Stores symbol for key, evicting the least recently used symbols of its shard until it fits. If key already has a symbol, that one is kept and returned.
+		//A symbol larger than a shard's budget isn't stored
+		std::shared_ptr<const GeneratedSymbol> insert(const SymbolCacheKey &key, std::shared_ptr<const GeneratedSymbol> symbol);
+		//Removes every symbol, counters are kept
+		void clear();
+		//Bytes counted are the packed words of each symbol and its bit stream, plus a fixed overhead per entry
+		size_t getByteBudget() const;
+		SymbolCacheStatistics getStatistics() const;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,726 @@
+#ifndef SYMBOLTABLES_H
+#define SYMBOLTABLES_H
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <cstdint>
+#include "QREncoder.h"
+#include "BitStream.h"
+
+namespace QR
+{
+	//Blocks of the same length, from table 9, page 38
+	struct BlockLayout
+	{
+		std::uint8_t mBlockCount;
+		std::uint8_t mCodewordCount; //Data and error correction codewords in each block
+		std::uint8_t mDataCodewordCount;
+	};
+
+	//Everything about a symbol's version and error correction level that the encoder needs, see GetSymbolDescriptor
+	struct SymbolDescriptor
+	{
+		SymbolType mType;
+		std::uint8_t mVersion;
+		ErrorCorrectionLevel mLevel;
+		std::uint8_t mSize;
+		std::uint8_t mRemainderBitCount;
+		std::uint16_t mDataModuleCount; //Modules available for data and error correction codewords, including remainder bits
+		std::uint16_t mErrorCorrectionCodewordCount;
+		std::uint16_t mDataBitCapacity; //Bits available for the data bit stream
+		std::array<std::uint8_t, 4> mCharacterCountLengths; //Indexed by Mode
+		std::span<const BlockLayout> mBlockLayout;
+		std::span<const std::uint8_t> mAlignmentPatternCenters;
+	};
+
+	struct Feature3Transition
+	{
+		std::uint8_t mState;
+		std::uint8_t mMatches; //Bit i is set if the pattern was completed at bit i of the byte
+	};
+
+	namespace Tables
+	{
+		//Divide by 8 to get data capacity in codewords, do % 8 to get remainder bits. Exceptions are M1 and M3, where the last data codeword is 4 bits long
+		inline constexpr std::array<std::uint16_t, 4> MICRO_DATA_MODULE_COUNTS = { 36, 80, 132, 192 };
+		inline constexpr std::array<std::uint16_t, 40> DATA_MODULE_COUNTS = {
+			208, 359, 567, 807, 1079, 1383, 1568, 1936,
+			2336, 2768, 3232, 3728, 4256, 4651, 5243, 5867,
+			6523, 7211, 7931, 8683, 9252, 10068, 10916, 11796,
+			12708, 13652, 14628, 15371, 16411, 17483, 18587, 19723,
+			20891, 22091, 23008, 24272, 25568, 26896, 28256, 29648
+		};
+
+		//From table 9, page 38. Indexed by version and error correction level, M1 only uses the first entry
+		inline constexpr std::array<std::array<BlockLayout, 3>, 4> MICRO_BLOCK_LAYOUTS = { {
+			{ { { 1, 5, 3 } } },
+			{ { { 1, 10, 5 }, { 1, 10, 4 } } },
+			{ { { 1, 17, 11 }, { 1, 17, 9 } } },
+			{ { { 1, 24, 16 }, { 1, 24, 14 }, { 1, 24, 10 } } }
+		} };
+		//Unused second groups have a block count of 0
+		inline constexpr std::array<std::array<std::array<BlockLayout, 2>, 4>, 40> BLOCK_LAYOUTS = { {
+			{ { { { { 1, 26, 19 } } }, { { { 1, 26, 16 } } }, { { { 1, 26, 13 } } }, { { { 1, 26, 9 } } } } },
+			{ { { { { 1, 44, 34 } } }, { { { 1, 44, 28 } } }, { { { 1, 44, 22 } } }, { { { 1, 44, 16 } } } } },
+			{ { { { { 1, 70, 55 } } }, { { { 1, 70, 44 } } }, { { { 2, 35, 17 } } }, { { { 2, 35, 13 } } } } },
+			{ { { { { 1, 100, 80 } } }, { { { 2, 50, 32 } } }, { { { 2, 50, 24 } } }, { { { 4, 25, 9 } } } } },
+			{ { { { { 1, 134, 108 } } }, { { { 2, 67, 43 } } }, { { { 2, 33, 15 }, { 2, 34, 16 } } }, { { { 2, 33, 11 }, { 2, 34, 12 } } } } },
+			{ { { { { 2, 86, 68 } } }, { { { 4, 43, 27 } } }, { { { 4, 43, 19 } } }, { { { 4, 43, 15 } } } } },
+			{ { { { { 2, 98, 78 } } }, { { { 4, 49, 31 } } }, { { { 2, 32, 14 }, { 4, 33, 15 } } }, { { { 4, 39, 13 }, { 1, 40, 14 } } } } },
+			{ { { { { 2, 121, 97 } } }, { { { 2, 60, 38 }, { 2, 61, 39 } } }, { { { 4, 40, 18 }, { 2, 41, 19 } } }, { { { 4, 40, 14 }, { 2, 41, 15 } } } } },
+			{ { { { { 2, 146, 116 } } }, { { { 3, 58, 36 }, { 2, 59, 37 } } }, { { { 4, 36, 16 }, { 4, 37, 17 } } }, { { { 4, 36, 12 }, { 4, 37, 13 } } } } },
+			{ { { { { 2, 86, 68 }, { 2, 87, 69 } } }, { { { 4, 69, 43 }, { 1, 70, 44 } } }, { { { 6, 43, 19 }, { 2, 44, 20 } } }, { { { 6, 43, 15 }, { 2, 44, 16 } } } } },
+			{ { { { { 4, 101, 81 } } }, { { { 1, 80, 50 }, { 4, 81, 51 } } }, { { { 4, 50, 22 }, { 4, 51, 23 } } }, { { { 3, 36, 12 }, { 8, 37, 13 } } } } },
+			{ { { { { 2, 116, 92 }, { 2, 117, 93 } } }, { { { 6, 58, 36 }, { 2, 59, 37 } } }, { { { 4, 46, 20 }, { 6, 47, 21 } } }, { { { 7, 42, 14 }, { 4, 43, 15 } } } } },
+			{ { { { { 4, 133, 107 } } }, { { { 8, 59, 37 }, { 1, 60, 38 } } }, { { { 8, 44, 20 }, { 4, 45, 21 } } }, { { { 12, 33, 11 }, { 4, 34, 12 } } } } },
+			{ { { { { 3, 145, 115 }, { 1, 146, 116 } } }, { { { 4, 64, 40 }, { 5, 65, 41 } } }, { { { 11, 36, 16 }, { 5, 37, 17 } } }, { { { 11, 36, 12 }, { 5, 37, 13 } } } } },
+			{ { { { { 5, 109, 87 }, { 1, 110, 88 } } }, { { { 5, 65, 41 }, { 5, 66, 42 } } }, { { { 5, 54, 24 }, { 7, 55, 25 } } }, { { { 11, 36, 12 }, { 7, 37, 13 } } } } },
+			{ { { { { 5, 122, 98 }, { 1, 123, 99 } } }, { { { 7, 73, 45 }, { 3, 74, 46 } } }, { { { 15, 43, 19 }, { 2, 44, 20 } } }, { { { 3, 45, 15 }, { 13, 46, 16 } } } } },
+			{ { { { { 1, 135, 107 }, { 5, 136, 108 } } }, { { { 10, 74, 46 }, { 1, 75, 47 } } }, { { { 1, 50, 22 }, { 15, 51, 23 } } }, { { { 2, 42, 14 }, { 17, 43, 15 } } } } },
+			{ { { { { 5, 150, 120 }, { 1, 151, 121 } } }, { { { 9, 69, 43 }, { 4, 70, 44 } } }, { { { 17, 50, 22 }, { 1, 51, 23 } } }, { { { 2, 42, 14 }, { 19, 43, 15 } } } } },
+			{ { { { { 3, 141, 113 }, { 4, 142, 114 } } }, { { { 3, 70, 44 }, { 11, 71, 45 } } }, { { { 17, 47, 21 }, { 4, 48, 22 } } }, { { { 9, 39, 13 }, { 16, 40, 14 } } } } },
+			{ { { { { 3, 135, 107 }, { 5, 136, 108 } } }, { { { 3, 67, 41 }, { 13, 68, 42 } } }, { { { 15, 54, 24 }, { 5, 55, 25 } } }, { { { 15, 43, 15 }, { 10, 44, 16 } } } } },
+			{ { { { { 4, 144, 116 }, { 4, 145, 117 } } }, { { { 17, 68, 42 } } }, { { { 17, 50, 22 }, { 6, 51, 23 } } }, { { { 19, 46, 16 }, { 6, 47, 17 } } } } },
+			{ { { { { 2, 139, 111 }, { 7, 140, 112 } } }, { { { 17, 74, 46 } } }, { { { 7, 54, 24 }, { 16, 55, 25 } } }, { { { 34, 37, 13 } } } } },
+			{ { { { { 4, 151, 121 }, { 5, 152, 122 } } }, { { { 4, 75, 47 }, { 14, 76, 48 } } }, { { { 11, 54, 24 }, { 14, 55, 25 } } }, { { { 16, 45, 15 }, { 14, 46, 16 } } } } },
+			{ { { { { 6, 147, 117 }, { 4, 148, 118 } } }, { { { 6, 73, 45 }, { 14, 74, 46 } } }, { { { 11, 54, 24 }, { 16, 55, 25 } } }, { { { 30, 46, 16 }, { 2, 47, 17 } } } } },
+			{ { { { { 8, 132, 106 }, { 4, 133, 107 } } }, { { { 8, 75, 47 }, { 13, 76, 48 } } }, { { { 7, 54, 24 }, { 22, 55, 25 } } }, { { { 22, 45, 15 }, { 13, 46, 16 } } } } },
+			{ { { { { 10, 142, 114 }, { 2, 143, 115 } } }, { { { 19, 74, 46 }, { 4, 75, 47 } } }, { { { 28, 50, 22 }, { 6, 51, 23 } } }, { { { 33, 46, 16 }, { 4, 47, 17 } } } } },
+			{ { { { { 8, 152, 122 }, { 4, 153, 123 } } }, { { { 22, 73, 45 }, { 3, 74, 46 } } }, { { { 8, 53, 23 }, { 26, 54, 24 } } }, { { { 12, 45, 15 }, { 28, 46, 16 } } } } },
+			{ { { { { 3, 147, 117 }, { 10, 148, 118 } } }, { { { 3, 73, 45 }, { 23, 74, 46 } } }, { { { 4, 54, 24 }, { 31, 55, 25 } } }, { { { 11, 45, 15 }, { 31, 46, 16 } } } } },
+			{ { { { { 7, 146, 116 }, { 7, 147, 117 } } }, { { { 21, 73, 45 }, { 7, 74, 46 } } }, { { { 1, 53, 23 }, { 37, 54, 24 } } }, { { { 19, 45, 15 }, { 26, 46, 16 } } } } },
+			{ { { { { 5, 145, 115 }, { 10, 146, 116 } } }, { { { 19, 75, 47 }, { 10, 76, 48 } } }, { { { 15, 54, 24 }, { 25, 55, 25 } } }, { { { 23, 45, 15 }, { 25, 46, 16 } } } } },
+			{ { { { { 13, 145, 115 }, { 3, 146, 116 } } }, { { { 2, 74, 46 }, { 29, 75, 47 } } }, { { { 42, 54, 24 }, { 1, 55, 25 } } }, { { { 23, 45, 15 }, { 28, 46, 16 } } } } },
+			{ { { { { 17, 145, 115 } } }, { { { 10, 74, 46 }, { 23, 75, 47 } } }, { { { 10, 54, 24 }, { 35, 55, 25 } } }, { { { 19, 45, 15 }, { 35, 46, 16 } } } } },
+			{ { { { { 17, 145, 115 }, { 1, 146, 116 } } }, { { { 14, 74, 46 }, { 21, 75, 47 } } }, { { { 29, 54, 24 }, { 19, 55, 25 } } }, { { { 11, 45, 15 }, { 46, 46, 16 } } } } },
+			{ { { { { 13, 145, 115 }, { 6, 146, 116 } } }, { { { 14, 74, 46 }, { 23, 75, 47 } } }, { { { 44, 54, 24 }, { 7, 55, 25 } } }, { { { 59, 46, 16 }, { 1, 47, 17 } } } } },
+			{ { { { { 12, 151, 121 }, { 7, 152, 122 } } }, { { { 12, 75, 47 }, { 26, 76, 48 } } }, { { { 39, 54, 24 }, { 14, 55, 25 } } }, { { { 22, 45, 15 }, { 41, 46, 16 } } } } },
+			{ { { { { 6, 151, 121 }, { 14, 152, 122 } } }, { { { 6, 75, 47 }, { 34, 76, 48 } } }, { { { 46, 54, 24 }, { 10, 55, 25 } } }, { { { 2, 45, 15 }, { 64, 46, 16 } } } } },
+			{ { { { { 17, 152, 122 }, { 4, 153, 123 } } }, { { { 29, 74, 46 }, { 14, 75, 47 } } }, { { { 49, 54, 24 }, { 10, 55, 25 } } }, { { { 24, 45, 15 }, { 46, 46, 16 } } } } },
+			{ { { { { 4, 152, 122 }, { 18, 153, 123 } } }, { { { 13, 74, 46 }, { 32, 75, 47 } } }, { { { 48, 54, 24 }, { 14, 55, 25 } } }, { { { 42, 45, 15 }, { 32, 46, 16 } } } } },
+			{ { { { { 20, 147, 117 }, { 4, 148, 118 } } }, { { { 40, 75, 47 }, { 7, 76, 48 } } }, { { { 43, 54, 24 }, { 22, 55, 25 } } }, { { { 10, 45, 15 }, { 67, 46, 16 } } } } },
+			{ { { { { 19, 148, 118 }, { 6, 149, 119 } } }, { { { 18, 75, 47 }, { 31, 76, 48 } } }, { { { 34, 54, 24 }, { 34, 55, 25 } } }, { { { 20, 45, 15 }, { 61, 46, 16 } } } } }
+		} };
+
+		//From table 9, page 38
+		inline constexpr std::array<std::array<std::uint16_t, 3>, 4> MICRO_ERROR_CORRECTION_CODEWORD_COUNTS = { {
+			{ 2 }, //M1 symbols only have error detection
+			{ 5, 6 },
+			{ 6, 8 },
+			{ 8, 10, 14 }
+		} };
+		inline constexpr std::array<std::array<std::uint16_t, 4>, 40> ERROR_CORRECTION_CODEWORD_COUNTS = { {
+			{ 7, 10, 13, 17 },
+			{ 10, 16, 22, 28 },
+			{ 15, 26, 36, 44 },
+			{ 20, 36, 52, 64 },
+			{ 26, 48, 72, 88 },
+			{ 36, 64, 96, 112 },
+			{ 40, 72, 108, 130 },
+			{ 48, 88, 132, 156 },
+			{ 60, 110, 160, 192 },
+			{ 72, 130, 192, 224 },
+			{ 80, 150, 224, 264 },
+			{ 96, 176, 260, 308 },
+			{ 104, 198, 288, 352 },
+			{ 120, 216, 320, 384 },
+			{ 132, 240, 360, 432 },
+			{ 144, 280, 408, 480 },
+			{ 168, 308, 448, 532 },
+			{ 180, 338, 504, 588 },
+			{ 196, 364, 546, 650 },
+			{ 224, 416, 600, 700 },
+			{ 224, 442, 644, 750 },
+			{ 252, 476, 690, 816 },
+			{ 270, 504, 750, 900 },
+			{ 300, 560, 810, 960 },
+			{ 312, 588, 870, 1050 },
+			{ 336, 644, 952, 1110 },
+			{ 360, 700, 1020, 1200 },
+			{ 390, 728, 1050, 1260 },
+			{ 420, 784, 1140, 1350 },
+			{ 450, 812, 1200, 1440 },
+			{ 480, 868, 1290, 1530 },
+			{ 510, 924, 1350, 1620 },
+			{ 540, 980, 1440, 1710 },
+			{ 570, 1036, 1530, 1800 },
+			{ 570, 1064, 1590, 1890 },
+			{ 600, 1120, 1680, 1980 },
+			{ 630, 1204, 1770, 2100 },
+			{ 660, 1260, 1860, 2220 },
+			{ 720, 1316, 1950, 2310 },
+			{ 750, 1372, 2040, 2430 }
+		} };
+
+		//From table 3, page 23. Indexed by version and mode, QR versions are grouped into 1-9, 10-26 and 27-40
+		inline constexpr std::array<std::array<std::uint8_t, 4>, 4> MICRO_CHARACTER_COUNT_LENGTHS = { { { 3 }, { 4, 3 }, { 5, 4, 4, 3 }, { 6, 5, 5, 4 } } };
+		inline constexpr std::array<std::array<std::uint8_t, 4>, 3> CHARACTER_COUNT_LENGTHS = { { { 10, 9, 8, 8 }, { 12, 11, 16, 10 }, { 14, 13, 16, 12 } } };
+
+		//From annex E, table E.1. Version n has n / 7 + 2 centers, except version 1 which has none
+		inline constexpr std::array<std::array<std::uint8_t, 7>, 40> ALIGNMENT_PATTERN_CENTERS = { {
+			{ },
+			{ 6, 18 },
+			{ 6, 22 },
+			{ 6, 26 },
+			{ 6, 30 },
+			{ 6, 34 },
+			{ 6, 22, 38 },
+			{ 6, 24, 42 },
+			{ 6, 26, 46 },
+			{ 6, 28, 50 },
+			{ 6, 30, 54 },
+			{ 6, 32, 58 },
+			{ 6, 34, 62 },
+			{ 6, 26, 46, 66 },
+			{ 6, 26, 48, 70 },
+			{ 6, 26, 50, 74 },
+			{ 6, 30, 54, 78 },
+			{ 6, 30, 56, 82 },
+			{ 6, 30, 58, 86 },
+			{ 6, 34, 62, 90 },
+			{ 6, 28, 50, 72, 94 },
+			{ 6, 26, 50, 74, 98 },
+			{ 6, 30, 54, 78, 102 },
+			{ 6, 28, 54, 80, 106 },
+			{ 6, 32, 58, 84, 110 },
+			{ 6, 30, 58, 86, 114 },
+			{ 6, 34, 62, 90, 118 },
+			{ 6, 26, 50, 74, 98, 122 },
+			{ 6, 30, 54, 78, 102, 126 },
+			{ 6, 26, 52, 78, 104, 130 },
+			{ 6, 30, 56, 82, 108, 134 },
+			{ 6, 34, 60, 86, 112, 138 },
+			{ 6, 30, 58, 86, 114, 142 },
+			{ 6, 34, 62, 90, 118, 146 },
+			{ 6, 30, 54, 78, 102, 126, 150 },
+			{ 6, 24, 50, 76, 102, 128, 154 },
+			{ 6, 28, 54, 80, 106, 132, 158 },
+			{ 6, 32, 58, 84, 110, 136, 162 },
+			{ 6, 26, 54, 82, 110, 138, 166 },
+			{ 6, 30, 58, 86, 114, 142, 170 }
+		} };
+
+		//From table C.1, page 80. Indexed by the 5 data bits, before they're masked
+		inline constexpr std::array<std::uint16_t, 32> FORMAT_INFORMATION = {
+			0b000000000000000,
+			0b000010100110111,
+			0b000101001101110,
+			0b000111101011001,
+			0b001000111101011,
+			0b001010011011100,
+			0b001101110000101,
+			0b001111010110010,
+			0b010001111010110,
+			0b010011011100001,
+			0b010100110111000,
+			0b010110010001111,
+			0b011001000111101,
+			0b011011100001010,
+			0b011100001010011,
+			0b011110101100100,
+			0b100001010011011,
+			0b100011110101100,
+			0b100100011110101,
+			0b100110111000010,
+			0b101001101110000,
+			0b101011001000111,
+			0b101100100011110,
+			0b101110000101001,
+			0b110000101001101,
+			0b110010001111010,
+			0b110101100100011,
+			0b110111000010100,
+			0b111000010100110,
+			0b111010110010001,
+			0b111101011001000,
+			0b111111111111111
+		};
+
+		//From table D.1, page 83. Starts at version 7
+		inline constexpr std::array<std::uint32_t, 34> VERSION_INFORMATION = {
+			0b000111110010010100,
+			0b001000010110111100,
+			0b001001101010011001,
+			0b001010010011010011,
+			0b001011101111110110,
+			0b001100011101100010,
+			0b001101100001000111,
+			0b001110011000001101,
+			0b001111100100101000,
+			0b010000101101111000,
+			0b010001010001011101,
+			0b010010101000010111,
+			0b010011010100110010,
+			0b010100100110100110,
+			0b010101011010000011,
+			0b010110100011001001,
+			0b010111011111101100,
+			0b011000111011000100,
+			0b011001000111100001,
+			0b011010111110101011,
+			0b011011000010001110,
+			0b011100110000011010,
+			0b011101001100111111,
+			0b011110110101110101,
+			0b011111001001010000,
+			0b100000100111010101,
+			0b100001011011110000,
+			0b100010100010111010,
+			0b100011011110011111,
+			0b100100101100001011,
+			0b100101010000101110,
+			0b100110101001100100,
+			0b100111010101000001,
+			0b101000110001101001
+		};
+	}
+
+	constexpr unsigned GetSymbolSize(SymbolType type, std::uint8_t version)
+	{
+		unsigned result = 0;
+
+		switch (type)
+		{
+			case SymbolType::QR:
+				if (version > 40)
+					throw std::invalid_argument("Invalid version");
+				result = 21u + (version - 1) * 4;
+				break;
+
+			case SymbolType::MICRO_QR:
+				if (version > 4)
+					throw std::invalid_argument("Invalid version");
+				result = 11u + (version - 1) * 2;
+				break;
+		}
+
+		return result;
+	}
+
+	constexpr unsigned GetDataModuleCount(SymbolType type, std::uint8_t version)
+	{
+		return type == SymbolType::MICRO_QR ? Tables::MICRO_DATA_MODULE_COUNTS[version - 1] : Tables::DATA_MODULE_COUNTS[version - 1];
+	}
+
+	//From table 1, page 18
+	constexpr unsigned GetRemainderBitCount(SymbolType type, std::uint8_t version)
+	{
+		return type == SymbolType::QR ? GetDataModuleCount(type, version) % 8 : 0;
+	}
+
+	//Only M1 symbols use ERROR_DETECTION_ONLY, their tables are stored as level L
+	constexpr size_t GetLevelIndex(ErrorCorrectionLevel level)
+	{
+		return level == ErrorCorrectionLevel::ERROR_DETECTION_ONLY ? 0 : static_cast<size_t>(level);
+	}
+
+	constexpr std::span<const BlockLayout> GetBlockLayout(SymbolType type, std::uint8_t version, ErrorCorrectionLevel level)
+	{
+		std::span<const BlockLayout> result;
+
+		if (type == SymbolType::MICRO_QR)
+		{
+			if (GetLevelIndex(level) < Tables::MICRO_BLOCK_LAYOUTS[version - 1].size())
+				result = std::span(Tables::MICRO_BLOCK_LAYOUTS[version - 1]).subspan(GetLevelIndex(level), 1);
+		}
+		else
+			result = Tables::BLOCK_LAYOUTS[version - 1][GetLevelIndex(level)];
+
+		//Drop groups that aren't used
+		while (!result.empty() && !result.back().mBlockCount)
+			result = result.first(result.size() - 1);
+
+		return result;
+	}
+
+	constexpr unsigned GetErrorCorrectionCodewordCount(SymbolType type, std::uint8_t version, ErrorCorrectionLevel level)
+	{
+		unsigned result = 0;
+
+		if (type == SymbolType::MICRO_QR)
+		{
+			if (GetLevelIndex(level) < Tables::MICRO_ERROR_CORRECTION_CODEWORD_COUNTS[version - 1].size())
+				result = Tables::MICRO_ERROR_CORRECTION_CODEWORD_COUNTS[version - 1][GetLevelIndex(level)];
+		}
+		else
+			result = Tables::ERROR_CORRECTION_CODEWORD_COUNTS[version - 1][GetLevelIndex(level)];
+
+		return result;
+	}
+
+	//Length of the character count indicator
+	constexpr unsigned GetCharacterCountLength(SymbolType type, std::uint8_t version, Mode mode)
+	{
+		unsigned result;
+
+		if (type == SymbolType::MICRO_QR)
+			result = Tables::MICRO_CHARACTER_COUNT_LENGTHS[version - 1][static_cast<size_t>(mode)];
+		else
+			result = Tables::CHARACTER_COUNT_LENGTHS[version <= 9 ? 0 : version <= 26 ? 1 : 2][static_cast<size_t>(mode)];
+
+		return result;
+	}
+
+	//From table 2, page 23. version parameter is only used for Micro QR
+	constexpr BitField GetModeIndicator(SymbolType type, std::uint8_t version, Mode mode)
+	{
+		BitField result = {};
+
+		if (type == SymbolType::MICRO_QR)
+		{
+			result.mLength = version - 1;
+
+			if (version > 1)
+			{
+				if (mode == Mode::ALPHANUMERIC || mode == Mode::KANJI)
+					result.mValue |= 0b01;
+
+				if (version > 2 && (mode == Mode::BYTE || mode == Mode::KANJI))
+					result.mValue |= 0b10;
+			}
+		}
+		else
+		{
+			result.mLength = 4;
+
+			switch (mode)
+			{
+				case Mode::NUMERIC:
+					result.mValue = 0b0001;
+					break;
+
+				case Mode::ALPHANUMERIC:
+					result.mValue = 0b0010;
+					break;
+
+				case Mode::BYTE:
+					result.mValue = 0b0100;
+					break;
+
+				case Mode::KANJI:
+					result.mValue = 0b1000;
+					break;
+			}
+		}
+
+		return result;
+	}
+
+	//version parameter is only used for Micro QR
+	constexpr BitField GetTerminator(SymbolType type, std::uint8_t version)
+	{
+		return { 0, type == SymbolType::MICRO_QR ? 3 + (version - 1) * 2u : 4u };
+	}
+
+	//From table 3, page 23
+	constexpr BitField GetCharacterCountIndicator(const SymbolDescriptor &descriptor, Mode mode, size_t characterCount)
+	{
+		unsigned length = descriptor.mCharacterCountLengths[static_cast<size_t>(mode)];
+
+		return { static_cast<std::uint32_t>(characterCount & ((1u << length) - 1)), length };
+	}
+
+	//Returns bit sequence containing ECI mode indicator and ECI designator.
+	constexpr BitField GetECISequence(unsigned assignmentNumber)
+	{
+		const std::uint32_t modeIndicator = 0b0111;
+		BitField result = {};
+
+		if (assignmentNumber <= 127)
+			result = { modeIndicator << 8 | assignmentNumber, 12 };
+		else
+			if (assignmentNumber <= 16383)
+				result = { modeIndicator << 16 | 0b10 << 14 | assignmentNumber, 20 };
+			else
+				if (assignmentNumber <= 999999)
+					result = { modeIndicator << 24 | 0b110 << 21 | assignmentNumber, 28 };
+				else
+					throw std::invalid_argument("Invalid ECI assignment number, max value is 999999");
+
+		return result;
+	}
+
+	//15 bits, bit i is the i-th module drawn
+	constexpr std::uint16_t GetFormatInformation(SymbolType type, std::uint8_t version, ErrorCorrectionLevel level, size_t maskId)
+	{
+		unsigned result = 0;
+
+		if (type == SymbolType::QR)
+		{
+			switch (level)
+			{
+				case ErrorCorrectionLevel::L:
+					result = 0b01;
+					break;
+
+				case ErrorCorrectionLevel::M:
+					result = 0b00;
+					break;
+
+				case ErrorCorrectionLevel::Q:
+					result = 0b11;
+					break;
+
+				case ErrorCorrectionLevel::H:
+					result = 0b10;
+					break;
+			}
+
+			return static_cast<std::uint16_t>(Tables::FORMAT_INFORMATION[result << 3 | maskId & 0b111] ^ 21522);
+		}
+		else
+		{
+			switch (version)
+			{
+				case 1:
+				case 2:
+					result = version - 1;
+					break;
+
+				case 3:
+					result = 3;
+					break;
+
+				case 4:
+					result = 5;
+					break;
+			}
+
+			if (level != ErrorCorrectionLevel::ERROR_DETECTION_ONLY)
+				result += static_cast<unsigned>(level);
+
+			return static_cast<std::uint16_t>(Tables::FORMAT_INFORMATION[(result & 0b111) << 2 | maskId & 0b11] ^ 17477);
+		}
+	}
+
+	//18 bits, bit i is the i-th module drawn. version must be at least 7
+	constexpr std::uint32_t GetVersionInformation(std::uint8_t version)
+	{
+		return Tables::VERSION_INFORMATION[version - 7];
+	}
+
+	//From table 10, page 50.
+	constexpr bool GetMaskBit(SymbolType type, std::uint8_t maskId, Symbol::size_type i, Symbol::size_type j)
+	{
+		bool result = false;
+
+		if (type == SymbolType::MICRO_QR)
+			switch (maskId)
+			{
+				case 0b00:
+					maskId = 0b001;
+					break;
+
+				case 0b01:
+					maskId = 0b100;
+					break;
+
+				case 0b10:
+					maskId = 0b110;
+					break;
+
+				case 0b11:
+					maskId = 0b111;
+					break;
+			}
+
+		switch (maskId)
+		{
+			case 0b000:
+				result = !((i + j) % 2);
+				break;
+
+			case 0b001:
+				result = !(i % 2);
+				break;
+
+			case 0b010:
+				result = !(j % 3);
+				break;
+
+			case 0b011:
+				result = !((i + j) % 3);
+				break;
+
+			case 0b100:
+				result = !((i / 2 + j / 3) % 2);
+				break;
+
+			case 0b101:
+				result = !((i * j) % 2 + (i * j) % 3);
+				break;
+
+			case 0b110:
+				result = !(((i * j) % 2 + (i * j) % 3) % 2);
+				break;
+
+			case 0b111:
+				result = !(((i + j) % 2 + (i * j) % 3) % 2);
+				break;
+		}
+
+		return result;
+	}
+
+	constexpr std::span<const std::uint8_t> GetAlignmentPatternCenters(std::uint8_t version)
+	{
+		if (!version || version > Tables::ALIGNMENT_PATTERN_CENTERS.size())
+			throw std::out_of_range("Invalid version");
+
+		return std::span(Tables::ALIGNMENT_PATTERN_CENTERS[version - 1]).first(version == 1 ? 0 : version / 7 + 2);
+	}
+
+	namespace Tables
+	{
+		constexpr SymbolDescriptor BuildSymbolDescriptor(SymbolType type, std::uint8_t version, ErrorCorrectionLevel level)
+		{
+			SymbolDescriptor result = {};
+
+			result.mType = type;
+			result.mVersion = version;
+			result.mLevel = level;
+			result.mSize = static_cast<std::uint8_t>(GetSymbolSize(type, version));
+			result.mRemainderBitCount = static_cast<std::uint8_t>(GetRemainderBitCount(type, version));
+			result.mDataModuleCount = static_cast<std::uint16_t>(GetDataModuleCount(type, version));
+			result.mErrorCorrectionCodewordCount = static_cast<std::uint16_t>(GetErrorCorrectionCodewordCount(type, version, level));
+			result.mDataBitCapacity = static_cast<std::uint16_t>(result.mDataModuleCount - result.mRemainderBitCount - result.mErrorCorrectionCodewordCount * 8);
+
+			for (size_t mode = 0; mode < result.mCharacterCountLengths.size(); ++mode)
+				result.mCharacterCountLengths[mode] = static_cast<std::uint8_t>(GetCharacterCountLength(type, version, static_cast<Mode>(mode)));
+
+			result.mBlockLayout = GetBlockLayout(type, version, level);
+
+			if (type == SymbolType::QR)
+				result.mAlignmentPatternCenters = GetAlignmentPatternCenters(version);
+
+			return result;
+		}
+
+		//QR versions first, then Micro QR versions. Indexed by ErrorCorrectionLevel, combinations that the encoder rejects are filled too
+		constexpr std::array<std::array<SymbolDescriptor, 5>, 44> BuildSymbolDescriptors()
+		{
+			std::array<std::array<SymbolDescriptor, 5>, 44> result{};
+
+			for (unsigned i = 0; i < result.size(); ++i)
+				for (unsigned level = 0; level < result[i].size(); ++level)
+					result[i][level] = i < 40 ? BuildSymbolDescriptor(SymbolType::QR, static_cast<std::uint8_t>(i + 1), static_cast<ErrorCorrectionLevel>(level)) :
+						BuildSymbolDescriptor(SymbolType::MICRO_QR, static_cast<std::uint8_t>(i - 39), static_cast<ErrorCorrectionLevel>(level));
+
+			return result;
+		}
+
+		inline constexpr std::array<std::array<SymbolDescriptor, 5>, 44> SYMBOL_DESCRIPTORS = BuildSymbolDescriptors();
+
+		//Every block layout must add up to the codeword counts of the other tables, and alignment pattern center counts must match the table
+		constexpr bool IsConsistent()
+		{
+			for (const auto &descriptors : SYMBOL_DESCRIPTORS)
+				for (const auto &descriptor : descriptors)
+				{
+					unsigned codewordCount = 0, errorCorrectionCodewordCount = 0;
+
+					if (descriptor.mBlockLayout.empty())
+						continue;
+
+					for (const auto &group : descriptor.mBlockLayout)
+						codewordCount += group.mBlockCount * group.mCodewordCount, errorCorrectionCodewordCount += group.mBlockCount * (group.mCodewordCount - group.mDataCodewordCount);
+
+					//The 4 bit codeword in M1 and M3 counts as a whole one
+					if (codewordCount != (descriptor.mDataModuleCount - descriptor.mRemainderBitCount + 4u) / 8 || errorCorrectionCodewordCount != descriptor.mErrorCorrectionCodewordCount)
+						return false;
+				}
+
+			for (std::uint8_t version = 2; version <= ALIGNMENT_PATTERN_CENTERS.size(); ++version)
+			{
+				auto centers = GetAlignmentPatternCenters(version);
+
+				if (!centers.back() || centers.size() < ALIGNMENT_PATTERN_CENTERS[version - 1].size() && ALIGNMENT_PATTERN_CENTERS[version - 1][centers.size()])
+					return false;
+			}
+
+			return true;
+		}
+
+		static_assert(IsConsistent(), "Block layouts don't match the codeword counts");
+
+		//Per byte transitions of the 1:1:3:1:1 pattern matcher, for each of its 7 states. The matcher restarts from the beginning of the pattern
+		//on every mismatch and after every match, so it doesn't find overlapping occurrences.
+		constexpr std::array<std::array<Feature3Transition, 256>, 7> BuildFeature3Transitions()
+		{
+			const std::array<bool, 7> pattern = { 1, 0, 1, 1, 1, 0, 1 };
+			std::array<std::array<Feature3Transition, 256>, 7> result = {};
+
+			for (unsigned state = 0; state < pattern.size(); ++state)
+				for (unsigned byte = 0; byte < 256; ++byte)
+				{
+					unsigned current = state, matches = 0;
+
+					for (unsigned bit = 0; bit < 8; ++bit)
+					{
+						bool module = byte >> bit & 1;
+
+						if (module == pattern[current])
+							++current;
+						else
+							current = module == pattern[0] ? 1 : 0;
+
+						if (current == pattern.size())
+							matches |= 1 << bit, current = 0;
+					}
+
+					result[state][byte] = { static_cast<std::uint8_t>(current), static_cast<std::uint8_t>(matches) };
+				}
+
+			return result;
+		}
+
+		inline constexpr std::array<std::array<Feature3Transition, 256>, 7> FEATURE3_TRANSITIONS = BuildFeature3Transitions();
+	}
+
+	//Throws std::invalid_argument if type doesn't have that version. Takes the version before it's narrowed to std::uint8_t, so 257 isn't read as 1
+	constexpr void ValidateVersion(SymbolType type, unsigned version)
+	{
+		if (!version)
+			throw std::invalid_argument("Minimum version for QR and Micro QR symbols is 1");
+
+		if (type == SymbolType::MICRO_QR && version > 4)
+			throw std::invalid_argument("Max version for Micro QR symbols is M4");
+
+		if (type == SymbolType::QR && version > 40)
+			throw std::invalid_argument("Max version for QR symbols is 40");
+	}
+
+	//Throws std::invalid_argument if type doesn't have that version, or the version doesn't support level
+	constexpr void ValidateArguments(SymbolType type, unsigned version, ErrorCorrectionLevel level)
+	{
+		ValidateVersion(type, version);
+
+		if (type == SymbolType::MICRO_QR)
+		{
+			if (version == 1 && level != ErrorCorrectionLevel::ERROR_DETECTION_ONLY)
+				throw std::invalid_argument("M1 symbols don't support error correction");
+
+			if (version != 1 && level == ErrorCorrectionLevel::ERROR_DETECTION_ONLY)
+				throw std::invalid_argument("ERROR_DETECTION_ONLY is only for M1 symbols");
+
+			if (level == ErrorCorrectionLevel::Q && version != 4)
+				throw std::invalid_argument("Level Q error correction in Micro QR symbols is only supported in version M4");
+
+			if (level == ErrorCorrectionLevel::H)
+				throw std::invalid_argument("Level H error correction is not supported in Micro QR symbols");
+		}
+		else if (type == SymbolType::QR && level == ErrorCorrectionLevel::ERROR_DETECTION_ONLY)
+			throw std::invalid_argument("ERROR_DETECTION_ONLY is only for M1 symbols");
+	}
+
+	//Throws std::invalid_argument if version is out of range for type. level isn't validated
+	constexpr const SymbolDescriptor& GetSymbolDescriptor(SymbolType type, std::uint8_t version, ErrorCorrectionLevel level)
+	{
+		if (!version || version > (type == SymbolType::MICRO_QR ? 4 : 40))
+			throw std::invalid_argument("Invalid version");
+
+		return Tables::SYMBOL_DESCRIPTORS[type == SymbolType::MICRO_QR ? version + 39 : version - 1][static_cast<size_t>(level)];
+	}
+}
+
+#endif
\ No newline at end of file
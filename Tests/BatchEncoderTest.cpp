@@ -0,0 +1,155 @@
+#include "gtest/gtest.h"
+#include "BatchEncoder.h"
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+
+namespace
+{
+	unsigned GetSymbolIndex(const QR::SymbolParameters &parameters)
+	{
+		return parameters.mType == QR::SymbolType::MICRO_QR ? parameters.mVersion : parameters.mVersion + 4;
+	}
+
+	//No smaller symbol than the one picked for an auto version job fits the characters at its minimum level, and segments chosen for version 40 never give a smaller one
+	void ExpectSmallestSymbol(const QR::EncodeJob &job, const QR::SymbolParameters &parameters)
+	{
+		bool allowMicroQR = job.mType == QR::SymbolType::MICRO_QR;
+
+		EXPECT_TRUE(allowMicroQR || parameters.mType == QR::SymbolType::QR) << job.mCharacters;
+		EXPECT_LE(GetSymbolIndex(parameters), GetSymbolIndex(QR::ChooseSymbol(QR::GetOptimalSegments(job.mCharacters, QR::SymbolType::QR, 40), job.mLevel, allowMicroQR)))
+			<< job.mCharacters;
+
+		for (unsigned index = allowMicroQR ? 1 : 5; index < GetSymbolIndex(parameters); ++index)
+		{
+			QR::SymbolType type = index <= 4 ? QR::SymbolType::MICRO_QR : QR::SymbolType::QR;
+
+			//Higher levels only have less capacity, and the constructor throws if the version doesn't support the level
+			EXPECT_ANY_THROW(QR::Encoder(type, index <= 4 ? index : index - 4, job.mLevel).addText(job.mCharacters)) << job.mCharacters << ' ' << index;
+		}
+	}
+}
+
+TEST(EncodeBatch, MatchesEncoder) //Results must be in input order and match encoding each job alone, with any thread count and chunk size
+{
+	std::vector<std::string> messages;
+	std::vector<QR::EncodeJob> jobs;
+
+	for (unsigned i = 0; i < 150; ++i)
+		messages.push_back(std::to_string(i * 7919) + (i % 3 ? "ABC" : "abc\x93\x5F"));
+
+	for (unsigned i = 0; i < messages.size(); ++i)
+	{
+		QR::EncodeJob job = { messages[i], std::nullopt, QR::SymbolType::QR, i % 4 ? i % 5 + 3 : 0, static_cast<QR::ErrorCorrectionLevel>(i % 4) };
+
+		if (i % 7 == 0)
+			job.mMode = QR::Mode::NUMERIC; //Fails for every message with letters
+		else
+			if (i % 11 == 0)
+				job.mType = QR::SymbolType::MICRO_QR, job.mVersion = 0;
+
+		jobs.push_back(job);
+	}
+
+	std::vector<QR::EncodeResult> expected(jobs.size());
+
+	QR::EncodeBatch(jobs, expected, { 1, jobs.size() });
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		const auto &job = jobs[i];
+
+		if (job.mMode)
+		{
+			EXPECT_TRUE(expected[i].mError);
+			EXPECT_THROW(std::rethrow_exception(expected[i].mError), std::invalid_argument);
+			continue;
+		}
+
+		ASSERT_FALSE(expected[i].mError) << i;
+
+		QR::Encoder encoder(expected[i].mParameters.mType, expected[i].mParameters.mVersion, expected[i].mParameters.mLevel);
+
+		encoder.addText(job.mCharacters);
+		EXPECT_EQ(expected[i].mMatrix, encoder.generateMatrixPacked()) << i;
+
+		if (job.mVersion)
+			EXPECT_EQ(expected[i].mParameters.mVersion, job.mVersion);
+		else
+			ExpectSmallestSymbol(job, expected[i].mParameters);
+	}
+
+	for (unsigned threadCount : { 2u, 3u, 8u })
+		for (size_t chunkSize : { 1u, 7u, 64u })
+		{
+			std::vector<QR::EncodeResult> results(jobs.size());
+			auto statistics = QR::EncodeBatch(jobs, results, { threadCount, chunkSize });
+
+			EXPECT_EQ(statistics.mJobCount, jobs.size());
+			EXPECT_EQ(statistics.mFailedJobCount, static_cast<size_t>(std::count_if(expected.begin(), expected.end(), [](const QR::EncodeResult &result) { return result.mError != nullptr; })));
+			EXPECT_LE(statistics.mThreadCount, threadCount);
+
+			for (size_t i = 0; i < jobs.size(); ++i)
+			{
+				EXPECT_EQ(results[i].mMatrix, expected[i].mMatrix) << i;
+				EXPECT_EQ(static_cast<bool>(results[i].mError), static_cast<bool>(expected[i].mError)) << i;
+			}
+		}
+}
+
+TEST(EncodeBatch, SmallestSymbol) //Segments chosen for version 40 need version 2 at level H, while those chosen for versions 1 to 9 fit in version 1
+{
+	std::vector<QR::EncodeJob> jobs = { { "5SL06968276", std::nullopt, QR::SymbolType::QR, 0, QR::ErrorCorrectionLevel::H },
+		{ "01234567", std::nullopt, QR::SymbolType::MICRO_QR, 0, QR::ErrorCorrectionLevel::L } };
+	std::vector<QR::EncodeResult> results(jobs.size());
+
+	QR::EncodeBatch(jobs, results);
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		ASSERT_FALSE(results[i].mError) << i;
+		ExpectSmallestSymbol(jobs[i], results[i].mParameters);
+	}
+
+	EXPECT_EQ(results[0].mParameters.mType, QR::SymbolType::QR);
+	EXPECT_EQ(results[0].mParameters.mVersion, 1u);
+	EXPECT_EQ(results[1].mParameters.mType, QR::SymbolType::MICRO_QR);
+	EXPECT_EQ(results[1].mParameters.mVersion, 2u);
+}
+
+TEST(EncodeBatch, MixedCase) //Lowercase letters must go in byte mode, so M2 symbols can't hold them
+{
+	std::vector<QR::EncodeJob> jobs = { { "https://x.example/p/AbC123456789012", std::nullopt, QR::SymbolType::QR, 0, QR::ErrorCorrectionLevel::M },
+		{ "Ab", std::nullopt, QR::SymbolType::MICRO_QR, 2, QR::ErrorCorrectionLevel::L }, { "Ab", std::nullopt, QR::SymbolType::MICRO_QR, 0, QR::ErrorCorrectionLevel::L } };
+	std::vector<QR::EncodeResult> results(jobs.size());
+	std::string_view url = jobs[0].mCharacters;
+
+	EXPECT_EQ(QR::EncodeBatch(jobs, results).mFailedJobCount, 1u);
+	ASSERT_FALSE(results[0].mError);
+	ExpectSmallestSymbol(jobs[0], results[0].mParameters);
+
+	QR::Encoder expected(results[0].mParameters.mType, results[0].mParameters.mVersion, results[0].mParameters.mLevel);
+
+	expected.addCharacters(url.substr(0, 23), QR::Mode::BYTE);
+	expected.addCharacters(url.substr(23), QR::Mode::NUMERIC);
+	EXPECT_EQ(results[0].mMatrix, expected.generateMatrixPacked());
+
+	ASSERT_TRUE(results[1].mError);
+	EXPECT_THROW(std::rethrow_exception(results[1].mError), std::invalid_argument);
+
+	ASSERT_FALSE(results[2].mError);
+	EXPECT_EQ(results[2].mParameters.mType, QR::SymbolType::MICRO_QR);
+	EXPECT_EQ(results[2].mParameters.mVersion, 3u);
+}
+
+TEST(EncodeBatch, InvalidArguments)
+{
+	std::vector<QR::EncodeJob> jobs(2, { "1", QR::Mode::NUMERIC, QR::SymbolType::QR, 1, QR::ErrorCorrectionLevel::L });
+	std::vector<QR::EncodeResult> results(1);
+
+	EXPECT_THROW(QR::EncodeBatch(jobs, results), std::invalid_argument);
+	results.resize(2);
+	EXPECT_THROW(QR::EncodeBatch(jobs, results, { 1, 0 }), std::invalid_argument);
+	EXPECT_EQ(QR::EncodeBatch({}, {}).mJobCount, 0u);
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+#include "CharacterClasses.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+
+namespace
+{
+	std::uint8_t GetExpectedClass(std::uint8_t character)
+	{
+		std::string_view alphanumeric("0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:");
+		bool lowercase = character >= 0x61 && character <= 0x7A, strict = alphanumeric.find(static_cast<char>(character)) != std::string_view::npos;
+
+		return (character >= 0x30 && character <= 0x39 ? QR::NUMERIC_CHARACTER : 0) | (strict || lowercase ? QR::ALPHANUMERIC_CHARACTER : 0) | (strict ? QR::STRICT_ALPHANUMERIC_CHARACTER : 0);
+	}
+}
+
+TEST(CharacterClasses, Classify) //Every SIMD level must match the expected class of every byte value, at every position of a vector
+{
+	std::string characters;
+	std::vector<std::uint8_t> expected;
+
+	for (unsigned i = 0; i < 256 * 3 + 7; ++i)
+		characters.push_back(static_cast<char>(i * 7 % 256)), expected.push_back(GetExpectedClass(i * 7 % 256));
+
+	for (auto level : { QR::SimdLevel::NONE, QR::SimdLevel::SSSE3, QR::SimdLevel::AVX2 })
+	{
+		if (level > QR::GetSimdLevel())
+			continue;
+
+		std::vector<std::uint8_t> classes(characters.size());
+
+		QR::ClassifyCharacters(characters, classes, level);
+		EXPECT_EQ(classes, expected) << static_cast<int>(level);
+	}
+}
+
+TEST(CharacterClasses, FindUnclassified)
+{
+	std::mt19937 generator(18004);
+	std::string_view alphanumeric("0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:");
+
+	for (unsigned iteration = 0; iteration < 500; ++iteration)
+	{
+		std::string characters(generator() % 100, '0');
+
+		for (auto &character : characters)
+			character = generator() % 4 ? alphanumeric[generator() % 10] : alphanumeric[generator() % alphanumeric.size()];
+
+		if (generator() % 2 && !characters.empty())
+			characters[generator() % characters.size()] = static_cast<char>(generator() % 3 ? generator() : 0x61 + generator() % 26);
+
+		for (std::uint8_t characterClass : { QR::NUMERIC_CHARACTER, QR::ALPHANUMERIC_CHARACTER, QR::STRICT_ALPHANUMERIC_CHARACTER })
+		{
+			size_t expected = 0;
+
+			while (expected < characters.size() && GetExpectedClass(characters[expected]) & characterClass)
+				++expected;
+
+			for (auto level : { QR::SimdLevel::NONE, QR::SimdLevel::SSSE3, QR::SimdLevel::AVX2 })
+				if (level <= QR::GetSimdLevel())
+				{
+					EXPECT_EQ(QR::FindUnclassified(characters, characterClass, level), expected) << characters;
+				}
+		}
+	}
+}
+
+TEST(CharacterClasses, Append) //Must match packing groups one by one
+{
+	std::string_view alphanumeric("0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:");
+	std::string digits, characters;
+
+	for (unsigned length = 0; length < 45; ++length)
+	{
+		QR::BitStream numeric, expectedNumeric, alphanumericStream, expectedAlphanumeric;
+
+		for (size_t i = 0; i < digits.size(); i += 3)
+		{
+			unsigned value = 0, count = static_cast<unsigned>(std::min<size_t>(3, digits.size() - i));
+
+			for (size_t j = i; j < i + count; ++j)
+				value = value * 10 + digits[j] - 0x30;
+
+			expectedNumeric.append(value, count * 3 + 1);
+		}
+
+		for (size_t i = 0; i < characters.size(); i += 2)
+			if (i + 1 < characters.size())
+				expectedAlphanumeric.append(alphanumeric.find(characters[i]) * 45 + alphanumeric.find(characters[i + 1]), 11);
+			else
+				expectedAlphanumeric.append(alphanumeric.find(characters[i]), 6);
+
+		QR::AppendNumeric(numeric, digits);
+		QR::AppendAlphanumeric(alphanumericStream, characters);
+		EXPECT_EQ(numeric, expectedNumeric) << digits;
+		EXPECT_EQ(alphanumericStream, expectedAlphanumeric) << characters;
+		digits.push_back(static_cast<char>(0x30 + length * 7 % 10));
+		characters.push_back(alphanumeric[length * 11 % alphanumeric.size()]);
+	}
+}
\ No newline at end of file
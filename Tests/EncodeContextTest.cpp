@@ -0,0 +1,131 @@
+#include "gtest/gtest.h"
+#include "QREncoder.h"
+#include "FixedEncoder.h"
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <tuple>
+
+//Counts allocations made by the calling thread. Replacing operator new affects the whole test program, but only counting is added
+namespace
+{
+	thread_local size_t allocationCount = 0;
+}
+
+//GCC inlines these into callers and then sees free() on a pointer from operator new, which is what they are meant to do
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+	#pragma GCC diagnostic push
+	#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size)
+{
+	++allocationCount;
+
+	if (void *result = std::malloc(size ? size : 1))
+		return result;
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+	#pragma GCC diagnostic pop
+#endif
+
+TEST(EncodeContext, MatchesGenerateMatrix)
+{
+	QR::EncodeContext context;
+	QR::BitMatrix output;
+
+	for (auto [type, version, level] : { std::make_tuple(QR::SymbolType::QR, 7u, QR::ErrorCorrectionLevel::H), std::make_tuple(QR::SymbolType::MICRO_QR, 3u, QR::ErrorCorrectionLevel::M),
+		std::make_tuple(QR::SymbolType::QR, 40u, QR::ErrorCorrectionLevel::Q), std::make_tuple(QR::SymbolType::QR, 1u, QR::ErrorCorrectionLevel::L), std::make_tuple(QR::SymbolType::MICRO_QR, 1u, QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY) })
+	{
+		QR::Encoder encoder(type, version, level);
+
+		encoder.addText("12345");
+		encoder.generateMatrixInto(output, context);
+		EXPECT_EQ(output, encoder.generateMatrixPacked()) << version;
+	}
+}
+
+TEST(EncodeContext, NoAllocations) //Once the caches are built and the context has seen the symbol, encoding again must not allocate
+{
+	QR::EncodeContext context;
+	QR::BitMatrix output;
+
+	for (auto [type, version, level] : { std::make_tuple(QR::SymbolType::QR, 10u, QR::ErrorCorrectionLevel::M), std::make_tuple(QR::SymbolType::QR, 40u, QR::ErrorCorrectionLevel::H),
+		std::make_tuple(QR::SymbolType::MICRO_QR, 4u, QR::ErrorCorrectionLevel::L) })
+	{
+		QR::Encoder encoder(type, version, level);
+		size_t count;
+
+		encoder.addCharacters("HELLO WORLD", QR::Mode::ALPHANUMERIC);
+		encoder.generateMatrixInto(output, context);
+		count = allocationCount;
+
+		for (unsigned i = 0; i < 3; ++i)
+			encoder.generateMatrixInto(output, context);
+
+		EXPECT_EQ(allocationCount, count) << version;
+	}
+}
+
+TEST(FixedEncoder, NoAllocations) //Counted here since this file replaces operator new. Only the shared Reed-Solomon tables allocate, on first use
+{
+	QR::FixedEncoder<QR::SymbolType::QR, 10> encoder(10, QR::ErrorCorrectionLevel::H);
+	QR::FixedEncoder<QR::SymbolType::MICRO_QR, 4> microEncoder(4, QR::ErrorCorrectionLevel::L);
+	size_t count;
+
+	encoder.generateMatrix();
+	microEncoder.generateMatrix();
+	count = allocationCount;
+
+	encoder.addCharacters("HELLO WORLD", QR::Mode::ALPHANUMERIC);
+	encoder.addCharacters("0123456789", QR::Mode::NUMERIC);
+	microEncoder.addCharacters("hello", QR::Mode::BYTE);
+	encoder.generateMatrix();
+	microEncoder.generateMatrix();
+	EXPECT_EQ(allocationCount, count);
+}
+
+TEST(TemplateEncoder, NoAllocations) //Once the context has seen the template's symbol, slots up to the longest one seen must not allocate
+{
+	QR::Segment prefix = { "https://x.example/p/", QR::Mode::BYTE };
+	QR::TemplateEncoder encoder(QR::SymbolType::QR, 5, QR::ErrorCorrectionLevel::Q, { &prefix, 1 }, QR::Mode::NUMERIC, 12);
+	QR::EncodeContext context;
+	QR::BitMatrix output;
+	size_t count;
+
+	encoder.generateMatrixInto("000000000000", output, context);
+	count = allocationCount;
+
+	for (const char *slot : { "1", "42", "123456789012" })
+		encoder.generateMatrixInto(slot, output, context);
+
+	EXPECT_EQ(allocationCount, count);
+}
\ No newline at end of file
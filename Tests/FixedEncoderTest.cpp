@@ -0,0 +1,175 @@
+#include "gtest/gtest.h"
+#include "FixedEncoder.h"
+#include "QREncoder.h"
+#include <string>
+#include <string_view>
+#include <random>
+#include <stdexcept>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+#include <tuple>
+
+namespace
+{
+	//Type and message of the exception thrown by function, empty if it didn't throw
+	template<typename Function>
+	std::string GetException(Function function)
+	{
+		try
+		{
+			function();
+		}
+		catch (const std::exception &exception)
+		{
+			return std::string(typeid(exception).name()) + ": " + exception.what();
+		}
+
+		return {};
+	}
+
+	//Adds every segment to an Encoder and a FixedEncoder, then checks that they throw the same exceptions and generate the same symbol
+	template<QR::SymbolType Type, unsigned MaxVersion>
+	void ExpectSameSymbol(unsigned version, QR::ErrorCorrectionLevel level, const std::vector<std::pair<std::string, QR::Mode>> &segments)
+	{
+		QR::Encoder encoder(Type, version, level);
+		QR::FixedEncoder<Type, MaxVersion> fixedEncoder(version, level);
+		QR::EncodeContext context;
+		QR::BitMatrix expected;
+		std::vector<bool> bitStream;
+
+		for (const auto &[message, mode] : segments)
+			EXPECT_EQ(GetException([&] { fixedEncoder.addCharacters(message, mode); }), GetException([&] { encoder.addCharacters(message, mode); })) << version << ' ' << message;
+
+		bitStream = encoder.getBitStream();
+		ASSERT_EQ(fixedEncoder.getBitStream().size(), bitStream.size());
+
+		for (size_t i = 0; i < bitStream.size(); ++i)
+			EXPECT_EQ(fixedEncoder.getBitStream()[i], bitStream[i]) << i;
+
+		auto symbol = fixedEncoder.generateMatrix();
+		auto selection = encoder.generateMatrixInto(expected, context);
+
+		EXPECT_EQ(symbol.toBitMatrix(), expected) << version << ' ' << static_cast<int>(level);
+		EXPECT_EQ(symbol.mMaskId, selection.mMaskId);
+	}
+
+	std::string GetRandomMessage(std::mt19937 &generator, QR::Mode mode, size_t length)
+	{
+		const std::string_view alphanumeric = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:abcxyz";
+		std::string result;
+
+		for (size_t i = 0; i < length; ++i)
+			switch (mode)
+			{
+				case QR::Mode::NUMERIC:
+					result += static_cast<char>('0' + generator() % 10);
+					break;
+
+				case QR::Mode::ALPHANUMERIC:
+					result += alphanumeric[generator() % alphanumeric.size()];
+					break;
+
+				case QR::Mode::BYTE:
+					if (char character = static_cast<char>(generator() % 256); character == '\\')
+						result += "\\\\";
+					else
+						result += character;
+					break;
+
+				case QR::Mode::KANJI:
+					result += generator() % 2 ? "\x93\x5F" : "\xE4\xAA";
+					break;
+			}
+
+		return result;
+	}
+}
+
+TEST(FixedEncoder, MatchesEncoder)
+{
+	std::mt19937 generator(21);
+
+	for (unsigned version = 1; version <= 11; ++version)
+		for (auto level : { QR::ErrorCorrectionLevel::L, QR::ErrorCorrectionLevel::M, QR::ErrorCorrectionLevel::Q, QR::ErrorCorrectionLevel::H })
+			for (auto mode : { QR::Mode::NUMERIC, QR::Mode::ALPHANUMERIC, QR::Mode::BYTE, QR::Mode::KANJI })
+				for (size_t length : { 0, 1, 2, 7, 20, 100, 700 })
+					ExpectSameSymbol<QR::SymbolType::QR, 11>(version, level, { { GetRandomMessage(generator, mode, length), mode } });
+}
+
+TEST(FixedEncoder, MatchesEncoderMicroQR)
+{
+	std::mt19937 generator(4);
+
+	for (auto [version, level] : { std::make_pair(1u, QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY), std::make_pair(2u, QR::ErrorCorrectionLevel::L), std::make_pair(2u, QR::ErrorCorrectionLevel::M),
+		std::make_pair(3u, QR::ErrorCorrectionLevel::L), std::make_pair(3u, QR::ErrorCorrectionLevel::M), std::make_pair(4u, QR::ErrorCorrectionLevel::L),
+		std::make_pair(4u, QR::ErrorCorrectionLevel::M), std::make_pair(4u, QR::ErrorCorrectionLevel::Q) })
+		for (auto mode : { QR::Mode::NUMERIC, QR::Mode::ALPHANUMERIC, QR::Mode::BYTE, QR::Mode::KANJI })
+			for (size_t length : { 0, 1, 3, 5, 9, 21, 40 })
+				ExpectSameSymbol<QR::SymbolType::MICRO_QR, 4>(version, level, { { GetRandomMessage(generator, mode, length), mode } });
+}
+
+TEST(FixedEncoder, Segments)
+{
+	ExpectSameSymbol<QR::SymbolType::QR, 4>(4, QR::ErrorCorrectionLevel::M, { { "HELLO WORLD", QR::Mode::ALPHANUMERIC }, { "0123456789", QR::Mode::NUMERIC }, { "a\\\\b", QR::Mode::BYTE } });
+	ExpectSameSymbol<QR::SymbolType::QR, 4>(3, QR::ErrorCorrectionLevel::Q, { { "\\000009ABC\\000026xyz", QR::Mode::BYTE }, { "\\999999", QR::Mode::NUMERIC } });
+	ExpectSameSymbol<QR::SymbolType::QR, 4>(2, QR::ErrorCorrectionLevel::L, { { "\\ +0009A", QR::Mode::BYTE }, { "\\-00001A", QR::Mode::BYTE }, { "\\12345", QR::Mode::BYTE } });
+	ExpectSameSymbol<QR::SymbolType::MICRO_QR, 4>(3, QR::ErrorCorrectionLevel::L, { { "123", QR::Mode::NUMERIC }, { "AB", QR::Mode::ALPHANUMERIC }, { "\\000009A", QR::Mode::BYTE } });
+}
+
+TEST(FixedEncoder, InvalidCharacters)
+{
+	ExpectSameSymbol<QR::SymbolType::QR, 2>(1, QR::ErrorCorrectionLevel::L, { { "12a4", QR::Mode::NUMERIC }, { "AB#", QR::Mode::ALPHANUMERIC }, { "\x93\x5F\x00\x01", QR::Mode::KANJI },
+		{ "\x93\x5F\xE4", QR::Mode::KANJI }, { "\\00a009", QR::Mode::BYTE }, { "1234", QR::Mode::NUMERIC } });
+	ExpectSameSymbol<QR::SymbolType::MICRO_QR, 2>(1, QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY, { { "A", QR::Mode::ALPHANUMERIC }, { "a", QR::Mode::BYTE }, { "12345", QR::Mode::NUMERIC } });
+	ExpectSameSymbol<QR::SymbolType::MICRO_QR, 2>(2, QR::ErrorCorrectionLevel::L, { { "\x93\x5F", QR::Mode::KANJI }, { "123456789012", QR::Mode::NUMERIC }, { "1", QR::Mode::NUMERIC } });
+}
+
+TEST(FixedEncoder, InvalidArguments)
+{
+	EXPECT_THROW((QR::FixedEncoder<QR::SymbolType::QR, 5>(6, QR::ErrorCorrectionLevel::L)), std::invalid_argument);
+	EXPECT_THROW((QR::FixedEncoder<QR::SymbolType::QR, 5>(0, QR::ErrorCorrectionLevel::L)), std::invalid_argument);
+	EXPECT_THROW((QR::FixedEncoder<QR::SymbolType::QR, 5>(1, QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY)), std::invalid_argument);
+	EXPECT_THROW((QR::FixedEncoder<QR::SymbolType::MICRO_QR, 4>(2, QR::ErrorCorrectionLevel::H)), std::invalid_argument);
+	EXPECT_THROW((QR::FixedEncoder<QR::SymbolType::MICRO_QR, 4>(1, QR::ErrorCorrectionLevel::L)), std::invalid_argument);
+}
+
+TEST(FixedEncoder, Clear)
+{
+	QR::FixedEncoder<QR::SymbolType::QR, 3> fixedEncoder(3, QR::ErrorCorrectionLevel::H);
+	QR::Encoder encoder(QR::SymbolType::QR, 3, QR::ErrorCorrectionLevel::H);
+
+	fixedEncoder.addCharacters("SOMETHING ELSE", QR::Mode::ALPHANUMERIC);
+	fixedEncoder.clear();
+	fixedEncoder.addCharacters("12345", QR::Mode::NUMERIC);
+	encoder.addCharacters("12345", QR::Mode::NUMERIC);
+	EXPECT_EQ(fixedEncoder.generateMatrix().toBitMatrix(), encoder.generateMatrixPacked());
+}
+
+TEST(EncodeConstant, MatchesGenerateMatrix) //Every symbol is generated at compile time
+{
+	constexpr auto symbol = QR::EncodeConstant<QR::SymbolType::QR, 1>("01234567", QR::Mode::NUMERIC, QR::ErrorCorrectionLevel::M);
+	constexpr auto versionInformationSymbol = QR::EncodeConstant<QR::SymbolType::QR, 7>("https://example.com/support", QR::Mode::BYTE, QR::ErrorCorrectionLevel::H);
+	constexpr auto twoGroupSymbol = QR::EncodeConstant<QR::SymbolType::QR, 11>("\\000026HELLO WORLD \\\\ 12345", QR::Mode::BYTE, QR::ErrorCorrectionLevel::Q);
+	constexpr auto alphanumericSymbol = QR::EncodeConstant<QR::SymbolType::QR, 5>("SUPPORT.EXAMPLE.COM/QR", QR::Mode::ALPHANUMERIC, QR::ErrorCorrectionLevel::L);
+	constexpr auto m1Symbol = QR::EncodeConstant<QR::SymbolType::MICRO_QR, 1>("12345", QR::Mode::NUMERIC, QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY);
+	constexpr auto m3Symbol = QR::EncodeConstant<QR::SymbolType::MICRO_QR, 3>("\x93\x5F\xE4\xAA", QR::Mode::KANJI, QR::ErrorCorrectionLevel::M);
+	constexpr auto m4Symbol = QR::EncodeConstant<QR::SymbolType::MICRO_QR, 4>("hello", QR::Mode::BYTE, QR::ErrorCorrectionLevel::Q);
+
+	static_assert(symbol.mSize == 21 && versionInformationSymbol.mSize == 45 && m1Symbol.mSize == 11);
+
+	for (auto [constant, type, version, level, message, mode] : {
+		std::make_tuple(symbol.toBitMatrix(), QR::SymbolType::QR, 1u, QR::ErrorCorrectionLevel::M, "01234567", QR::Mode::NUMERIC),
+		std::make_tuple(versionInformationSymbol.toBitMatrix(), QR::SymbolType::QR, 7u, QR::ErrorCorrectionLevel::H, "https://example.com/support", QR::Mode::BYTE),
+		std::make_tuple(twoGroupSymbol.toBitMatrix(), QR::SymbolType::QR, 11u, QR::ErrorCorrectionLevel::Q, "\\000026HELLO WORLD \\\\ 12345", QR::Mode::BYTE),
+		std::make_tuple(alphanumericSymbol.toBitMatrix(), QR::SymbolType::QR, 5u, QR::ErrorCorrectionLevel::L, "SUPPORT.EXAMPLE.COM/QR", QR::Mode::ALPHANUMERIC),
+		std::make_tuple(m1Symbol.toBitMatrix(), QR::SymbolType::MICRO_QR, 1u, QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY, "12345", QR::Mode::NUMERIC),
+		std::make_tuple(m3Symbol.toBitMatrix(), QR::SymbolType::MICRO_QR, 3u, QR::ErrorCorrectionLevel::M, "\x93\x5F\xE4\xAA", QR::Mode::KANJI),
+		std::make_tuple(m4Symbol.toBitMatrix(), QR::SymbolType::MICRO_QR, 4u, QR::ErrorCorrectionLevel::Q, "hello", QR::Mode::BYTE) })
+	{
+		QR::Encoder encoder(type, version, level);
+
+		encoder.addCharacters(message, mode);
+		EXPECT_EQ(constant.toVector(), encoder.generateMatrix()) << version;
+	}
+}
\ No newline at end of file
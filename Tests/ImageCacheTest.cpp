@@ -0,0 +1,220 @@
+#include "gtest/gtest.h"
+#include "ImageCache.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <span>
+#include <tuple>
+#include <chrono>
+#include <stdexcept>
+
+namespace QR
+{
+	std::array<std::uint8_t, 32> GetSHA256(std::span<const std::uint8_t> message);
+}
+
+namespace
+{
+	std::string ReadFile(const std::filesystem::path &path)
+	{
+		std::ifstream stream(path, std::ios::binary);
+
+		return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	}
+
+	//Empty directory for one test, removed at the end
+	struct TemporaryDirectory
+	{
+		std::filesystem::path mPath;
+
+		explicit TemporaryDirectory(std::string_view name)
+			:mPath(std::filesystem::temp_directory_path() / name)
+		{
+			std::filesystem::remove_all(mPath);
+			std::filesystem::create_directories(mPath);
+		}
+
+		~TemporaryDirectory()
+		{
+			std::error_code error;
+
+			std::filesystem::remove_all(mPath, error);
+		}
+	};
+}
+
+TEST(ImageCache, SHA256) //Test vectors from FIPS 180-4 examples, plus one that needs an extra padding block
+{
+	auto Hex = [](std::string_view message) {
+		std::string result;
+
+		for (std::uint8_t byte : QR::GetSHA256({ reinterpret_cast<const std::uint8_t*>(message.data()), message.size() }))
+			result += "0123456789abcdef"[byte >> 4], result += "0123456789abcdef"[byte & 15];
+
+		return result;
+	};
+
+	EXPECT_EQ(Hex(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	EXPECT_EQ(Hex("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	EXPECT_EQ(Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"), "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST(ImageCache, ServesRenderedImage) //A hit must give the same bytes QRToBMP writes, by hard link or by copy
+{
+	TemporaryDirectory directory("QREncoderImageCacheServe");
+	QR::ImageCache cache(directory.mPath / "cache", 1 << 20);
+	QR::Encoder encoder(QR::SymbolType::QR, 2, QR::ErrorCorrectionLevel::M);
+	QR::RenderParameters parameters = { 3, { 255, 255, 255 }, { 0, 0, 128 } };
+	std::ofstream stream(directory.mPath / "expected.bmp", std::ios::binary);
+
+	encoder.addText("Nightly label 0042");
+	stream << QR::QRToBMP(encoder.generateMatrix(), parameters.mMultiplier, parameters.mLightModuleColor, parameters.mDarkModuleColor);
+	stream.close();
+
+	std::string expected = ReadFile(directory.mPath / "expected.bmp");
+
+	EXPECT_FALSE(cache.render(encoder, parameters, directory.mPath / "first.bmp"));
+	EXPECT_TRUE(cache.render(encoder, parameters, directory.mPath / "second.bmp"));
+	cache.setHardLinks(false);
+	EXPECT_TRUE(cache.render(QR::Encoder(encoder), parameters, directory.mPath / "second.bmp")); //Replaces the file
+	EXPECT_TRUE(std::filesystem::exists(directory.mPath / "cache" / cache.getFileName(encoder, parameters)));
+
+	for (const char *name : { "first.bmp", "second.bmp" })
+		EXPECT_EQ(ReadFile(directory.mPath / name), expected);
+
+	auto statistics = cache.getStatistics();
+
+	EXPECT_EQ(statistics.mHits, 2u);
+	EXPECT_EQ(statistics.mMisses, 1u);
+
+	//A new cache on the same directory must find the image from the previous one
+	QR::ImageCache reopened(directory.mPath / "cache", 1 << 20);
+
+	EXPECT_TRUE(reopened.render(encoder, parameters, directory.mPath / "third.bmp"));
+	EXPECT_EQ(ReadFile(directory.mPath / "third.bmp"), expected);
+}
+
+TEST(ImageCache, KeepsDestinationOnFailure) //A render that throws must leave the file it would have replaced as it was
+{
+	TemporaryDirectory directory("QREncoderImageCacheFailure");
+	QR::ImageCache cache(directory.mPath / "cache", 1 << 20);
+	QR::Encoder encoder(QR::SymbolType::QR, 1, QR::ErrorCorrectionLevel::L);
+	std::ofstream stream(directory.mPath / "output.bmp", std::ios::binary);
+
+	stream << "previous";
+	stream.close();
+	encoder.addText("KEEP");
+
+	//Too wide for a BMPImage
+	EXPECT_THROW(cache.render(encoder, { 1100, { 255, 255, 255 }, { 0, 0, 0 } }, directory.mPath / "output.bmp"), std::invalid_argument);
+	EXPECT_EQ(ReadFile(directory.mPath / "output.bmp"), "previous");
+
+	//A hit on a destination that is already a hard link to the cached file leaves no temporary file behind
+	EXPECT_FALSE(cache.render(encoder, { 1, { 255, 255, 255 }, { 0, 0, 0 } }, directory.mPath / "output.bmp"));
+	EXPECT_TRUE(cache.render(encoder, { 1, { 255, 255, 255 }, { 0, 0, 0 } }, directory.mPath / "output.bmp"));
+	EXPECT_NE(ReadFile(directory.mPath / "output.bmp"), "previous");
+	EXPECT_EQ(std::distance(std::filesystem::directory_iterator(directory.mPath), std::filesystem::directory_iterator()), 2);
+}
+
+TEST(ImageCache, FileNameCoversKey) //Changing anything the image depends on must change the file name
+{
+	TemporaryDirectory directory("QREncoderImageCacheKey");
+	QR::ImageCache cache(directory.mPath, 0);
+	QR::Encoder encoder(QR::SymbolType::QR, 2, QR::ErrorCorrectionLevel::M);
+	QR::RenderParameters parameters = { 3, { 255, 255, 255 }, { 0, 0, 0 } };
+	std::vector<std::string> names;
+	auto Add = [&](const QR::Encoder &other, const QR::RenderParameters &otherParameters) { names.push_back(cache.getFileName(other, otherParameters)); };
+
+	encoder.addText("KEY");
+
+	Add(encoder, parameters);
+	Add(encoder, { 4, { 255, 255, 255 }, { 0, 0, 0 } });
+	Add(encoder, { 3, { 255, 255, 254 }, { 0, 0, 0 } });
+	Add(encoder, { 3, { 255, 255, 255 }, { 1, 0, 0 } });
+
+	QR::Encoder other = encoder;
+
+	other.setMaskPolicy(QR::MaskPolicy::FIXED, 1);
+	Add(other, parameters);
+	other.setMaskPolicy(QR::MaskPolicy::FIXED, 2);
+	Add(other, parameters);
+
+	for (auto [type, version, level] : { std::tuple{ QR::SymbolType::QR, 3u, QR::ErrorCorrectionLevel::M }, { QR::SymbolType::QR, 2u, QR::ErrorCorrectionLevel::L },
+		{ QR::SymbolType::MICRO_QR, 2u, QR::ErrorCorrectionLevel::M } })
+	{
+		QR::Encoder changed(type, version, level);
+
+		changed.addText("KEY");
+		Add(changed, parameters);
+	}
+
+	other = encoder;
+	other.addText("0");
+	Add(other, parameters);
+
+	for (size_t i = 0; i < names.size(); ++i)
+		for (size_t j = i + 1; j < names.size(); ++j)
+			EXPECT_NE(names[i], names[j]) << i << ' ' << j;
+
+	EXPECT_EQ(names.front().size(), 68u);
+}
+
+TEST(ImageCache, EvictsLeastRecentlyUsed) //The directory must stay under the cap, and images served last must be the ones kept
+{
+	TemporaryDirectory directory("QREncoderImageCacheEvict");
+	QR::RenderParameters parameters = { 1, { 255, 255, 255 }, { 0, 0, 0 } };
+	std::vector<QR::Encoder> encoders;
+	std::uintmax_t imageSize;
+
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		encoders.emplace_back(QR::SymbolType::QR, 1, QR::ErrorCorrectionLevel::L);
+		encoders.back().addText(std::to_string(i));
+	}
+
+	{
+		QR::ImageCache probe(directory.mPath / "probe", 1 << 20);
+
+		probe.render(encoders[0], parameters, directory.mPath / "probe.bmp");
+		imageSize = std::filesystem::file_size(directory.mPath / "probe.bmp");
+	}
+
+	QR::ImageCache cache(directory.mPath / "cache", imageSize * 3);
+	auto Cached = [&](unsigned i) { return std::filesystem::exists(directory.mPath / "cache" / cache.getFileName(encoders[i], parameters)); };
+	auto Touch = [&](unsigned i, int age) {
+		std::filesystem::last_write_time(directory.mPath / "cache" / cache.getFileName(encoders[i], parameters), std::filesystem::file_time_type::clock::now() - std::chrono::minutes(age));
+	};
+
+	for (unsigned i = 0; i < 3; ++i)
+		cache.render(encoders[i], parameters, directory.mPath / "output.bmp");
+
+	//Write times can be too close together to order, so they're spread out by hand
+	Touch(0, 30);
+	Touch(1, 20);
+	Touch(2, 10);
+	EXPECT_TRUE(cache.render(encoders[0], parameters, directory.mPath / "output.bmp"));
+	cache.render(encoders[3], parameters, directory.mPath / "output.bmp");
+
+	EXPECT_TRUE(Cached(0));
+	EXPECT_FALSE(Cached(1));
+	EXPECT_FALSE(Cached(2));
+	EXPECT_TRUE(Cached(3));
+	EXPECT_EQ(cache.getStatistics().mEvictions, 2u);
+
+	//Trimming stopped at 90% of the cap, so the next miss fits without trimming again
+	EXPECT_FALSE(cache.render(encoders[1], parameters, directory.mPath / "output.bmp"));
+	EXPECT_EQ(cache.getStatistics().mEvictions, 2u);
+
+	//A smaller cap is applied as soon as the directory is opened
+	Touch(0, 5);
+	Touch(3, 3);
+
+	QR::ImageCache smaller(directory.mPath / "cache", imageSize * 2);
+
+	EXPECT_EQ(smaller.getStatistics().mEvictions, 2u);
+	EXPECT_TRUE(Cached(1));
+}
\ No newline at end of file
@@ -1,18 +1,44 @@
 #include "gtest/gtest.h"
 #include "QREncoder.h"
+#include "BitStream.h"
+#include "SymbolTables.h"
+#include "CharacterClasses.h"
+#include "Encoding.h"
 #include <optional>
 #include <concepts>
 #include <charconv>
 #include <string_view>
+#include <random>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <span>
+#include <algorithm>
 
 namespace QR
 {
 	std::uint8_t GetAlphanumericCode(std::string::value_type);
 	Mode GetMinimalMode(std::uint8_t, std::optional<std::uint8_t> = std::optional<std::uint8_t>());
-	std::uint16_t ToInteger(const std::vector<std::string::value_type> &);
-	bool IsKanji(std::uint16_t);
+	std::uint16_t ToInteger(std::string_view);
 	unsigned GetSymbolRating(const std::vector<std::vector<bool>> &symbol, SymbolType type);
-	std::vector<bool> GetECISequence(unsigned assignmentNumber);
+	unsigned GetSymbolRating(const BitMatrix &symbol, SymbolType type, unsigned bound = std::numeric_limits<unsigned>::max(), bool rowsOnly = false);
+	std::array<unsigned, 8> GetSymbolRatings(const BitMatrix &symbol, std::span<const BitMatrix> masks, SymbolType type);
+	BitMatrix GetDataRegionMask(SymbolType type, std::uint8_t version);
+	const std::array<BitMatrix, 8>& GetMaskPatterns(SymbolType type, std::uint8_t version);
+	struct ModulePosition
+	{
+		std::uint8_t mRow;
+		std::uint8_t mColumn;
+	};
+	const std::vector<ModulePosition>& GetPlacementOrder(SymbolType type, std::uint8_t version);
+	struct SymbolTemplate
+	{
+		BitMatrix mFunctionPatterns;
+		BitMatrix mDataRegionMask;
+		BitMatrix mVersionInformation;
+	};
+	const SymbolTemplate& GetSymbolTemplate(SymbolType type, std::uint8_t version);
 }
 
 namespace
@@ -26,6 +52,67 @@ namespace
 
 		return result;
 	}
+
+	std::vector<bool> ToVector(QR::BitField field)
+	{
+		QR::BitStream stream;
+
+		stream.append(field);
+
+		return stream.toVector();
+	}
+
+	QR::Symbol AddQuietZone(const QR::Symbol &symbol, size_t quietZoneWidth)
+	{
+		QR::Symbol result(symbol.size() + quietZoneWidth * 2, std::vector<bool>(symbol.size() + quietZoneWidth * 2));
+
+		for (size_t i = 0; i < symbol.size(); ++i)
+			std::copy(symbol[i].begin(), symbol[i].end(), result[i + quietZoneWidth].begin() + quietZoneWidth);
+
+		return result;
+	}
+
+	//Example in ISO/IEC 18004:2015, annex I: "01234567" in a 1-M symbol with mask 000. Data codewords 10 20 0C 56 61 80 EC 11 EC 11 EC 11 EC 11 EC 11,
+	//error correction codewords A5 24 D4 C1 ED 36 C7 87 2C 55
+	const QR::Symbol GOLDEN_QR = {
+		{ 1,1,1,1,1,1,1,0,0,0,1,1,1,0,1,1,1,1,1,1,1, },
+		{ 1,0,0,0,0,0,1,0,1,1,1,0,0,0,1,0,0,0,0,0,1, },
+		{ 1,0,1,1,1,0,1,0,0,1,1,0,0,0,1,0,1,1,1,0,1, },
+		{ 1,0,1,1,1,0,1,0,0,1,0,1,1,0,1,0,1,1,1,0,1, },
+		{ 1,0,1,1,1,0,1,0,1,1,0,1,1,0,1,0,1,1,1,0,1, },
+		{ 1,0,0,0,0,0,1,0,0,0,0,1,0,0,1,0,0,0,0,0,1, },
+		{ 1,1,1,1,1,1,1,0,1,0,1,0,1,0,1,1,1,1,1,1,1, },
+		{ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, },
+		{ 1,0,1,0,1,0,1,0,0,0,1,0,1,0,0,0,1,0,0,1,0, },
+		{ 1,1,0,1,0,0,0,0,1,0,1,1,0,1,0,1,0,0,0,1,0, },
+		{ 0,0,0,1,1,0,1,1,1,0,1,1,0,1,1,1,0,1,1,1,0, },
+		{ 1,1,0,0,1,1,0,1,0,1,0,1,1,1,0,1,1,0,0,1,0, },
+		{ 0,0,1,0,0,1,1,1,0,1,1,1,0,1,1,1,0,0,0,0,1, },
+		{ 0,0,0,0,0,0,0,0,1,0,1,0,0,0,1,0,0,0,0,1,0, },
+		{ 1,1,1,1,1,1,1,0,0,0,0,0,1,0,0,0,1,0,0,0,1, },
+		{ 1,0,0,0,0,0,1,0,0,0,1,0,0,0,1,0,0,1,0,1,1, },
+		{ 1,0,1,1,1,0,1,0,1,1,1,0,1,0,1,0,1,1,1,0,1, },
+		{ 1,0,1,1,1,0,1,0,0,1,0,1,0,1,0,1,0,1,1,1,0, },
+		{ 1,0,1,1,1,0,1,0,1,1,0,1,0,1,1,1,0,0,1,0,1, },
+		{ 1,0,0,0,0,0,1,0,0,0,0,1,1,1,0,1,1,1,0,0,0, },
+		{ 1,1,1,1,1,1,1,0,1,0,0,1,0,1,1,1,0,0,1,0,1, },
+	};
+	//Micro QR example in the same annex: "01234567" in an M2-L symbol with mask 01. Data codewords 40 18 AC C3 00, error correction codewords 86 0D 22 AE 30
+	const QR::Symbol GOLDEN_MICRO_QR = {
+		{ 1,1,1,1,1,1,1,0,1,0,1,0,1, },
+		{ 1,0,0,0,0,0,1,0,1,1,1,0,1, },
+		{ 1,0,1,1,1,0,1,0,0,1,1,0,1, },
+		{ 1,0,1,1,1,0,1,0,0,1,1,1,1, },
+		{ 1,0,1,1,1,0,1,0,1,1,1,0,0, },
+		{ 1,0,0,0,0,0,1,0,1,0,0,0,1, },
+		{ 1,1,1,1,1,1,1,0,0,1,1,1,1, },
+		{ 0,0,0,0,0,0,0,0,0,1,1,0,0, },
+		{ 1,1,0,1,0,0,0,0,1,0,0,0,1, },
+		{ 0,1,1,0,1,0,1,0,1,0,1,0,1, },
+		{ 1,1,1,0,0,1,1,1,1,1,1,1,0, },
+		{ 0,0,0,1,0,1,0,0,0,0,1,1,0, },
+		{ 1,1,1,0,1,0,0,1,1,0,1,1,1, },
+	};
 }
 
 TEST(Encoder_addCharacters, ECI)
@@ -73,6 +160,20 @@ TEST(Encoder_addCharacters, SymbolCapacity)
 	EXPECT_THROW(m1.addCharacters("012345678", QR::Mode::NUMERIC), std::length_error);
 }
 
+TEST(Encoder_addCharacters, FailedCallKeepsBitStream)
+{
+	QR::Encoder encoder(QR::SymbolType::QR, 1, QR::ErrorCorrectionLevel::L);
+
+	encoder.addCharacters("12", QR::Mode::NUMERIC);
+
+	auto bitStream = encoder.getBitStream();
+
+	EXPECT_THROW(encoder.addCharacters("1234a", QR::Mode::NUMERIC), std::invalid_argument);
+	EXPECT_THROW(encoder.addCharacters("\\00009", QR::Mode::BYTE), std::invalid_argument);
+	EXPECT_THROW(encoder.addCharacters(std::string(20, 'A'), QR::Mode::BYTE), std::length_error);
+	EXPECT_EQ(encoder.getBitStream(), bitStream);
+}
+
 TEST(Encoder_addCharacters, OddKanjiByteCount)
 {
 	QR::Encoder encoder(QR::SymbolType::QR, 1, QR::ErrorCorrectionLevel::L);
@@ -82,12 +183,38 @@ TEST(Encoder_addCharacters, OddKanjiByteCount)
 
 TEST(GetECISequence, General)
 {
-	EXPECT_EQ(QR::GetECISequence(9), (std::vector<bool>{ 0, 1, 1, 1, 0, 0, 0, 0, 1, 0, 0, 1 }));
-	EXPECT_EQ(QR::GetECISequence(16382), (std::vector<bool>{ 0, 1, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0 }));
-	EXPECT_EQ(QR::GetECISequence(999997), (std::vector<bool>{ 0, 1, 1, 1, 1, 1, 0, 0, 1, 1, 1, 1, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 1, 0, 1 }));
+	EXPECT_EQ(ToVector(QR::GetECISequence(9)), (std::vector<bool>{ 0, 1, 1, 1, 0, 0, 0, 0, 1, 0, 0, 1 }));
+	EXPECT_EQ(ToVector(QR::GetECISequence(16382)), (std::vector<bool>{ 0, 1, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0 }));
+	EXPECT_EQ(ToVector(QR::GetECISequence(999997)), (std::vector<bool>{ 0, 1, 1, 1, 1, 1, 0, 0, 1, 1, 1, 1, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 1, 0, 1 }));
 	EXPECT_THROW(QR::GetECISequence(1000000), std::invalid_argument);
 }
 
+TEST(BitStream, Append)
+{
+	QR::BitStream stream;
+
+	stream.append(0b101, 3);
+	stream.append(0xFFFFFFFFFFFFFFFF, 64); //Crosses a word boundary
+	stream.appendBytes("\x01\x80");
+	EXPECT_EQ(stream.size(), 83);
+	EXPECT_EQ(stream.getWords().size(), 2);
+	EXPECT_EQ(stream.read(0, 3), 0b101);
+	EXPECT_EQ(stream.read(3, 64), 0xFFFFFFFFFFFFFFFF);
+	EXPECT_EQ(stream.read(67, 16), 0x0180);
+	EXPECT_EQ(stream.read(80, 8), 0); //Past the end
+	EXPECT_EQ(ToString(stream.toVector()).substr(60), "11111110000000110000000");
+}
+
+TEST(BitStream, Resize)
+{
+	QR::BitStream stream;
+
+	stream.append(0xFF, 8);
+	stream.resize(4);
+	stream.resize(12);
+	EXPECT_EQ(ToString(stream.toVector()), "111100000000");
+}
+
 TEST(GetSymbolRating, General)
 {
 	std::vector<std::vector<bool>> symbol1 = {
@@ -142,6 +269,420 @@ TEST(GetSymbolRating, General)
 	EXPECT_EQ(QR::GetSymbolRating(symbol2, QR::SymbolType::QR), 520);
 }
 
+TEST(GetSymbolRating, MultiWordRows) //Expected values come from the module by module implementation
+{
+	std::mt19937 generator(18004);
+	QR::BitMatrix symbol1(57, 57), symbol2(177, 177);
+
+	for (QR::BitMatrix::size_type i = 0; i < symbol1.getHeight(); ++i)
+		for (QR::BitMatrix::size_type j = 0; j < symbol1.getWidth(); ++j)
+			symbol1.set(i, j, generator() & 1);
+
+	for (QR::BitMatrix::size_type i = 0; i < symbol2.getHeight(); ++i)
+		for (QR::BitMatrix::size_type j = 0; j < symbol2.getWidth(); ++j)
+			symbol2.set(i, j, generator() % 3 == 0);
+
+	EXPECT_EQ(QR::GetSymbolRating(symbol1, QR::SymbolType::QR), 2067);
+	EXPECT_EQ(QR::GetSymbolRating(symbol2, QR::SymbolType::QR), 34888);
+}
+
+TEST(GetSymbolRating, Bound) //Stopping early must give at least the bound, and the exact score when it's lower
+{
+	std::mt19937 generator(18004);
+
+	for (unsigned iteration = 0; iteration < 20; ++iteration)
+	{
+		QR::BitMatrix symbol(21 + iteration * 8, 21 + iteration * 8);
+		unsigned score;
+
+		for (QR::BitMatrix::size_type i = 0; i < symbol.getHeight(); ++i)
+			for (QR::BitMatrix::size_type j = 0; j < symbol.getWidth(); ++j)
+				symbol.set(i, j, generator() % (iteration % 3 + 2) == 0);
+
+		score = QR::GetSymbolRating(symbol, QR::SymbolType::QR);
+
+		for (unsigned bound : { 0u, 1u, score / 2, score, score + 1 })
+		{
+			unsigned bounded = QR::GetSymbolRating(symbol, QR::SymbolType::QR, bound);
+
+			if (score < bound)
+				EXPECT_EQ(bounded, score);
+			else
+				EXPECT_TRUE(bounded >= bound && bounded <= score) << bounded;
+		}
+	}
+}
+
+TEST(GetSymbolRating, BitSliced) //Rating every mask in one pass must match rating each masked symbol on its own
+{
+	std::mt19937 generator(18004);
+	std::vector<std::pair<QR::SymbolType, std::uint8_t>> symbols = { { QR::SymbolType::QR, 1 }, { QR::SymbolType::QR, 2 }, { QR::SymbolType::QR, 7 },
+		{ QR::SymbolType::QR, 14 }, { QR::SymbolType::QR, 27 }, { QR::SymbolType::QR, 40 } };
+
+	for (std::uint8_t version = 1; version <= 4; ++version)
+		symbols.emplace_back(QR::SymbolType::MICRO_QR, version);
+
+	for (auto [type, version] : symbols)
+	{
+		const std::array<QR::BitMatrix, 8> &masks = QR::GetMaskPatterns(type, version);
+		unsigned maskCount = type == QR::SymbolType::QR ? 8 : 4;
+
+		for (unsigned density : { 2u, 3u, 7u })
+		{
+			QR::BitMatrix symbol(masks.front().getWidth(), masks.front().getHeight());
+			std::array<unsigned, 8> ratings;
+
+			for (QR::BitMatrix::size_type i = 0; i < symbol.getHeight(); ++i)
+				for (QR::BitMatrix::size_type j = 0; j < symbol.getWidth(); ++j)
+					symbol.set(i, j, generator() % density == 0);
+
+			symbol |= QR::GetSymbolTemplate(type, version).mFunctionPatterns;
+			ratings = QR::GetSymbolRatings(symbol, std::span(masks).first(maskCount), type);
+
+			for (unsigned mask = 0; mask < maskCount; ++mask)
+			{
+				QR::BitMatrix masked = symbol;
+
+				masked ^= masks[mask];
+				EXPECT_EQ(ratings[mask], QR::GetSymbolRating(masked, type)) << static_cast<unsigned>(version) << ' ' << mask;
+			}
+		}
+	}
+
+	for (QR::BitMatrix::size_type size : { 57u, 177u })
+	{
+		std::array<QR::BitMatrix, 1> masks = { QR::BitMatrix(size, size) };
+		QR::BitMatrix symbol(size, size);
+
+		for (QR::BitMatrix::size_type i = 0; i < size; ++i)
+			for (QR::BitMatrix::size_type j = 0; j < size; ++j)
+				symbol.set(i, j, generator() % 3 == 0);
+
+		EXPECT_EQ(QR::GetSymbolRatings(symbol, masks, QR::SymbolType::QR)[0], QR::GetSymbolRating(symbol, QR::SymbolType::QR));
+	}
+}
+
+TEST(GetMaskPatterns, General)
+{
+	for (auto [type, version] : { std::make_pair(QR::SymbolType::QR, 1), std::make_pair(QR::SymbolType::QR, 7), std::make_pair(QR::SymbolType::MICRO_QR, 3) })
+	{
+		auto &patterns = QR::GetMaskPatterns(type, version);
+		auto mask = QR::GetDataRegionMask(type, version);
+
+		EXPECT_EQ(&patterns, &QR::GetMaskPatterns(type, version));
+
+		for (std::uint8_t maskId = 0; maskId < (type == QR::SymbolType::QR ? 8 : 4); ++maskId)
+			for (QR::BitMatrix::size_type i = 0; i < mask.getHeight(); ++i)
+				for (QR::BitMatrix::size_type j = 0; j < mask.getWidth(); ++j)
+					EXPECT_EQ(patterns[maskId].get(i, j), !mask.get(i, j) && QR::GetMaskBit(type, maskId, i, j));
+	}
+
+	EXPECT_THROW(QR::GetMaskPatterns(QR::SymbolType::MICRO_QR, 5), std::invalid_argument);
+}
+
+TEST(GetSymbolTemplate, General)
+{
+	for (auto [type, version] : { std::make_pair(QR::SymbolType::QR, 6), std::make_pair(QR::SymbolType::QR, 7), std::make_pair(QR::SymbolType::MICRO_QR, 4) })
+	{
+		auto &symbolTemplate = QR::GetSymbolTemplate(type, version);
+		auto outsideMask = symbolTemplate.mFunctionPatterns;
+
+		EXPECT_EQ(&symbolTemplate, &QR::GetSymbolTemplate(type, version));
+		EXPECT_EQ(symbolTemplate.mDataRegionMask, QR::GetDataRegionMask(type, version));
+		EXPECT_TRUE(symbolTemplate.mFunctionPatterns.get(0, 0)); //Finder pattern corner
+		EXPECT_EQ(symbolTemplate.mVersionInformation.count() != 0, version >= 7 && type == QR::SymbolType::QR);
+
+		//Function patterns and version information only cover the masked region
+		outsideMask |= symbolTemplate.mVersionInformation;
+		outsideMask |= symbolTemplate.mDataRegionMask;
+		EXPECT_EQ(outsideMask, symbolTemplate.mDataRegionMask);
+	}
+}
+
+TEST(GetPlacementOrder, General)
+{
+	auto &order = QR::GetPlacementOrder(QR::SymbolType::QR, 1);
+	auto &microOrder = QR::GetPlacementOrder(QR::SymbolType::MICRO_QR, 2);
+
+	//Upwards in the rightmost column pair, then downwards in the next one
+	EXPECT_EQ(order[0].mRow, 20); EXPECT_EQ(order[0].mColumn, 20);
+	EXPECT_EQ(order[1].mRow, 20); EXPECT_EQ(order[1].mColumn, 19);
+	EXPECT_EQ(order[2].mRow, 19); EXPECT_EQ(order[2].mColumn, 20);
+	EXPECT_EQ(order[24].mRow, 9); EXPECT_EQ(order[24].mColumn, 18);
+	//Ends in the leftmost column pair, past the vertical timing pattern
+	EXPECT_EQ(order.back().mRow, 12); EXPECT_EQ(order.back().mColumn, 0);
+	EXPECT_EQ(microOrder.front().mRow, 12); EXPECT_EQ(microOrder.front().mColumn, 12);
+
+	for (auto [type, version] : { std::make_pair(QR::SymbolType::QR, 1), std::make_pair(QR::SymbolType::QR, 7), std::make_pair(QR::SymbolType::QR, 40), std::make_pair(QR::SymbolType::MICRO_QR, 2) })
+	{
+		auto mask = QR::GetDataRegionMask(type, version);
+		QR::BitMatrix visited(mask.getWidth(), mask.getHeight());
+
+		for (auto position : QR::GetPlacementOrder(type, version))
+		{
+			EXPECT_FALSE(mask.get(position.mRow, position.mColumn));
+			EXPECT_FALSE(visited.get(position.mRow, position.mColumn));
+			visited.set(position.mRow, position.mColumn, true);
+		}
+
+		EXPECT_EQ(visited.count() + mask.count(), mask.getWidth() * mask.getHeight()); //Every data module is visited
+	}
+}
+
+TEST(GetMaskPatternCacheSize, General)
+{
+	QR::PrecomputeMaskPatterns(QR::SymbolType::QR, 39);
+
+	auto size = QR::GetMaskPatternCacheSize();
+
+	EXPECT_GE(size, 8 * 173 * 3 * sizeof(QR::BitMatrix::WordType));
+	QR::PrecomputeMaskPatterns(QR::SymbolType::QR, 39);
+	EXPECT_EQ(QR::GetMaskPatternCacheSize(), size);
+}
+
+TEST(PrecomputeMaskPatterns, InvalidVersion) //Versions that wrap around to a valid std::uint8_t must be rejected, not read as version 1
+{
+	EXPECT_THROW(QR::PrecomputeMaskPatterns(QR::SymbolType::QR, 257), std::invalid_argument);
+	EXPECT_THROW(QR::PrecomputeMaskPatterns(QR::SymbolType::MICRO_QR, 258), std::invalid_argument);
+	EXPECT_THROW(QR::PrecomputeMaskPatterns(QR::SymbolType::QR, 0), std::invalid_argument);
+	EXPECT_THROW(QR::Encoder(QR::SymbolType::QR, 257, QR::ErrorCorrectionLevel::L), std::invalid_argument);
+	EXPECT_THROW(QR::GetOptimalSegments("12345", QR::SymbolType::QR, 257), std::invalid_argument);
+	EXPECT_NO_THROW(QR::PrecomputeMaskPatterns(QR::SymbolType::MICRO_QR, 4));
+}
+
+TEST(GetSymbolDescriptor, General)
+{
+	auto &descriptor = QR::GetSymbolDescriptor(QR::SymbolType::QR, 37, QR::ErrorCorrectionLevel::H);
+	auto &microDescriptor = QR::GetSymbolDescriptor(QR::SymbolType::MICRO_QR, 1, QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY);
+	QR::Encoder encoder(QR::SymbolType::QR, 37, QR::ErrorCorrectionLevel::H);
+
+	EXPECT_EQ(descriptor.mSize, 165);
+	EXPECT_EQ(descriptor.mErrorCorrectionCodewordCount, 2100);
+	EXPECT_EQ(descriptor.mDataBitCapacity, 25568 - 2100 * 8);
+	EXPECT_EQ(descriptor.mCharacterCountLengths[static_cast<size_t>(QR::Mode::BYTE)], 16);
+	ASSERT_EQ(descriptor.mBlockLayout.size(), 2);
+	EXPECT_EQ(descriptor.mBlockLayout[1].mBlockCount, 46);
+	EXPECT_EQ(descriptor.mBlockLayout[1].mDataCodewordCount, 16);
+	EXPECT_EQ(std::vector<std::uint8_t>(descriptor.mAlignmentPatternCenters.begin(), descriptor.mAlignmentPatternCenters.end()), (std::vector<std::uint8_t>{ 6, 28, 54, 80, 106, 132, 158 }));
+	EXPECT_EQ(microDescriptor.mDataBitCapacity, 20);
+	EXPECT_EQ(microDescriptor.mBlockLayout.size(), 1);
+	EXPECT_TRUE(microDescriptor.mAlignmentPatternCenters.empty());
+	EXPECT_THROW(QR::GetSymbolDescriptor(QR::SymbolType::MICRO_QR, 5, QR::ErrorCorrectionLevel::L), std::invalid_argument);
+	encoder.addCharacters("37-H", QR::Mode::BYTE);
+	EXPECT_NO_THROW(encoder.generateMatrix());
+}
+
+TEST(ChooseSymbol, General)
+{
+	std::array<QR::Segment, 1> hello = { { { "HELLO WORLD", QR::Mode::ALPHANUMERIC } } };
+	std::array<QR::Segment, 1> digits = { { { "01234567", QR::Mode::NUMERIC } } };
+	std::array<QR::Segment, 2> mixed = { { { "AB12", QR::Mode::ALPHANUMERIC }, { "0123456789", QR::Mode::NUMERIC } } };
+	std::string tooLong(3000, 'a');
+	std::array<QR::Segment, 1> tooLongSegment = { { { tooLong, QR::Mode::BYTE } } };
+	auto parameters = QR::ChooseSymbol(hello);
+	auto microParameters = QR::ChooseSymbol(digits, QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY, true);
+
+	EXPECT_EQ(parameters.mType, QR::SymbolType::QR);
+	EXPECT_EQ(parameters.mVersion, 1);
+	EXPECT_EQ(parameters.mLevel, QR::ErrorCorrectionLevel::Q);
+	EXPECT_EQ(microParameters.mType, QR::SymbolType::MICRO_QR);
+	EXPECT_EQ(microParameters.mVersion, 2);
+	EXPECT_EQ(microParameters.mLevel, QR::ErrorCorrectionLevel::M);
+	EXPECT_EQ(QR::ChooseSymbol(hello, QR::ErrorCorrectionLevel::H).mVersion, 2);
+	EXPECT_THROW(QR::ChooseSymbol(tooLongSegment), std::length_error);
+
+	//CreateEncoder must match an Encoder built by hand from ChooseSymbol, with the segments added in order
+	for (auto [segments, minimumLevel, allowMicroQR] : { std::make_tuple(std::span<const QR::Segment>(hello), QR::ErrorCorrectionLevel::L, false),
+		std::make_tuple(std::span<const QR::Segment>(mixed), QR::ErrorCorrectionLevel::M, true) })
+	{
+		auto chosen = QR::ChooseSymbol(segments, minimumLevel, allowMicroQR);
+		QR::Encoder expected(chosen.mType, chosen.mVersion, chosen.mLevel);
+
+		for (auto &segment : segments)
+			expected.addCharacters(segment.mCharacters, segment.mMode);
+
+		EXPECT_EQ(QR::CreateEncoder(segments, minimumLevel, allowMicroQR).generateMatrix(), expected.generateMatrix());
+	}
+}
+
+TEST(ChooseSymbol, SmallestSymbol) //Must match trying every symbol in order
+{
+	std::mt19937 generator(18004);
+	std::string_view alphabet("0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:");
+
+	for (unsigned i = 0; i < 60; ++i)
+	{
+		std::vector<std::string> texts;
+		std::vector<QR::Segment> segments;
+		std::optional<QR::SymbolParameters> expected;
+
+		for (unsigned j = 0, count = generator() % 3 + 1; j < count; ++j)
+		{
+			auto mode = static_cast<QR::Mode>(generator() % 3);
+			std::string text(generator() % (i * 10 + 5) + 1, ' ');
+
+			for (auto &character : text)
+				character = mode == QR::Mode::NUMERIC ? alphabet[generator() % 10] : mode == QR::Mode::ALPHANUMERIC ? alphabet[generator() % alphabet.size()] : static_cast<char>('a' + generator() % 26);
+
+			if (mode == QR::Mode::BYTE && generator() % 4 == 0)
+				text = "\\000026" + text;
+
+			texts.push_back(std::move(text));
+		}
+
+		for (const auto &text : texts)
+		{
+			QR::Mode mode = QR::Mode::BYTE;
+
+			if (text.find_first_not_of("0123456789") == std::string::npos)
+				mode = QR::Mode::NUMERIC;
+			else
+				if (text.find_first_not_of(alphabet) == std::string::npos)
+					mode = QR::Mode::ALPHANUMERIC;
+
+			segments.push_back({ text, mode });
+		}
+
+		for (auto type : { QR::SymbolType::MICRO_QR, QR::SymbolType::QR })
+			for (unsigned version = 1; version <= (type == QR::SymbolType::MICRO_QR ? 4u : 40u) && !expected; ++version)
+				for (auto level : { QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY, QR::ErrorCorrectionLevel::L, QR::ErrorCorrectionLevel::M, QR::ErrorCorrectionLevel::Q, QR::ErrorCorrectionLevel::H })
+					try
+					{
+						QR::Encoder encoder(type, version, level);
+
+						for (const auto &segment : segments)
+							encoder.addCharacters(segment.mCharacters, segment.mMode);
+
+						expected = { type, version, level };
+					}
+					catch (const std::exception &)
+					{
+						if (expected)
+							break;
+					}
+
+		ASSERT_TRUE(expected);
+
+		auto parameters = QR::ChooseSymbol(segments, QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY, true);
+
+		EXPECT_EQ(parameters.mType, expected->mType);
+		EXPECT_EQ(parameters.mVersion, expected->mVersion);
+		EXPECT_EQ(parameters.mLevel, expected->mLevel);
+	}
+}
+
+TEST(Encoder_addText, General)
+{
+	std::string_view message("HTTPS://EXAMPLE.COM/ID/123456789012345678901234567890");
+	QR::Encoder encoder(QR::SymbolType::QR, 5, QR::ErrorCorrectionLevel::L), alphanumeric(encoder), byte(encoder), eci(encoder);
+	auto segments = QR::GetOptimalSegments(message, QR::SymbolType::QR, 5);
+
+	encoder.addText(message);
+	alphanumeric.addCharacters(message, QR::Mode::ALPHANUMERIC);
+	byte.addCharacters(message, QR::Mode::BYTE);
+	EXPECT_LT(encoder.getBitStream().size(), alphanumeric.getBitStream().size());
+	EXPECT_LT(encoder.getBitStream().size(), byte.getBitStream().size());
+	ASSERT_EQ(segments.size(), 2);
+	EXPECT_EQ(segments[0].mCharacters, "HTTPS://EXAMPLE.COM/ID/");
+	EXPECT_EQ(segments[0].mMode, QR::Mode::ALPHANUMERIC);
+	EXPECT_EQ(segments[1].mMode, QR::Mode::NUMERIC);
+
+	segments = QR::GetOptimalSegments("\\000026\\\\x\\000009", QR::SymbolType::QR, 1);
+	ASSERT_EQ(segments.size(), 2);
+	EXPECT_EQ(segments[0].mCharacters, "\\000026\\\\x");
+	EXPECT_EQ(segments[0].mMode, QR::Mode::BYTE);
+	EXPECT_EQ(segments[1].mCharacters, "\\000009");
+	EXPECT_THROW(eci.addText("ab\\0001"), std::invalid_argument);
+	EXPECT_THROW(QR::Encoder(QR::SymbolType::MICRO_QR, 1, QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY).addText("12A"), std::invalid_argument);
+}
+
+TEST(Encoder_addText, Lowercase) //Alphanumeric mode would uppercase lowercase letters, so they must be in byte mode
+{
+	auto segments = QR::GetOptimalSegments("https://x.example/p/AbC123456789012", QR::SymbolType::QR, 5);
+
+	ASSERT_EQ(segments.size(), 2);
+	EXPECT_EQ(segments[0].mCharacters, "https://x.example/p/AbC");
+	EXPECT_EQ(segments[0].mMode, QR::Mode::BYTE);
+	EXPECT_EQ(segments[1].mCharacters, "123456789012");
+	EXPECT_EQ(segments[1].mMode, QR::Mode::NUMERIC);
+
+	segments = QR::GetOptimalSegments("HTTPS://X.EXAMPLE/ID/abcdefghij", QR::SymbolType::QR, 5);
+	ASSERT_EQ(segments.size(), 2);
+	EXPECT_EQ(segments[0].mMode, QR::Mode::ALPHANUMERIC);
+	EXPECT_EQ(segments[1].mCharacters, "abcdefghij");
+	EXPECT_EQ(segments[1].mMode, QR::Mode::BYTE);
+
+	//M2 has no byte mode
+	EXPECT_THROW(QR::Encoder(QR::SymbolType::MICRO_QR, 2, QR::ErrorCorrectionLevel::L).addText("Ab"), std::invalid_argument);
+	EXPECT_NO_THROW(QR::Encoder(QR::SymbolType::MICRO_QR, 2, QR::ErrorCorrectionLevel::L).addText("AB"));
+}
+
+TEST(Encoder_addText, Shortest) //Must match the shortest of every possible segmentation
+{
+	std::mt19937 generator(18004);
+	std::array<std::string_view, 6> characters = { "1", "7", "A", "a", "\x01", "\x8A\xAE" };
+
+	for (unsigned i = 0; i < 200; ++i)
+	{
+		std::vector<std::string_view> units;
+		std::string message;
+		auto version = static_cast<unsigned>(generator() % 4 + 1);
+		auto type = i % 2 ? QR::SymbolType::QR : QR::SymbolType::MICRO_QR;
+		auto level = type == QR::SymbolType::MICRO_QR && version == 1 ? QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY : QR::ErrorCorrectionLevel::L;
+		size_t shortest = std::numeric_limits<size_t>::max();
+		QR::Encoder encoder(type, type == QR::SymbolType::QR ? version * 9 : version, level);
+
+		for (unsigned j = 0, count = generator() % 6 + 1; j < count; ++j)
+			units.push_back(characters[generator() % (type == QR::SymbolType::MICRO_QR && version < 3 ? 3 : characters.size())]);
+
+		for (auto unit : units)
+			message += unit;
+
+		//Every split point is on or off, and every segment tries every mode
+		for (unsigned splits = 0; splits < 1u << (units.size() - 1); ++splits)
+		{
+			std::vector<std::string> segments(1);
+
+			for (size_t j = 0; j < units.size(); ++j)
+			{
+				if (j && splits >> (j - 1) & 1)
+					segments.emplace_back();
+
+				segments.back() += units[j];
+			}
+
+			for (unsigned modes = 0; modes < std::pow(4, segments.size()); ++modes)
+			{
+				QR::Encoder candidate(encoder);
+
+				try
+				{
+					for (unsigned j = 0, remaining = modes; j < segments.size(); ++j, remaining /= 4)
+					{
+						//addCharacters takes lowercase letters in alphanumeric mode, but they wouldn't be read back as they were
+						if (static_cast<QR::Mode>(remaining % 4) == QR::Mode::ALPHANUMERIC && segments[j].find('a') != std::string::npos)
+							throw std::invalid_argument("Lowercase letter in alphanumeric mode");
+
+						candidate.addCharacters(segments[j], static_cast<QR::Mode>(remaining % 4));
+					}
+
+					shortest = std::min(shortest, candidate.getBitStream().size());
+				}
+				catch (const std::exception &)
+				{}
+			}
+		}
+
+		if (shortest == std::numeric_limits<size_t>::max())
+			EXPECT_THROW(encoder.addText(message), std::exception);
+		else
+		{
+			encoder.addText(message);
+			EXPECT_EQ(encoder.getBitStream().size(), shortest) << message;
+		}
+	}
+}
+
 TEST(GetAlphanumericCode, ValidCharacters)
 {
 	std::string_view alphaNumericTable("0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:");
@@ -167,6 +708,10 @@ TEST(GetMinimalMode, General)
 	for (auto c : alphaTable)
 		EXPECT_EQ(QR::GetMinimalMode(c), QR::Mode::ALPHANUMERIC);
 
+	//Scanners would read lowercase letters back uppercase from alphanumeric mode
+	for (std::uint8_t c = 'a'; c <= 'z'; ++c)
+		EXPECT_EQ(QR::GetMinimalMode(c), QR::Mode::BYTE);
+
 	for (const std::pair<std::uint16_t, std::uint16_t> &kanjiRange : {
 		std::make_pair(0x8140, 0x817E), std::make_pair(0x8180, 0x81FC),
 		std::make_pair(0x9F40, 0X9F7E), std::make_pair(0x9F80, 0x9FFC),
@@ -179,13 +724,13 @@ TEST(GetMinimalMode, General)
 
 TEST(ToInteger, Triplets)
 {
-	EXPECT_EQ(QR::ToInteger({ '0', '1', '2' }), 12);
+	EXPECT_EQ(QR::ToInteger("012"), 12);
 }
 
 TEST(ToInteger, Remainder)
 {
-	EXPECT_EQ(QR::ToInteger({ '6', '7' }), 67);
-	EXPECT_EQ(QR::ToInteger({ '8' }), 8);
+	EXPECT_EQ(QR::ToInteger("67"), 67);
+	EXPECT_EQ(QR::ToInteger("8"), 8);
 }
 
 TEST(IsKanji, General)
@@ -206,6 +751,14 @@ TEST(BitStream, ECI) //Example in ISO/IEC 18004:2015, section 7.4.2.2
 	EXPECT_EQ(ToString(encoder.getBitStream()), "0111" "00001001" "0100" "00000101" "10100001" "10100010" "10100011" "10100100" "10100101");
 }
 
+TEST(BitStream, DoubleBackslash)
+{
+	QR::Encoder encoder { QR::SymbolType::QR, 1, QR::ErrorCorrectionLevel::H };
+
+	encoder.addCharacters("x\\\\y", QR::Mode::BYTE);
+	EXPECT_EQ(ToString(encoder.getBitStream()), "0100" "00000011" "01111000" "01011100" "01111001");
+}
+
 TEST(BitStream, Numeric) //Example in ISO/IEC 18004:2015, section 7.4.3
 {
 	using namespace std::string_view_literals;
@@ -239,4 +792,156 @@ TEST(BitStream, Kanji)
 
 	encoder.addCharacters("\x93\x5F\xE4\xAA\x93\x5F\xE4\xAA", QR::Mode::KANJI);
 	EXPECT_EQ(ToString(encoder.getBitStream()), "1000" "00000100" "0110110011111" "1101010101010" "0110110011111" "1101010101010");
+}
+
+TEST(Encoder_generateMatrix, Packed) //Modules must be where the golden symbols have them, with an empty quiet zone
+{
+	for (auto [type, version, level, golden, quietZoneWidth] : { std::make_tuple(QR::SymbolType::QR, 1u, QR::ErrorCorrectionLevel::M, &GOLDEN_QR, 4u),
+		std::make_tuple(QR::SymbolType::MICRO_QR, 2u, QR::ErrorCorrectionLevel::L, &GOLDEN_MICRO_QR, 2u) })
+	{
+		QR::Encoder encoder(type, version, level);
+		size_t darkModuleCount = 0;
+
+		encoder.addCharacters("01234567", QR::Mode::NUMERIC);
+
+		auto packed = encoder.generateMatrixPacked();
+
+		ASSERT_EQ(packed.getWidth(), golden->size() + quietZoneWidth * 2);
+		ASSERT_EQ(packed.getHeight(), golden->size() + quietZoneWidth * 2);
+		EXPECT_EQ(packed.getWordsPerRow(), 1);
+
+		for (size_t i = 0; i < golden->size(); ++i)
+			for (size_t j = 0; j < golden->size(); ++j)
+			{
+				EXPECT_EQ(packed.get(i + quietZoneWidth, j + quietZoneWidth), (*golden)[i][j]) << i << ' ' << j;
+				darkModuleCount += (*golden)[i][j];
+			}
+
+		EXPECT_EQ(packed.count(), darkModuleCount);
+	}
+
+	QR::Encoder encoder(QR::SymbolType::QR, 7, QR::ErrorCorrectionLevel::M);
+
+	encoder.addCharacters("HELLO WORLD", QR::Mode::ALPHANUMERIC);
+	EXPECT_EQ(encoder.generateMatrixPacked().getWidth(), 45 + 8);
+	EXPECT_EQ(encoder.generateMatrixPacked().getWordsPerRow(), 1);
+}
+
+TEST(Encoder_generateMatrix, Golden)
+{
+	QR::Encoder encoder(QR::SymbolType::QR, 1, QR::ErrorCorrectionLevel::M), microEncoder(QR::SymbolType::MICRO_QR, 2, QR::ErrorCorrectionLevel::L);
+	QR::EncodeContext context;
+	QR::BitMatrix matrix;
+
+	encoder.addCharacters("01234567", QR::Mode::NUMERIC);
+	microEncoder.addCharacters("01234567", QR::Mode::NUMERIC);
+	EXPECT_EQ(encoder.generateMatrix(), AddQuietZone(GOLDEN_QR, 4));
+	EXPECT_EQ(microEncoder.generateMatrix(), AddQuietZone(GOLDEN_MICRO_QR, 2));
+	EXPECT_EQ(encoder.generateMatrixInto(matrix, context).mMaskId, 0u);
+	EXPECT_EQ(microEncoder.generateMatrixInto(matrix, context).mMaskId, 1u);
+}
+
+TEST(Encoder_generateMatrix, Parallel) //Must match the serial result, including the mask picked on ties
+{
+	for (auto [type, version, level] : { std::make_tuple(QR::SymbolType::QR, 40u, QR::ErrorCorrectionLevel::H), std::make_tuple(QR::SymbolType::QR, 30u, QR::ErrorCorrectionLevel::Q),
+		std::make_tuple(QR::SymbolType::QR, 5u, QR::ErrorCorrectionLevel::L), std::make_tuple(QR::SymbolType::MICRO_QR, 4u, QR::ErrorCorrectionLevel::M) })
+		for (std::string_view message : { "", "0", "HELLO WORLD", "AAAAAAAAAAAAAAAAAA" })
+		{
+			QR::Encoder encoder(type, version, level);
+			QR::EncodeContext context;
+			QR::BitMatrix serial, parallel;
+
+			encoder.addText(message);
+			encoder.generateMatrixInto(serial, context);
+			encoder.setParallel(true);
+			EXPECT_TRUE(encoder.getParallel());
+			encoder.generateMatrixInto(parallel, context);
+			EXPECT_EQ(parallel, serial) << version << message;
+		}
+}
+
+TEST(Encoder_generateMatrix, MaskPolicy)
+{
+	for (auto [type, version] : { std::make_pair(QR::SymbolType::QR, 9u), std::make_pair(QR::SymbolType::MICRO_QR, 3u) })
+	{
+		QR::Encoder encoder(type, version, QR::ErrorCorrectionLevel::L);
+		QR::EncodeContext context;
+		QR::BitMatrix exhaustive, fixed, fast;
+		QR::MaskSelection selection, fixedSelection, fastSelection;
+
+		encoder.addText("MASK 12345");
+		selection = encoder.generateMatrixInto(exhaustive, context);
+		EXPECT_EQ(encoder.getMaskPolicy(), QR::MaskPolicy::EXHAUSTIVE);
+		EXPECT_TRUE(selection.mScore.has_value());
+
+		//Fixing the mask the exhaustive search picked must give the same symbol
+		encoder.setMaskPolicy(QR::MaskPolicy::FIXED, selection.mMaskId);
+		fixedSelection = encoder.generateMatrixInto(fixed, context);
+		EXPECT_EQ(fixed, exhaustive);
+		EXPECT_EQ(fixedSelection.mMaskId, selection.mMaskId);
+		EXPECT_FALSE(fixedSelection.mScore.has_value());
+
+		encoder.setMaskPolicy(QR::MaskPolicy::FIXED, (selection.mMaskId + 1) % 4);
+		EXPECT_NE(encoder.generateMatrixInto(fixed, context).mMaskId, selection.mMaskId);
+		EXPECT_NE(fixed, exhaustive);
+
+		encoder.setMaskPolicy(QR::MaskPolicy::FAST);
+		fastSelection = encoder.generateMatrixInto(fast, context);
+		EXPECT_TRUE(fastSelection.mScore.has_value());
+		EXPECT_LT(fastSelection.mMaskId, type == QR::SymbolType::QR ? 8u : 4u);
+
+		if (type == QR::SymbolType::MICRO_QR)
+		{
+			EXPECT_EQ(fast, exhaustive);
+		}
+		else
+		{
+			//The score is the rows only rating of the chosen mask, taken before format and version information are drawn
+			unsigned size = QR::GetSymbolSize(type, version), quietZoneWidth = 4;
+			QR::BitMatrix masked(size, size);
+			auto clear = [&masked](unsigned row, unsigned column, bool) { masked.set(row, column, false); };
+
+			for (unsigned i = 0; i < size; ++i)
+				for (unsigned j = 0; j < size; ++j)
+					masked.set(i, j, fast.get(i + quietZoneWidth, j + quietZoneWidth));
+
+			QR::DrawFormatInformation(type, static_cast<std::uint8_t>(version), QR::ErrorCorrectionLevel::L, fastSelection.mMaskId, clear);
+			QR::DrawVersionInformation(type, static_cast<std::uint8_t>(version), clear);
+			EXPECT_EQ(fastSelection.mScore, QR::GetSymbolRating(masked, type, std::numeric_limits<unsigned>::max(), true));
+		}
+
+		EXPECT_THROW(encoder.setMaskPolicy(QR::MaskPolicy::FIXED, type == QR::SymbolType::QR ? 8 : 4), std::invalid_argument);
+	}
+}
+
+TEST(BitMatrix, Transposed)
+{
+	QR::BitMatrix matrix(130, 70);
+
+	matrix.set(0, 129, true);
+	matrix.set(69, 3, true);
+	matrix.set(64, 64, true);
+
+	auto transposed = matrix.transposed();
+
+	EXPECT_EQ(transposed.getWidth(), 70);
+	EXPECT_EQ(transposed.getHeight(), 130);
+	EXPECT_TRUE(transposed.get(129, 0));
+	EXPECT_TRUE(transposed.get(3, 69));
+	EXPECT_TRUE(transposed.get(64, 64));
+	EXPECT_EQ(transposed.count(), 3);
+	EXPECT_EQ(transposed.transposed(), matrix);
+}
+
+TEST(BitMatrix, Paste)
+{
+	QR::BitMatrix source(70, 2), destination(80, 4);
+
+	source.set(0, 0, true);
+	source.set(1, 69, true);
+	destination.paste(source, 1, 5);
+	EXPECT_TRUE(destination.get(1, 5));
+	EXPECT_TRUE(destination.get(2, 74));
+	EXPECT_EQ(destination.count(), 2);
+	EXPECT_THROW(destination.paste(source, 3, 0), std::out_of_range);
 }
\ No newline at end of file
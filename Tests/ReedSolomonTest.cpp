@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+#include "ReedSolomon.h"
+#include <array>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+TEST(ReedSolomonEncoder, Encode) //Example in ISO/IEC 18004:2015, annex I.3, version 1-M
+{
+	QR::ReedSolomonEncoder encoder(10);
+	std::array<std::uint8_t, 16> data = { 32, 91, 11, 120, 209, 114, 220, 77, 67, 64, 236, 17, 236, 17, 236, 17 };
+	std::array<std::uint8_t, 10> parity;
+
+	encoder.encode(data, parity);
+	EXPECT_EQ(parity, (std::array<std::uint8_t, 10>{ 196, 35, 39, 119, 235, 215, 231, 226, 93, 23 }));
+}
+
+TEST(ReedSolomonEncoder, Append) //Encoding a block in parts must give the same codewords, wherever it's split
+{
+	QR::ReedSolomonEncoder encoder(10);
+	std::array<std::uint8_t, 16> data = { 32, 91, 11, 120, 209, 114, 220, 77, 67, 64, 236, 17, 236, 17, 236, 17 };
+	std::array<std::uint8_t, 10> expected, parity;
+
+	encoder.encode(data, expected);
+
+	for (size_t split = 0; split <= data.size(); ++split)
+	{
+		encoder.encode(std::span(data).first(split), parity);
+		encoder.append(std::span(data).subspan(split), parity);
+		EXPECT_EQ(parity, expected) << split;
+	}
+
+	EXPECT_THROW(encoder.append(data, std::span(parity).first(9)), std::invalid_argument);
+}
+
+TEST(ReedSolomonEncoder, ZeroData)
+{
+	QR::ReedSolomonEncoder encoder(68);
+	std::vector<std::uint8_t> data(50), parity(68, 0xFF);
+
+	encoder.encode(data, parity);
+	EXPECT_EQ(parity, std::vector<std::uint8_t>(68));
+}
+
+TEST(ReedSolomonEncoder, InvalidLength)
+{
+	QR::ReedSolomonEncoder encoder(7);
+	std::vector<std::uint8_t> data(5), parity(6);
+
+	EXPECT_THROW(QR::ReedSolomonEncoder(9), std::invalid_argument);
+	EXPECT_THROW(QR::ReedSolomonEncoder(100), std::invalid_argument);
+	EXPECT_THROW(encoder.encode(data, parity), std::invalid_argument);
+}
+
+TEST(ReedSolomonEncoder, EncodeBatch) //Every SIMD level must match encoding the blocks one by one
+{
+	std::mt19937 generator(18004);
+
+	for (unsigned parityLength : { 7u, 30u, 68u })
+		for (size_t blockCount : { 1u, 3u, 16u, 49u, 81u })
+		{
+			QR::ReedSolomonEncoder encoder(parityLength);
+			const size_t dataLength = 54;
+			std::vector<std::uint8_t> data(dataLength * blockCount), expected(parityLength * blockCount), block(dataLength), blockParity(parityLength);
+
+			for (auto &codeword : data)
+				codeword = static_cast<std::uint8_t>(generator());
+
+			for (size_t b = 0; b < blockCount; ++b)
+			{
+				for (size_t i = 0; i < dataLength; ++i)
+					block[i] = data[i * blockCount + b];
+
+				encoder.encode(block, blockParity);
+
+				for (unsigned i = 0; i < parityLength; ++i)
+					expected[i * blockCount + b] = blockParity[i];
+			}
+
+			for (auto level : { QR::SimdLevel::NONE, QR::SimdLevel::SSSE3, QR::SimdLevel::AVX2 })
+			{
+				std::vector<std::uint8_t> parity(parityLength * blockCount, 0xFF);
+
+				encoder.encodeBatch(data, parity, blockCount, level);
+				EXPECT_EQ(parity, expected);
+			}
+
+			//Ranges encoded separately must give the same result, without touching other blocks
+			for (size_t rangeLength : { 1u, 16u, 32u })
+			{
+				std::vector<std::uint8_t> parity(parityLength * blockCount, 0xFF);
+
+				for (size_t first = 0; first < blockCount; first += rangeLength)
+					encoder.encodeBatch(data, parity, blockCount, first, std::min(first + rangeLength, blockCount));
+
+				EXPECT_EQ(parity, expected);
+			}
+		}
+}
+
+TEST(ReedSolomonEncoder, EncodeBatchInvalidLength)
+{
+	QR::ReedSolomonEncoder encoder(7);
+	std::vector<std::uint8_t> data(10), parity(14);
+
+	EXPECT_THROW(encoder.encodeBatch(data, parity, 3), std::invalid_argument);
+	EXPECT_THROW(encoder.encodeBatch(data, std::span<std::uint8_t>(parity).first(13), 2), std::invalid_argument);
+	EXPECT_NO_THROW(encoder.encodeBatch(data, parity, 2));
+	EXPECT_THROW(encoder.encodeBatch(data, parity, 2, 1, 3), std::invalid_argument);
+	EXPECT_THROW(encoder.encodeBatch(data, parity, 2, 2, 1), std::invalid_argument);
+	EXPECT_NO_THROW(encoder.encodeBatch(data, parity, 2, 1, 2));
+}
\ No newline at end of file
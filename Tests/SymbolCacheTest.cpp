@@ -0,0 +1,204 @@
+#include "gtest/gtest.h"
+#include "SymbolCache.h"
+#include "BitStream.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <stdexcept>
+
+TEST(SymbolCache, EncoderMemoizesSymbol) //Generating twice must return the same symbol until the bit stream or mask policy changes
+{
+	QR::Encoder encoder(QR::SymbolType::QR, 3, QR::ErrorCorrectionLevel::M), copy = encoder;
+	auto Expected = [](auto addCharacters, QR::MaskPolicy policy = QR::MaskPolicy::EXHAUSTIVE, unsigned maskId = 0) {
+		QR::Encoder fresh(QR::SymbolType::QR, 3, QR::ErrorCorrectionLevel::M);
+
+		fresh.setMaskPolicy(policy, maskId);
+		addCharacters(fresh);
+
+		return fresh.generateMatrixPacked();
+	};
+	auto first = encoder.generateSymbol();
+
+	EXPECT_EQ(encoder.generateSymbol(), first);
+	EXPECT_EQ(encoder.generateMatrixPacked(), first->mMatrix);
+	EXPECT_EQ(QR::BitMatrix(encoder.generateMatrix()), first->mMatrix);
+
+	encoder.addCharacters("HELLO WORLD", QR::Mode::ALPHANUMERIC);
+
+	auto second = encoder.generateSymbol();
+
+	EXPECT_NE(second, first);
+	EXPECT_EQ(second->mMatrix, Expected([](QR::Encoder &e) { e.addCharacters("HELLO WORLD", QR::Mode::ALPHANUMERIC); }));
+
+	copy = encoder;
+	EXPECT_EQ(copy.generateSymbol(), second);
+
+	encoder.addText("0123456789");
+	EXPECT_EQ(encoder.generateMatrixPacked(), Expected([](QR::Encoder &e) { e.addCharacters("HELLO WORLD", QR::Mode::ALPHANUMERIC); e.addText("0123456789"); }));
+	EXPECT_EQ(copy.generateSymbol(), second); //Copies stop sharing once one of them changes
+
+	encoder.setMaskPolicy(QR::MaskPolicy::FIXED, 5);
+	EXPECT_EQ(encoder.generateSymbol()->mSelection.mMaskId, 5u);
+	EXPECT_EQ(encoder.generateMatrixPacked(), Expected([](QR::Encoder &e) { e.addCharacters("HELLO WORLD", QR::Mode::ALPHANUMERIC); e.addText("0123456789"); }, QR::MaskPolicy::FIXED, 5));
+
+	encoder.clear();
+	EXPECT_EQ(encoder.generateMatrixPacked(), Expected([](QR::Encoder &) {}, QR::MaskPolicy::FIXED, 5));
+}
+
+TEST(SymbolCache, GenerateMatrixIntoUsesMemo) //generateMatrixInto must reuse a symbol generated before, and give the same result when there's none
+{
+	QR::Encoder encoder(QR::SymbolType::MICRO_QR, 4, QR::ErrorCorrectionLevel::L);
+	QR::EncodeContext context;
+	QR::BitMatrix output;
+
+	encoder.addText("memo");
+
+	auto selection = encoder.generateMatrixInto(output, context);
+	auto symbol = encoder.generateSymbol();
+
+	EXPECT_EQ(output, symbol->mMatrix);
+	EXPECT_EQ(selection.mMaskId, symbol->mSelection.mMaskId);
+	EXPECT_EQ(selection.mScore, symbol->mSelection.mScore);
+
+	output = QR::BitMatrix();
+	selection = encoder.generateMatrixInto(output, context);
+	EXPECT_EQ(output, symbol->mMatrix);
+	EXPECT_EQ(selection.mMaskId, symbol->mSelection.mMaskId);
+}
+
+TEST(SymbolCache, SharesSymbolsBetweenEncoders) //Encoders with the same key must get the same symbol, anything else in the key must miss
+{
+	auto cache = std::make_shared<QR::SymbolCache>(1 << 20, 4);
+	std::vector<QR::Encoder> encoders(4, QR::Encoder(QR::SymbolType::QR, 2, QR::ErrorCorrectionLevel::Q));
+
+	for (auto &encoder : encoders)
+	{
+		encoder.setCache(cache);
+		encoder.addCharacters("CACHED", QR::Mode::ALPHANUMERIC);
+	}
+
+	encoders[2].setMaskPolicy(QR::MaskPolicy::FAST);
+	encoders[3].setMaskPolicy(QR::MaskPolicy::FIXED, 2);
+
+	auto symbol = encoders[0].generateSymbol();
+
+	EXPECT_EQ(encoders[1].generateSymbol(), symbol);
+	EXPECT_NE(encoders[2].generateSymbol(), symbol);
+	EXPECT_NE(encoders[3].generateSymbol(), symbol);
+
+	auto statistics = cache->getStatistics();
+
+	EXPECT_EQ(statistics.mHits, 1u);
+	EXPECT_EQ(statistics.mMisses, 3u);
+	EXPECT_EQ(statistics.mEvictions, 0u);
+	EXPECT_EQ(statistics.mEntryCount, 3u);
+	EXPECT_LE(statistics.mByteCount, cache->getByteBudget());
+
+	QR::Encoder uncached(QR::SymbolType::QR, 2, QR::ErrorCorrectionLevel::Q), other(QR::SymbolType::QR, 2, QR::ErrorCorrectionLevel::H);
+	QR::EncodeContext context;
+	QR::BitMatrix output;
+
+	uncached.addCharacters("CACHED", QR::Mode::ALPHANUMERIC);
+	EXPECT_EQ(symbol->mMatrix, uncached.generateMatrixPacked());
+
+	other.setCache(cache);
+	other.addCharacters("CACHED", QR::Mode::ALPHANUMERIC);
+	other.generateMatrixInto(output, context);
+	EXPECT_EQ(cache->getStatistics().mEntryCount, 4u);
+	EXPECT_EQ(other.generateSymbol()->mMatrix, output);
+
+	cache->clear();
+	EXPECT_EQ(cache->getStatistics().mEntryCount, 0u);
+	EXPECT_EQ(cache->getStatistics().mByteCount, 0u);
+	EXPECT_EQ(cache->getStatistics().mHits, 1u);
+	EXPECT_EQ(encoders[1].generateSymbol(), symbol); //Still memoized by the encoder
+}
+
+TEST(SymbolCache, EvictsLeastRecentlyUsed) //The byte budget must never be exceeded, and the symbols used last must be the ones kept
+{
+	QR::BitStream bitStream;
+	auto Key = [&bitStream](unsigned version) { return QR::SymbolCacheKey{ bitStream, QR::SymbolType::QR, version, QR::ErrorCorrectionLevel::L, QR::MaskPolicy::EXHAUSTIVE, 0 }; };
+	auto Symbol = [] { return std::make_shared<const QR::GeneratedSymbol>(QR::GeneratedSymbol{ QR::BitMatrix(64, 64), { 0, 0 } }); };
+	QR::SymbolCache probe(1 << 20, 1);
+
+	probe.insert(Key(1), Symbol());
+
+	size_t entrySize = probe.getStatistics().mByteCount;
+	QR::SymbolCache cache(entrySize * 3, 1);
+
+	for (unsigned version = 1; version <= 3; ++version)
+		cache.insert(Key(version), Symbol());
+
+	EXPECT_TRUE(cache.find(Key(1)));
+	cache.insert(Key(4), Symbol());
+
+	EXPECT_TRUE(cache.find(Key(1)));
+	EXPECT_FALSE(cache.find(Key(2)));
+	EXPECT_TRUE(cache.find(Key(3)));
+	EXPECT_TRUE(cache.find(Key(4)));
+
+	auto statistics = cache.getStatistics();
+
+	EXPECT_EQ(statistics.mEvictions, 1u);
+	EXPECT_EQ(statistics.mEntryCount, 3u);
+	EXPECT_EQ(statistics.mByteCount, entrySize * 3);
+
+	QR::SymbolCache tiny(entrySize - 1, 1);
+	auto symbol = Symbol();
+
+	EXPECT_EQ(tiny.insert(Key(1), symbol), symbol);
+	EXPECT_EQ(tiny.getStatistics().mEntryCount, 0u);
+	EXPECT_THROW(QR::SymbolCache(1 << 20, 0), std::invalid_argument);
+}
+
+TEST(SymbolCache, ConcurrentEncoders) //Threads sharing a cache and an encoder must get the same symbols as encoding alone
+{
+	auto cache = std::make_shared<QR::SymbolCache>(64 << 10, 8);
+	std::vector<QR::BitMatrix> expected;
+	std::vector<std::thread> threads;
+	std::vector<unsigned> failures(4);
+	QR::Encoder shared(QR::SymbolType::QR, 5, QR::ErrorCorrectionLevel::H);
+
+	for (unsigned i = 0; i < 40; ++i)
+	{
+		QR::Encoder encoder(QR::SymbolType::QR, 5, QR::ErrorCorrectionLevel::H);
+
+		encoder.addText(std::to_string(i * 104729));
+		expected.push_back(encoder.generateMatrixPacked());
+	}
+
+	shared.setCache(cache);
+	shared.addText("shared");
+
+	auto sharedExpected = QR::Encoder(shared).generateMatrixPacked();
+
+	for (unsigned t = 0; t < failures.size(); ++t)
+		threads.emplace_back([&, t] {
+			QR::EncodeContext context;
+			QR::BitMatrix output;
+
+			for (unsigned round = 0; round < 5; ++round)
+				for (unsigned i = 0; i < expected.size(); ++i)
+				{
+					QR::Encoder encoder(QR::SymbolType::QR, 5, QR::ErrorCorrectionLevel::H);
+
+					encoder.setCache(cache);
+					encoder.addText(std::to_string((i + t * 7) % expected.size() * 104729));
+					encoder.generateMatrixInto(output, context);
+					failures[t] += output != expected[(i + t * 7) % expected.size()];
+					failures[t] += shared.generateMatrixPacked() != sharedExpected;
+				}
+		});
+
+	for (auto &thread : threads)
+		thread.join();
+
+	for (unsigned count : failures)
+		EXPECT_EQ(count, 0u);
+
+	auto statistics = cache->getStatistics();
+
+	EXPECT_GT(statistics.mHits, 0u);
+	EXPECT_LE(statistics.mByteCount, cache->getByteBudget());
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "gtest/gtest.h"
+#include "QREncoder.h"
+#include <string>
+#include <vector>
+#include <tuple>
+#include <stdexcept>
+
+namespace
+{
+	QR::BitMatrix EncodeFully(QR::SymbolType type, unsigned version, QR::ErrorCorrectionLevel level, const std::vector<QR::Segment> &prefix, std::string_view slot, QR::Mode slotMode,
+		QR::MaskPolicy policy = QR::MaskPolicy::EXHAUSTIVE, unsigned fixedMaskId = 0)
+	{
+		QR::Encoder encoder(type, version, level);
+
+		encoder.setMaskPolicy(policy, fixedMaskId);
+
+		for (const auto &segment : prefix)
+			encoder.addCharacters(segment.mCharacters, segment.mMode);
+
+		encoder.addCharacters(slot, slotMode);
+
+		return encoder.generateMatrixPacked();
+	}
+}
+
+TEST(TemplateEncoder, MatchesEncoder) //Every slot length must give the same symbol as encoding the whole message, wherever the prefix ends
+{
+	struct Case
+	{
+		QR::SymbolType mType;
+		unsigned mVersion;
+		QR::ErrorCorrectionLevel mLevel;
+		std::vector<QR::Segment> mPrefix;
+		QR::Mode mSlotMode;
+		size_t mMaxSlotLength;
+	};
+	std::string longPrefix(600, 'x');
+	std::vector<Case> cases = {
+		{ QR::SymbolType::QR, 5, QR::ErrorCorrectionLevel::Q, { { "https://x.example/p/", QR::Mode::BYTE } }, QR::Mode::NUMERIC, 12 },
+		{ QR::SymbolType::QR, 10, QR::ErrorCorrectionLevel::H, { { "HTTPS://X.EXAMPLE/P/", QR::Mode::ALPHANUMERIC }, { "2024", QR::Mode::NUMERIC } }, QR::Mode::ALPHANUMERIC, 40 },
+		{ QR::SymbolType::QR, 27, QR::ErrorCorrectionLevel::L, { { longPrefix, QR::Mode::BYTE } }, QR::Mode::BYTE, 300 },
+		{ QR::SymbolType::QR, 1, QR::ErrorCorrectionLevel::M, {}, QR::Mode::BYTE, 14 },
+		{ QR::SymbolType::QR, 3, QR::ErrorCorrectionLevel::L, { { "\\000026caf\xC3\xA9", QR::Mode::BYTE } }, QR::Mode::KANJI, 10 },
+		{ QR::SymbolType::MICRO_QR, 1, QR::ErrorCorrectionLevel::ERROR_DETECTION_ONLY, { { "12", QR::Mode::NUMERIC } }, QR::Mode::NUMERIC, 1 },
+		{ QR::SymbolType::MICRO_QR, 3, QR::ErrorCorrectionLevel::M, { { "AB", QR::Mode::ALPHANUMERIC } }, QR::Mode::BYTE, 5 },
+		{ QR::SymbolType::MICRO_QR, 4, QR::ErrorCorrectionLevel::L, { { "id:", QR::Mode::BYTE } }, QR::Mode::NUMERIC, 20 }
+	};
+	std::string filler = "31415926535897932384626433832795";
+
+	for (const auto &c : cases)
+		for (QR::MaskPolicy policy : { QR::MaskPolicy::EXHAUSTIVE, QR::MaskPolicy::FIXED, QR::MaskPolicy::FAST })
+		{
+			QR::TemplateEncoder encoder(c.mType, c.mVersion, c.mLevel, c.mPrefix, c.mSlotMode, c.mMaxSlotLength);
+			QR::EncodeContext context;
+			QR::BitMatrix output;
+
+			encoder.setMaskPolicy(policy, 1);
+
+			for (size_t length = 0; length <= c.mMaxSlotLength; ++length)
+			{
+				std::string slot;
+
+				for (size_t i = 0; i < length; ++i)
+					if (c.mSlotMode == QR::Mode::KANJI)
+						slot += i % 2 ? "\x93\x5F" : "\xE4\xAA";
+					else
+						if (c.mSlotMode == QR::Mode::BYTE)
+							slot += i % 7 == 3 ? std::string("\\\\") : std::string(1, static_cast<char>('a' + i % 26));
+						else
+							slot += filler[i % filler.size()];
+
+				encoder.generateMatrixInto(slot, output, context);
+				EXPECT_EQ(output, EncodeFully(c.mType, c.mVersion, c.mLevel, c.mPrefix, slot, c.mSlotMode, policy, 1)) << c.mVersion << ' ' << length;
+			}
+		}
+}
+
+TEST(TemplateEncoder, Copy) //Copies must keep the compiled prefix and the mask policy
+{
+	std::vector<QR::Segment> prefix = { { "SERIAL ", QR::Mode::ALPHANUMERIC } };
+	QR::TemplateEncoder encoder(QR::SymbolType::QR, 2, QR::ErrorCorrectionLevel::M, prefix, QR::Mode::NUMERIC, 8);
+	QR::TemplateEncoder other(QR::SymbolType::MICRO_QR, 2, QR::ErrorCorrectionLevel::L, {}, QR::Mode::NUMERIC, 1);
+
+	encoder.setMaskPolicy(QR::MaskPolicy::FIXED, 6);
+	other = encoder;
+	EXPECT_EQ(other.getMaskPolicy(), QR::MaskPolicy::FIXED);
+	EXPECT_EQ(QR::TemplateEncoder(other).generateMatrixPacked("1234"), EncodeFully(QR::SymbolType::QR, 2, QR::ErrorCorrectionLevel::M, prefix, "1234", QR::Mode::NUMERIC, QR::MaskPolicy::FIXED, 6));
+}
+
+TEST(TemplateEncoder, InvalidArguments)
+{
+	std::vector<QR::Segment> prefix = { { "https://x.example/p/", QR::Mode::BYTE } };
+	QR::TemplateEncoder encoder(QR::SymbolType::QR, 2, QR::ErrorCorrectionLevel::L, prefix, QR::Mode::NUMERIC, 5);
+
+	EXPECT_THROW(encoder.generateMatrixPacked("123456"), std::length_error);
+	EXPECT_THROW(encoder.generateMatrixPacked("12a"), std::invalid_argument);
+	EXPECT_THROW(encoder.generateMatrixPacked("\\000026"), std::invalid_argument);
+	EXPECT_NO_THROW(encoder.generateMatrixPacked("12345"));
+
+	EXPECT_THROW(QR::TemplateEncoder(QR::SymbolType::QR, 2, QR::ErrorCorrectionLevel::L, prefix, QR::Mode::NUMERIC, 30), std::length_error);
+	EXPECT_THROW(QR::TemplateEncoder(QR::SymbolType::QR, 2, QR::ErrorCorrectionLevel::L, { { { "abc", QR::Mode::NUMERIC } } }, QR::Mode::NUMERIC, 5), std::invalid_argument);
+	EXPECT_THROW(QR::TemplateEncoder(QR::SymbolType::MICRO_QR, 2, QR::ErrorCorrectionLevel::L, {}, QR::Mode::BYTE, 1), std::invalid_argument);
+	EXPECT_THROW(QR::TemplateEncoder(QR::SymbolType::QR, 41, QR::ErrorCorrectionLevel::L, {}, QR::Mode::BYTE, 1), std::invalid_argument);
+}
\ No newline at end of file